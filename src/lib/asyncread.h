@@ -0,0 +1,407 @@
+// Axel '0vercl0k' Souchet - October 17 2026
+#pragma once
+
+#include "diagnostics.h"
+#include "filemap.h"
+#include "parallel.h"
+#include "platform.h"
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define KDMPPARSER_IO_URING
+#endif
+#endif
+#endif
+
+#if defined(KDMPPARSER_IO_URING)
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace kdmpparser {
+
+//
+// How the asynchronous reads are done.
+//
+
+struct AsyncReadOptions_t {
+
+  //
+  // Maximum number of reads in flight.
+  //
+
+  uint32_t QueueDepth = 128;
+
+  //
+  // Maximum size of a read; pages that are next to each other in the file are
+  // read together, up to this size.
+  //
+
+  uint64_t MaxReadSize = 0x2'0000;
+
+  //
+  // Use io_uring if it is available; otherwise, or if it isn't, the reads are
+  // done by `NumberOfThreads` threads (0 uses one per hardware thread).
+  //
+
+  bool UseIoUring = true;
+  uint32_t NumberOfThreads = 0;
+};
+
+//
+// Invoked once per read of a file range, with the data that has been read
+// and how many bytes of it there are; the data is nullptr if the read failed,
+// and is only valid during the call.
+//
+
+using RangeReadCallback_t = std::function<void(
+    const uint64_t RangeIdx, const uint8_t *Data, const uint64_t BytesRead)>;
+
+//
+// Read ranges of a file with a pool of threads, each doing one read at a time
+// through the backend; `Callback` is never invoked by two threads at the same
+// time.
+//
+
+inline void ThreadPoolRead(const FileBackend_t &File,
+                           const std::vector<FileRange_t> &Ranges,
+                           const AsyncReadOptions_t &Options,
+                           const RangeReadCallback_t &Callback) {
+  std::mutex CallbackLock;
+  ParallelFor(Options.NumberOfThreads, Ranges.size(),
+              [&](const uint64_t RangeIdx) {
+                thread_local std::vector<uint8_t> Buffer;
+                const FileRange_t &Range = Ranges[RangeIdx];
+                Buffer.resize(size_t(Range.Size));
+                const uint64_t BytesRead =
+                    File.Read(Range.Offset, Buffer.data(), Range.Size);
+
+                std::lock_guard<std::mutex> Lock(CallbackLock);
+                Callback(RangeIdx, BytesRead ? Buffer.data() : nullptr,
+                         BytesRead);
+              });
+}
+
+#if defined(KDMPPARSER_IO_URING)
+
+//
+// Submission and completion queues of an io_uring instance, set up with the
+// raw system calls so that there is nothing to link against.
+//
+
+class IoUring_t {
+  int Fd_ = -1;
+  io_uring_params Params_ = {};
+
+  //
+  // The rings, and the submission queue entries.
+  //
+
+  uint8_t *SqRing_ = nullptr;
+  size_t SqRingSize_ = 0;
+  uint8_t *CqRing_ = nullptr;
+  size_t CqRingSize_ = 0;
+  io_uring_sqe *Sqes_ = nullptr;
+  size_t SqesSize_ = 0;
+
+  template <typename Type_t> Type_t *SqField(const uint32_t Offset) const {
+    return (Type_t *)(SqRing_ + Offset);
+  }
+
+  template <typename Type_t> Type_t *CqField(const uint32_t Offset) const {
+    return (Type_t *)(CqRing_ + Offset);
+  }
+
+public:
+  IoUring_t() = default;
+  IoUring_t(const IoUring_t &) = delete;
+  IoUring_t &operator=(const IoUring_t &) = delete;
+
+  ~IoUring_t() {
+    if (Sqes_) {
+      munmap(Sqes_, SqesSize_);
+    }
+
+    if (CqRing_ && CqRing_ != SqRing_) {
+      munmap(CqRing_, CqRingSize_);
+    }
+
+    if (SqRing_) {
+      munmap(SqRing_, SqRingSize_);
+    }
+
+    if (Fd_ != -1) {
+      close(Fd_);
+    }
+  }
+
+  //
+  // Set up an instance with room for `Entries` submissions; this fails if the
+  // kernel doesn't support io_uring, or if it has been disabled.
+  //
+
+  bool Setup(const uint32_t Entries) {
+    Fd_ = int(syscall(__NR_io_uring_setup, Entries, &Params_));
+    if (Fd_ < 0) {
+      Fd_ = -1;
+      return false;
+    }
+
+    SqRingSize_ =
+        Params_.sq_off.array + (Params_.sq_entries * sizeof(uint32_t));
+    CqRingSize_ =
+        Params_.cq_off.cqes + (Params_.cq_entries * sizeof(io_uring_cqe));
+
+    const bool SingleMap = Params_.features & IORING_FEAT_SINGLE_MMAP;
+    if (SingleMap) {
+      SqRingSize_ = std::max(SqRingSize_, CqRingSize_);
+    }
+
+    void *SqRing = mmap(nullptr, SqRingSize_, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, Fd_, IORING_OFF_SQ_RING);
+    if (SqRing == MAP_FAILED) {
+      return false;
+    }
+
+    SqRing_ = (uint8_t *)SqRing;
+    if (SingleMap) {
+      CqRing_ = SqRing_;
+    } else {
+      void *CqRing = mmap(nullptr, CqRingSize_, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, Fd_, IORING_OFF_CQ_RING);
+      if (CqRing == MAP_FAILED) {
+        return false;
+      }
+
+      CqRing_ = (uint8_t *)CqRing;
+    }
+
+    SqesSize_ = Params_.sq_entries * sizeof(io_uring_sqe);
+    void *Sqes = mmap(nullptr, SqesSize_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, Fd_, IORING_OFF_SQES);
+    if (Sqes == MAP_FAILED) {
+      return false;
+    }
+
+    Sqes_ = (io_uring_sqe *)Sqes;
+    return true;
+  }
+
+  uint32_t Entries() const { return Params_.sq_entries; }
+
+  //
+  // Queue a vectored read; it is only submitted by `Enter`. The submission
+  // queue can't be full, as there are never more reads in flight than it has
+  // entries.
+  //
+
+  void QueueRead(const int Fd, const iovec *Iov, const uint64_t Offset,
+                 const uint64_t UserData) {
+    const uint32_t Mask = *SqField<uint32_t>(Params_.sq_off.ring_mask);
+    uint32_t *Tail = SqField<uint32_t>(Params_.sq_off.tail);
+    const uint32_t Index = *Tail & Mask;
+
+    io_uring_sqe &Sqe = Sqes_[Index];
+    memset(&Sqe, 0, sizeof(Sqe));
+    Sqe.opcode = IORING_OP_READV;
+    Sqe.fd = Fd;
+    Sqe.addr = uint64_t(uintptr_t(Iov));
+    Sqe.len = 1;
+    Sqe.off = Offset;
+    Sqe.user_data = UserData;
+
+    SqField<uint32_t>(Params_.sq_off.array)[Index] = Index;
+    __atomic_store_n(Tail, *Tail + 1, __ATOMIC_RELEASE);
+  }
+
+  //
+  // Submit `ToSubmit` queued reads and wait for `MinComplete` of them to
+  // complete. Returns the number of reads submitted, or -errno.
+  //
+
+  int Enter(const uint32_t ToSubmit, const uint32_t MinComplete) {
+    const long Ret = syscall(__NR_io_uring_enter, Fd_, ToSubmit, MinComplete,
+                             IORING_ENTER_GETEVENTS, nullptr, 0);
+    return Ret < 0 ? -errno : int(Ret);
+  }
+
+  //
+  // Invoke `Function` with the user data and the result of every completed
+  // read.
+  //
+
+  template <typename Function_t> void Reap(const Function_t &Function) {
+    uint32_t *Head = CqField<uint32_t>(Params_.cq_off.head);
+    const uint32_t *Tail = CqField<uint32_t>(Params_.cq_off.tail);
+    const uint32_t Mask = *CqField<uint32_t>(Params_.cq_off.ring_mask);
+    const auto *Cqes = CqField<io_uring_cqe>(Params_.cq_off.cqes);
+
+    uint32_t Current = *Head;
+    const uint32_t Last = __atomic_load_n(Tail, __ATOMIC_ACQUIRE);
+    for (; Current != Last; Current++) {
+      const io_uring_cqe &Cqe = Cqes[Current & Mask];
+      Function(Cqe.user_data, Cqe.res);
+    }
+
+    __atomic_store_n(Head, Current, __ATOMIC_RELEASE);
+  }
+};
+
+//
+// Read ranges of a file with io_uring, keeping up to `QueueDepth` reads in
+// flight; `Callback` is invoked from the calling thread. Returns false if
+// io_uring isn't available, in which case nothing has been read.
+//
+
+inline bool IoUringRead(const char *PathFile,
+                        const std::vector<FileRange_t> &Ranges,
+                        const AsyncReadOptions_t &Options,
+                        const RangeReadCallback_t &Callback) {
+  IoUring_t Ring;
+  if (!Ring.Setup(std::max(Options.QueueDepth, 1u))) {
+    return false;
+  }
+
+  const int Fd = open(PathFile, O_RDONLY);
+  if (Fd < 0) {
+    Diagnostics::Report(Severity_t::Warning, DiagnosticCode_t::OpenFileFailed,
+                        "Could not open dump file: %s", strerror(errno));
+    return false;
+  }
+
+  //
+  // Every read in flight has a slot, with its buffer and its range.
+  //
+
+  struct Slot_t {
+    std::unique_ptr<uint8_t[]> Buffer;
+    iovec Iov = {};
+    uint64_t RangeIdx = 0;
+    bool Busy = false;
+  };
+
+  const uint32_t NumberOfSlots =
+      uint32_t(std::min(uint64_t(Ring.Entries()), uint64_t(Ranges.size())));
+  std::vector<Slot_t> Slots(NumberOfSlots);
+  std::vector<uint32_t> FreeSlots;
+  for (uint32_t SlotIdx = 0; SlotIdx < NumberOfSlots; SlotIdx++) {
+    FreeSlots.push_back(SlotIdx);
+  }
+
+  //
+  // Reads that the kernel asked to retry are queued again before the ranges
+  // that haven't been read yet.
+  //
+
+  std::vector<uint64_t> Retries;
+  uint64_t NextRangeIdx = 0;
+  uint32_t Queued = 0;
+  uint32_t InFlight = 0;
+  bool Failed = false;
+  while (!Failed &&
+         (NextRangeIdx < Ranges.size() || !Retries.empty() || InFlight)) {
+    while (!FreeSlots.empty() &&
+           (!Retries.empty() || NextRangeIdx < Ranges.size())) {
+      uint64_t RangeIdx = 0;
+      if (!Retries.empty()) {
+        RangeIdx = Retries.back();
+        Retries.pop_back();
+      } else {
+        RangeIdx = NextRangeIdx++;
+      }
+
+      const uint32_t SlotIdx = FreeSlots.back();
+      FreeSlots.pop_back();
+      Slot_t &Slot = Slots[SlotIdx];
+      const FileRange_t &Range = Ranges[RangeIdx];
+      if (!Slot.Buffer) {
+        Slot.Buffer = std::make_unique<uint8_t[]>(size_t(Options.MaxReadSize));
+      }
+
+      Slot.Iov.iov_base = Slot.Buffer.get();
+      Slot.Iov.iov_len = size_t(Range.Size);
+      Slot.RangeIdx = RangeIdx;
+      Slot.Busy = true;
+      Ring.QueueRead(Fd, &Slot.Iov, Range.Offset, SlotIdx);
+      Queued++;
+    }
+
+    const int Submitted = Ring.Enter(Queued, 1);
+    if (Submitted < 0) {
+      if (Submitted == -EINTR || Submitted == -EAGAIN ||
+          Submitted == -EBUSY) {
+        continue;
+      }
+
+      Diagnostics::Report(Severity_t::Error, DiagnosticCode_t::ReadFailed,
+                          "io_uring_enter failed: %s", strerror(-Submitted));
+      Failed = true;
+      break;
+    }
+
+    Queued -= uint32_t(Submitted);
+    InFlight += uint32_t(Submitted);
+    Ring.Reap([&](const uint64_t SlotIdx, const int Result) {
+      Slot_t &Slot = Slots[size_t(SlotIdx)];
+      Slot.Busy = false;
+      InFlight--;
+      FreeSlots.push_back(uint32_t(SlotIdx));
+      if (Result == -EAGAIN || Result == -EINTR) {
+        Retries.push_back(Slot.RangeIdx);
+        return;
+      }
+
+      if (Result < 0) {
+        Diagnostics::Report(Severity_t::Error, DiagnosticCode_t::ReadFailed,
+                            "Could not read dump file: %s", strerror(-Result));
+        Callback(Slot.RangeIdx, nullptr, 0);
+        return;
+      }
+
+      Callback(Slot.RangeIdx, Slot.Buffer.get(), uint64_t(Result));
+    });
+  }
+
+  //
+  // If the ring broke down, the reads that might still be in flight write to
+  // the buffers of their slots, which are leaked so that they outlive them.
+  // The ranges that haven't been read are failed.
+  //
+
+  if (Failed) {
+    for (auto &Slot : Slots) {
+      if (Slot.Busy) {
+        Slot.Buffer.release();
+        Callback(Slot.RangeIdx, nullptr, 0);
+      }
+    }
+
+    for (const uint64_t RangeIdx : Retries) {
+      Callback(RangeIdx, nullptr, 0);
+    }
+
+    for (; NextRangeIdx < Ranges.size(); NextRangeIdx++) {
+      Callback(NextRangeIdx, nullptr, 0);
+    }
+  }
+
+  close(Fd);
+  return true;
+}
+
+#endif
+
+} // namespace kdmpparser
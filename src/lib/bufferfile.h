@@ -0,0 +1,51 @@
+// Axel '0vercl0k' Souchet - October 17 2026
+#pragma once
+
+#include "filemap.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace kdmpparser {
+
+//
+// File backend that reads a dump that is in memory already, in a buffer owned
+// by the caller; the buffer needs to outlive the backend. The view of a dump
+// is expected to be readable up to a page past the end of its last page,
+// which a buffer can't promise, so the buffer isn't handed out as a view:
+// the pages are copied out of it like for `PreadFile_t`.
+//
+
+class BufferFile_t : public FileBackend_t {
+  const uint8_t *Buffer_ = nullptr;
+  uint64_t Size_ = 0;
+
+public:
+  BufferFile_t(const void *Buffer, const uint64_t Size)
+      : Buffer_((const uint8_t *)Buffer), Size_(Buffer ? Size : 0) {}
+
+  BufferFile_t(const BufferFile_t &) = delete;
+  BufferFile_t &operator=(const BufferFile_t &) = delete;
+
+  //
+  // There is no file to open; the buffer is the file.
+  //
+
+  bool Open(const char *) override { return Buffer_ != nullptr; }
+
+  uint64_t Size() const override { return Size_; }
+
+  uint64_t Read(const uint64_t Offset, void *Out,
+                const uint64_t Size) const override {
+    if (Offset >= Size_) {
+      return 0;
+    }
+
+    const uint64_t Available = std::min(Size, Size_ - Offset);
+    memcpy(Out, Buffer_ + Offset, size_t(Available));
+    return Available;
+  }
+};
+
+} // namespace kdmpparser
@@ -0,0 +1,420 @@
+// Axel '0vercl0k' Souchet - October 17 2026
+#pragma once
+
+#include "diagnostics.h"
+#include "filemap.h"
+#include "lrucache.h"
+#include "lz4.h"
+#include "parallel.h"
+#include "preadfile.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <system_error>
+#include <vector>
+
+namespace kdmpparser {
+
+//
+// A compressed dump is a header, followed by the dump cut in chunks of
+// `ChunkSize` bytes (the last one can be shorter) that are compressed one by
+// one as LZ4 blocks, followed by the index of the chunks. A chunk that
+// doesn't compress is stored as is. Reading a page only needs its chunk to be
+// decompressed. Everything is little-endian.
+//
+
+struct CompressedFileHeader_t {
+  static constexpr uint64_t ExpectedSignature = 0x3134'5a4c'504d'444b;
+  static constexpr uint32_t ExpectedVersion = 1;
+  static constexpr uint32_t DefaultChunkSize = 0x1'0000;
+  static constexpr uint32_t MaxChunkSize = 0x400'0000;
+
+  uint64_t Signature; // 'KDMPLZ41'
+  uint32_t Version;
+  uint32_t ChunkSize;
+  uint64_t UncompressedSize;
+  uint64_t NumberOfChunks;
+  uint64_t IndexOffset;
+};
+
+struct CompressedChunk_t {
+  enum class Kind_t : uint32_t { Lz4, Stored };
+
+  uint64_t Offset;
+  uint32_t CompressedSize;
+  Kind_t Kind;
+};
+
+static_assert(sizeof(CompressedFileHeader_t) == 0x28,
+              "CompressedFileHeader_t's size looks wrong.");
+static_assert(sizeof(CompressedChunk_t) == 0x10,
+              "CompressedChunk_t's size looks wrong.");
+
+//
+// File backend that reads a compressed dump. The chunks are decompressed the
+// first time they are read, and kept in a sharded LRU cache of at most
+// `CacheSize` bytes; to the parser, the file is the uncompressed dump.
+//
+
+class CompressedFile_t : public FileBackend_t {
+
+  //
+  // The compressed file; by default, it is read without a cache, as the
+  // decompressed chunks are cached instead.
+  //
+
+  std::unique_ptr<FileBackend_t> File_;
+
+  CompressedFileHeader_t Header_ = {};
+  std::vector<CompressedChunk_t> Chunks_;
+
+  using Chunk_t = std::shared_ptr<const std::vector<uint8_t>>;
+  mutable LruCache_t<Chunk_t> Cache_;
+  uint64_t CacheSize_ = 0;
+
+public:
+  //
+  // The compressed file is read through `File` if there is one, which is
+  // then opened by `Open`.
+  //
+
+  explicit CompressedFile_t(
+      const uint64_t CacheSize = PreadFile_t::DefaultCacheSize,
+      std::unique_ptr<FileBackend_t> File = nullptr)
+      : File_(std::move(File)), CacheSize_(CacheSize) {
+    if (!File_) {
+      File_ = std::make_unique<PreadFile_t>(Page::Size, 0);
+    }
+  }
+
+  CompressedFile_t(const CompressedFile_t &) = delete;
+  CompressedFile_t &operator=(const CompressedFile_t &) = delete;
+
+  //
+  // Is a file a compressed dump? This only looks at its signature.
+  //
+
+  static bool IsCompressedFile(const char *PathFile) {
+    FILE *File = fopen(PathFile, "rb");
+    if (File == nullptr) {
+      return false;
+    }
+
+    uint64_t Signature = 0;
+    const bool Success = fread(&Signature, sizeof(Signature), 1, File) == 1;
+    fclose(File);
+    return Success && Signature == CompressedFileHeader_t::ExpectedSignature;
+  }
+
+  static bool IsCompressedFile(const FileBackend_t &File) {
+    uint64_t Signature = 0;
+    return File.Read(0, &Signature, sizeof(Signature)) == sizeof(Signature) &&
+           Signature == CompressedFileHeader_t::ExpectedSignature;
+  }
+
+  uint32_t ChunkSize() const { return Header_.ChunkSize; }
+  uint64_t NumberOfChunks() const { return Header_.NumberOfChunks; }
+  uint64_t CompressedSize() const { return File_->Size(); }
+  uint64_t Size() const override { return Header_.UncompressedSize; }
+
+  bool Open(const char *PathFile) override {
+    return File_->Open(PathFile) && Load();
+  }
+
+  bool OpenDescriptor(const int Fd) override {
+    return File_->OpenDescriptor(Fd) && Load();
+  }
+
+  uint64_t Read(const uint64_t Offset, void *Out,
+                const uint64_t Size) const override {
+    if (Offset >= Header_.UncompressedSize) {
+      return 0;
+    }
+
+    const uint64_t Available =
+        std::min(Size, Header_.UncompressedSize - Offset);
+    uint8_t *Buffer = (uint8_t *)Out;
+    uint64_t BytesRead = 0;
+    while (BytesRead < Available) {
+      const uint64_t Current = Offset + BytesRead;
+      const uint64_t ChunkIdx = Current / Header_.ChunkSize;
+      const uint64_t ChunkOffset = Current % Header_.ChunkSize;
+      const Chunk_t &Chunk = LoadChunk(ChunkIdx);
+      if (!Chunk) {
+        break;
+      }
+
+      const uint64_t ChunkSize =
+          std::min(Available - BytesRead, Chunk->size() - ChunkOffset);
+      memcpy(Buffer + BytesRead, Chunk->data() + ChunkOffset,
+             size_t(ChunkSize));
+      BytesRead += ChunkSize;
+    }
+
+    return BytesRead;
+  }
+
+private:
+  //
+  // Read and check the header and the index of the compressed file.
+  //
+
+  bool Load() {
+    if (File_->Read(0, &Header_, sizeof(Header_)) != sizeof(Header_) ||
+        !HeaderLooksGood()) {
+      Diagnostics::Report(Severity_t::Error,
+                          DiagnosticCode_t::InvalidCompressedFile,
+                          "The header of the compressed dump looks wrong.");
+      return false;
+    }
+
+    Chunks_.resize(size_t(Header_.NumberOfChunks));
+    const uint64_t IndexSize = Header_.NumberOfChunks * sizeof(Chunks_[0]);
+    if (File_->Read(Header_.IndexOffset, Chunks_.data(), IndexSize) !=
+        IndexSize) {
+      Diagnostics::Report(Severity_t::Error,
+                          DiagnosticCode_t::InvalidCompressedFile,
+                          "Could not read the index of the compressed dump.");
+      return false;
+    }
+
+    for (uint64_t ChunkIdx = 0; ChunkIdx < Header_.NumberOfChunks;
+         ChunkIdx++) {
+      if (!ChunkLooksGood(ChunkIdx)) {
+        Diagnostics::Report(Severity_t::Error,
+                            DiagnosticCode_t::InvalidCompressedFile,
+                            "The chunk %" PRIu64
+                            " of the compressed dump looks wrong.",
+                            ChunkIdx);
+        return false;
+      }
+    }
+
+    Cache_.SetCapacity(CacheSize_ / Header_.ChunkSize);
+    return true;
+  }
+
+  bool HeaderLooksGood() const {
+    if (Header_.Signature != CompressedFileHeader_t::ExpectedSignature ||
+        Header_.Version != CompressedFileHeader_t::ExpectedVersion) {
+      return false;
+    }
+
+    if (Header_.ChunkSize == 0 || Page::Offset(Header_.ChunkSize) ||
+        Header_.ChunkSize > CompressedFileHeader_t::MaxChunkSize) {
+      return false;
+    }
+
+    const uint64_t NumberOfChunks =
+        (Header_.UncompressedSize / Header_.ChunkSize) +
+        ((Header_.UncompressedSize % Header_.ChunkSize) ? 1 : 0);
+    if (Header_.NumberOfChunks != NumberOfChunks) {
+      return false;
+    }
+
+    const uint64_t FileSize = File_->Size();
+    return Header_.IndexOffset <= FileSize &&
+           Header_.NumberOfChunks <= ((FileSize - Header_.IndexOffset) /
+                                      sizeof(CompressedChunk_t));
+  }
+
+  uint64_t UncompressedChunkSize(const uint64_t ChunkIdx) const {
+    return std::min(uint64_t(Header_.ChunkSize),
+                    Header_.UncompressedSize - (ChunkIdx * Header_.ChunkSize));
+  }
+
+  bool ChunkLooksGood(const uint64_t ChunkIdx) const {
+    const CompressedChunk_t &Chunk = Chunks_[size_t(ChunkIdx)];
+    if (Chunk.Offset > Header_.IndexOffset ||
+        Chunk.CompressedSize > (Header_.IndexOffset - Chunk.Offset)) {
+      return false;
+    }
+
+    const uint64_t Size = UncompressedChunkSize(ChunkIdx);
+    switch (Chunk.Kind) {
+    case CompressedChunk_t::Kind_t::Lz4: {
+      return Chunk.CompressedSize <= Lz4::CompressBound(size_t(Size));
+    }
+
+    case CompressedChunk_t::Kind_t::Stored: {
+      return Chunk.CompressedSize == Size;
+    }
+    }
+
+    return false;
+  }
+
+  //
+  // Get a decompressed chunk, decompressing it if it isn't in the cache;
+  // nullptr is returned if it couldn't be read or decompressed.
+  //
+
+  Chunk_t LoadChunk(const uint64_t ChunkIdx) const {
+    if (const auto &Cached = Cache_.Lookup(ChunkIdx)) {
+      return *Cached;
+    }
+
+    const CompressedChunk_t &Chunk = Chunks_[size_t(ChunkIdx)];
+    const uint64_t Size = UncompressedChunkSize(ChunkIdx);
+    auto Data = std::make_shared<std::vector<uint8_t>>(size_t(Size));
+    if (Chunk.Kind == CompressedChunk_t::Kind_t::Stored) {
+      if (File_->Read(Chunk.Offset, Data->data(), Size) != Size) {
+        return nullptr;
+      }
+    } else {
+      thread_local std::vector<uint8_t> Compressed;
+      Compressed.resize(Chunk.CompressedSize);
+      if (File_->Read(Chunk.Offset, Compressed.data(), Chunk.CompressedSize) !=
+          Chunk.CompressedSize) {
+        return nullptr;
+      }
+
+      if (Lz4::Decompress(Compressed.data(), Compressed.size(), Data->data(),
+                          Data->size()) != Size) {
+        Diagnostics::Report(Severity_t::Error,
+                            DiagnosticCode_t::InvalidCompressedFile,
+                            "The chunk %" PRIu64 " could not be decompressed.",
+                            ChunkIdx);
+        return nullptr;
+      }
+    }
+
+    Chunk_t Decompressed = std::move(Data);
+    Cache_.Insert(ChunkIdx, Decompressed);
+    return Decompressed;
+  }
+};
+
+//
+// Compress a dump into a compressed dump, with chunks of `ChunkSize` bytes
+// that are compressed by `NumberOfThreads` threads (0 uses one per hardware
+// thread). The compressed dump is written next to `OutputPath` first, and
+// renamed once it is complete. Failures are reported as diagnostics.
+//
+
+inline bool CompressFile(
+    const char *InputPath, const char *OutputPath,
+    const uint32_t ChunkSize = CompressedFileHeader_t::DefaultChunkSize,
+    const uint32_t NumberOfThreads = 0) {
+  if (ChunkSize == 0 || Page::Offset(ChunkSize) ||
+      ChunkSize > CompressedFileHeader_t::MaxChunkSize) {
+    Diagnostics::Report(Severity_t::Error,
+                        DiagnosticCode_t::InvalidCompressedFile,
+                        "The chunk size needs to be a multiple of the page "
+                        "size, and at most %" PRIu32 " bytes.",
+                        CompressedFileHeader_t::MaxChunkSize);
+    return false;
+  }
+
+  PreadFile_t Input(Page::Size, 0);
+  if (!Input.Open(InputPath)) {
+    return false;
+  }
+
+  CompressedFileHeader_t Header = {};
+  Header.Signature = CompressedFileHeader_t::ExpectedSignature;
+  Header.Version = CompressedFileHeader_t::ExpectedVersion;
+  Header.ChunkSize = ChunkSize;
+  Header.UncompressedSize = Input.Size();
+  Header.NumberOfChunks = (Input.Size() / ChunkSize) +
+                          ((Input.Size() % ChunkSize) ? 1 : 0);
+
+  const auto &TempPath = TemporaryPathFor(OutputPath);
+  FILE *Output = fopen(TempPath.string().c_str(), "wb");
+  if (Output == nullptr) {
+    Diagnostics::Report(Severity_t::Error, DiagnosticCode_t::OpenFileFailed,
+                        "Could not create %s.", TempPath.string().c_str());
+    return false;
+  }
+
+  //
+  // The chunks are compressed in batches, one per thread, and written in
+  // order.
+  //
+
+  const uint64_t BatchSize = ResolveNumberOfThreads(NumberOfThreads) * 4;
+  std::vector<CompressedChunk_t> Chunks(size_t(Header.NumberOfChunks));
+  std::vector<std::vector<uint8_t>> Compressed(BatchSize);
+  uint64_t Offset = sizeof(Header);
+  bool Success = fwrite(&Header, sizeof(Header), 1, Output) == 1;
+  for (uint64_t FirstChunkIdx = 0;
+       Success && FirstChunkIdx < Header.NumberOfChunks;
+       FirstChunkIdx += BatchSize) {
+    const uint64_t NumberOfChunks =
+        std::min(BatchSize, Header.NumberOfChunks - FirstChunkIdx);
+    //
+    // The flags are written by several threads, so they can't be packed in
+    // bits like a vector of bools does.
+    //
+
+    std::vector<uint8_t> Failed(size_t(NumberOfChunks), 0);
+    ParallelFor(NumberOfThreads, NumberOfChunks, [&](const uint64_t BatchIdx) {
+      const uint64_t ChunkIdx = FirstChunkIdx + BatchIdx;
+      const uint64_t ChunkOffset = ChunkIdx * ChunkSize;
+      const uint64_t Size =
+          std::min(uint64_t(ChunkSize), Header.UncompressedSize - ChunkOffset);
+
+      thread_local std::vector<uint8_t> Chunk;
+      Chunk.resize(size_t(Size));
+      if (Input.Read(ChunkOffset, Chunk.data(), Size) != Size) {
+        Failed[size_t(BatchIdx)] = 1;
+        return;
+      }
+
+      auto &Out = Compressed[size_t(BatchIdx)];
+      Out.resize(Lz4::CompressBound(size_t(Size)));
+      const size_t CompressedSize =
+          Lz4::Compress(Chunk.data(), Chunk.size(), Out.data(), Size - 1);
+
+      CompressedChunk_t &Entry = Chunks[size_t(ChunkIdx)];
+      if (CompressedSize == 0) {
+        Entry.Kind = CompressedChunk_t::Kind_t::Stored;
+        Out.assign(Chunk.begin(), Chunk.end());
+      } else {
+        Entry.Kind = CompressedChunk_t::Kind_t::Lz4;
+        Out.resize(CompressedSize);
+      }
+
+      Entry.CompressedSize = uint32_t(Out.size());
+    });
+
+    for (uint64_t BatchIdx = 0; Success && BatchIdx < NumberOfChunks;
+         BatchIdx++) {
+      const auto &Out = Compressed[size_t(BatchIdx)];
+      CompressedChunk_t &Entry = Chunks[size_t(FirstChunkIdx + BatchIdx)];
+      Entry.Offset = Offset;
+      Success = !Failed[size_t(BatchIdx)] &&
+                fwrite(Out.data(), 1, Out.size(), Output) == Out.size();
+      Offset += Out.size();
+    }
+  }
+
+  Header.IndexOffset = Offset;
+  Success = Success &&
+            fwrite(Chunks.data(), sizeof(Chunks[0]), Chunks.size(), Output) ==
+                Chunks.size() &&
+            fseek(Output, 0, SEEK_SET) == 0 &&
+            fwrite(&Header, sizeof(Header), 1, Output) == 1;
+  Success = fclose(Output) == 0 && Success;
+
+  std::error_code Ec;
+  if (Success) {
+    std::filesystem::rename(TempPath, OutputPath, Ec);
+    Success = !Ec;
+  }
+
+  if (!Success) {
+    Diagnostics::Report(Severity_t::Error, DiagnosticCode_t::ReadFailed,
+                        "Could not write the compressed dump.");
+    std::filesystem::remove(TempPath, Ec);
+  }
+
+  return Success;
+}
+
+} // namespace kdmpparser
@@ -0,0 +1,132 @@
+// Axel '0vercl0k' Souchet - October 17 2026
+#pragma once
+
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+
+//
+// Define KDMPPARSER_DIAGNOSTICS to 0 to compile every diagnostic out of the
+// library.
+//
+
+#ifndef KDMPPARSER_DIAGNOSTICS
+#define KDMPPARSER_DIAGNOSTICS 1
+#endif
+
+namespace kdmpparser {
+
+enum class Severity_t : uint32_t { Debug, Info, Warning, Error };
+
+//
+// What a diagnostic is about; the message only adds details for humans.
+//
+
+enum class DiagnosticCode_t : uint32_t {
+  FileNotFound,
+  OpenFileFailed,
+  FileSizeFailed,
+  MapViewFailed,
+  MapFileFailed,
+  ReadFailed,
+  AdviseFailed,
+  LockFailed,
+  InvalidCompressedFile,
+  InvalidSignature,
+  InvalidValidDump,
+  InvalidPhysicalMemoryBlock,
+  InvalidBmpHeader,
+  InvalidRdmpHeader,
+  InvalidContext,
+  UnsupportedDumpType,
+  UnknownDumpType,
+  InvalidHeader,
+  BuildPhysmemFailed,
+  InvalidPml4e,
+  InvalidPdpte,
+  InvalidPde,
+  InvalidPte,
+  MissingPagingStructure,
+};
+
+struct Diagnostic_t {
+  Severity_t Severity;
+  DiagnosticCode_t Code;
+
+  //
+  // The message is only valid for the duration of the callback.
+  //
+
+  const char *Message;
+};
+
+using DiagnosticCallback_t = std::function<void(const Diagnostic_t &)>;
+
+//
+// The library reports its failures to a process-wide callback. Failing
+// address translations are reported as `Debug` diagnostics, which are below
+// the default minimum severity, so that probing unmapped addresses costs a
+// single comparison. The callback can be invoked by several threads at the
+// same time.
+//
+
+namespace Diagnostics {
+
+//
+// The default callback; it writes the message to stdout.
+//
+
+inline void Print(const Diagnostic_t &Diagnostic) {
+  printf("%s\n", Diagnostic.Message);
+}
+
+inline DiagnosticCallback_t Callback_ = Print;
+inline Severity_t MinimumSeverity_ = Severity_t::Info;
+
+//
+// Set the callback receiving the diagnostics that are at least
+// `MinimumSeverity`; nullptr silences the library. This isn't safe to call
+// while the library is used by other threads.
+//
+
+inline void SetCallback(const DiagnosticCallback_t &Callback,
+                        const Severity_t MinimumSeverity = Severity_t::Info) {
+  Callback_ = Callback;
+  MinimumSeverity_ = MinimumSeverity;
+}
+
+inline bool Enabled(const Severity_t Severity) {
+#if KDMPPARSER_DIAGNOSTICS
+  return Severity >= MinimumSeverity_ && Callback_ != nullptr;
+#else
+  (void)Severity;
+  return false;
+#endif
+}
+
+//
+// Report a diagnostic; the message is only formatted if somebody listens.
+//
+
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((format(printf, 3, 4)))
+#endif
+inline void
+Report(const Severity_t Severity, const DiagnosticCode_t Code,
+       const char *Format, ...) {
+  if (!Enabled(Severity)) {
+    return;
+  }
+
+  char Message[512];
+  va_list Args;
+  va_start(Args, Format);
+  vsnprintf(Message, sizeof(Message), Format, Args);
+  va_end(Args);
+
+  Callback_(Diagnostic_t{Severity, Code, Message});
+}
+
+} // namespace Diagnostics
+} // namespace kdmpparser
@@ -1,15 +1,32 @@
 // Axel '0vercl0k' Souchet - April 28 2020
+#pragma once
+
+#include "diagnostics.h"
 #include "platform.h"
+#include <algorithm>
+#include <chrono>
 #include <cstdint>
 #include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
 
-#if defined(LINUX)
+#if defined(WINDOWS)
+#include <io.h>
+#elif defined(LINUX)
 #include <errno.h>
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
+#if defined(__linux__)
+#include <sys/vfs.h>
+#endif
 #endif
 
 namespace kdmpparser {
@@ -34,8 +51,256 @@ constexpr uint64_t Align(const uint64_t Address) { return Address & ~0xfff; }
 constexpr uint64_t Offset(const uint64_t Address) { return Address & 0xfff; }
 } // namespace Page
 
+//
+// A range of a file.
+//
+
+struct FileRange_t {
+  uint64_t Offset = 0;
+  uint64_t Size = 0;
+};
+
+//
+// How a range of the dump file is about to be accessed; these are hints given
+// to the operating system so that it reads ahead, stops reading ahead,
+// prefetches or releases the pages of the file.
+//
+
+enum class AccessHint_t : uint32_t {
+  Normal,
+  Sequential,
+  Random,
+  WillNeed,
+  DontNeed
+};
+
+//
+// How the dump file is accessed. The parser reads the file either through a
+// view of the whole file (see `FileMap_t`), or by copying the parts it needs
+// out of it; the view is what lets it hand out pointers to the content of the
+// pages without a copy.
+//
+
+class FileBackend_t {
+public:
+  virtual ~FileBackend_t() = default;
+
+  //
+  // Open a file; failures are reported as diagnostics.
+  //
+
+  virtual bool Open(const char *PathFile) = 0;
+
+  //
+  // Open a file from a descriptor that stays owned by the caller; the backend
+  // works on a duplicate of it, so it can be closed once this returns.
+  // Returns false if the backend can't read from a descriptor, or if it
+  // failed; failures are reported as diagnostics.
+  //
+
+  virtual bool OpenDescriptor(const int) { return false; }
+
+  //
+  // Get the size of the file.
+  //
+
+  virtual uint64_t Size() const = 0;
+
+  //
+  // Get the base of a view of the whole file, or nullptr if the backend
+  // doesn't map the file.
+  //
+
+  virtual const uint8_t *ViewBase() const { return nullptr; }
+
+  //
+  // Read `Size` bytes at `Offset` in the file. This can be called by several
+  // threads at the same time. Returns the number of bytes written to `Out`,
+  // which is less than `Size` if the read goes past the end of the file or
+  // failed.
+  //
+
+  virtual uint64_t Read(const uint64_t Offset, void *Out,
+                        const uint64_t Size) const = 0;
+
+  //
+  // Tell the operating system how `Size` bytes at `Offset` in the file are
+  // about to be accessed; a `Size` of 0 covers the rest of the file. Backends
+  // that have no use for hints ignore them. Returns false if the hint couldn't
+  // be applied.
+  //
+
+  virtual bool Advise(const AccessHint_t, const uint64_t,
+                      const uint64_t) const {
+    return true;
+  }
+
+  //
+  // Lock `Size` bytes at `Offset` in the file in memory, so that accessing
+  // them never faults; a `Size` of 0 covers the rest of the file. Returns
+  // false if the backend has nothing to lock, or if it couldn't be done.
+  //
+
+  virtual bool Lock(const uint64_t, const uint64_t) const { return false; }
+};
+
+//
+// How the view of a mapped file is set up.
+//
+
+struct MapOptions_t {
+
+  //
+  // Read every page of the file in when it is mapped, instead of the first
+  // time each of them is accessed.
+  //
+
+  bool Populate = false;
+
+  //
+  // Lock the whole view in memory.
+  //
+
+  bool Lock = false;
+
+  //
+  // When the file is hosted in memory already (tmpfs or hugetlbfs), copy it
+  // into anonymous memory backed by transparent huge pages instead of mapping
+  // it, so that the view needs a lot fewer TLB entries. Only on Linux.
+  //
+
+  bool HugePages = false;
+};
+
+//
+// How long setting up the view of a mapped file took, as a whole and for each
+// of the options that have been asked for, and which of them have been
+// applied. Populating happens while the file is mapped, or copied, so that
+// duration is the one of the mapping itself; it is part of `HugePagesTime`
+// when the file is copied.
+//
+
+struct MapReport_t {
+  std::chrono::microseconds MapTime{0};
+  bool Populated = false;
+  std::chrono::microseconds PopulateTime{0};
+  bool Locked = false;
+  std::chrono::microseconds LockTime{0};
+  bool HugePages = false;
+  std::chrono::microseconds HugePagesTime{0};
+};
+
+//
+// Measure how long a function takes.
+//
+
+template <typename Function_t>
+std::chrono::microseconds Measure(const Function_t &Function) {
+  const auto Start = std::chrono::steady_clock::now();
+  Function();
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - Start);
+}
+
+//
+// Ranges of a view that have been locked in memory. Releasing them wouldn't
+// work on Linux, and would unlock them on Windows, which is why the pages of
+// a view are released around them.
+//
+
+class LockedRanges_t {
+  using Range_t = std::pair<uint64_t, uint64_t>;
+
+  //
+  // The [start, end) ranges, sorted by start; they can overlap.
+  //
+
+  std::vector<Range_t> Ranges_;
+  mutable std::mutex Lock_;
+
+public:
+  void Add(const uint64_t Start, const uint64_t End) {
+    std::lock_guard<std::mutex> Lock(Lock_);
+    const Range_t Range = {Start, End};
+    Ranges_.insert(std::upper_bound(Ranges_.begin(), Ranges_.end(), Range),
+                   Range);
+  }
+
+  //
+  // Get the parts of [Start, End) that aren't locked.
+  //
+
+  std::vector<Range_t> Unlocked(const uint64_t Start,
+                                const uint64_t End) const {
+    std::lock_guard<std::mutex> Lock(Lock_);
+    std::vector<Range_t> Gaps;
+    uint64_t Current = Start;
+    for (const auto &[RangeStart, RangeEnd] : Ranges_) {
+      if (RangeStart >= End) {
+        break;
+      }
+
+      if (RangeEnd <= Current) {
+        continue;
+      }
+
+      if (RangeStart > Current) {
+        Gaps.emplace_back(Current, RangeStart);
+      }
+
+      Current = RangeEnd;
+    }
+
+    if (Current < End) {
+      Gaps.emplace_back(Current, End);
+    }
+
+    return Gaps;
+  }
+};
+
+//
+// Get a path next to `Path` to write a file to before renaming it to `Path`.
+// It is unique to the process and to the call, so that processes writing the
+// same file don't write over each other's temporary file.
+//
+
+inline std::filesystem::path
+TemporaryPathFor(const std::filesystem::path &Path) {
 #if defined(WINDOWS)
-class FileMap_t {
+  const uint64_t ProcessId = GetCurrentProcessId();
+#else
+  const uint64_t ProcessId = uint64_t(getpid());
+#endif
+
+  std::random_device Random;
+  std::filesystem::path TempPath = Path;
+  TempPath += "." + std::to_string(ProcessId) + "." +
+              std::to_string(Random()) + ".tmp";
+  return TempPath;
+}
+
+#if defined(WINDOWS)
+
+//
+// Duplicate the handle behind a file descriptor; nullptr if it failed.
+//
+
+inline HANDLE DuplicateFileDescriptor(const int Fd) {
+  const HANDLE File = HANDLE(_get_osfhandle(Fd));
+  HANDLE Duplicate = nullptr;
+  if (File == INVALID_HANDLE_VALUE ||
+      !DuplicateHandle(GetCurrentProcess(), File, GetCurrentProcess(),
+                       &Duplicate, 0, FALSE, DUPLICATE_SAME_ACCESS)) {
+    Diagnostics::Report(Severity_t::Error, DiagnosticCode_t::OpenFileFailed,
+                        "Could not duplicate the file descriptor %d.", Fd);
+    return nullptr;
+  }
+
+  return Duplicate;
+}
+
+class FileMap_t : public FileBackend_t {
   //
   // Handle to the input file.
   //
@@ -55,11 +320,26 @@ class FileMap_t {
   PVOID ViewBase_ = nullptr;
 
   //
-  // File size
+  // Size of the view; it is the file size rounded up to the next page, plus
+  // a page.
+  //
+
+  uint64_t ViewSize_ = 0;
+
+  //
+  // File size.
   //
 
   uint64_t FileSize_ = 0;
 
+  //
+  // How the view is set up, and how long it took.
+  //
+
+  MapOptions_t Options_;
+  MapReport_t Report_;
+  mutable LockedRanges_t Locked_;
+
 public:
   ~FileMap_t() {
     //
@@ -90,25 +370,30 @@ public:
     }
   }
 
-  FileMap_t() = default;
+  explicit FileMap_t(const MapOptions_t &Options = {}) : Options_(Options) {}
   FileMap_t(const FileMap_t &) = delete;
   FileMap_t &operator=(const FileMap_t &) = delete;
 
-  constexpr void *ViewBase() const { return ViewBase_; }
+  const uint8_t *ViewBase() const override { return (uint8_t *)ViewBase_; }
+  uint64_t Size() const override { return FileSize_; }
+  bool Open(const char *PathFile) override { return MapFile(PathFile); }
+  const MapReport_t &Report() const { return Report_; }
+
+  bool OpenDescriptor(const int Fd) override {
+    const auto Start = std::chrono::steady_clock::now();
+    const HANDLE File = DuplicateFileDescriptor(Fd);
+    return File != nullptr && MapHandle(File, Start);
+  }
 
   bool MapFile(const char *PathFile) {
-    bool Success = true;
-    HANDLE File = nullptr;
-    HANDLE FileMap = nullptr;
-    PVOID ViewBase = nullptr;
-    LARGE_INTEGER FileSize = {0};
+    const auto Start = std::chrono::steady_clock::now();
 
     //
     // Open the dump file in read-only.
     //
 
-    File = CreateFileA(PathFile, GENERIC_READ, FILE_SHARE_READ, nullptr,
-                       OPEN_EXISTING, 0, nullptr);
+    const HANDLE File = CreateFileA(PathFile, GENERIC_READ, FILE_SHARE_READ,
+                                    nullptr, OPEN_EXISTING, 0, nullptr);
 
     if (File == nullptr) {
 
@@ -117,16 +402,34 @@ public:
       //
 
       const DWORD GLE = GetLastError();
-      printf("CreateFile failed with GLE=%lu.\n", GLE);
-
       if (GLE == ERROR_FILE_NOT_FOUND) {
-        printf("  The file %s was not found.\n", PathFile);
+        Diagnostics::Report(Severity_t::Error, DiagnosticCode_t::FileNotFound,
+                            "CreateFile failed with GLE=%lu; the file %s was "
+                            "not found.",
+                            GLE, PathFile);
+      } else {
+        Diagnostics::Report(Severity_t::Error,
+                            DiagnosticCode_t::OpenFileFailed,
+                            "CreateFile failed with GLE=%lu.", GLE);
       }
 
-      Success = false;
-      goto clean;
+      return false;
     }
 
+    return MapHandle(File, Start);
+  }
+
+  //
+  // Map a view of an open file; the handle is owned by the object from now on.
+  //
+
+  bool MapHandle(HANDLE File,
+                 const std::chrono::steady_clock::time_point Start) {
+    bool Success = true;
+    HANDLE FileMap = nullptr;
+    PVOID ViewBase = nullptr;
+    LARGE_INTEGER FileSize = {0};
+
     //
     // Create the ro file mapping.
     //
@@ -141,7 +444,8 @@ public:
       //
 
       const DWORD GLE = GetLastError();
-      printf("CreateFileMapping failed with GLE=%lu.\n", GLE);
+      Diagnostics::Report(Severity_t::Error, DiagnosticCode_t::MapViewFailed,
+                          "CreateFileMapping failed with GLE=%lu.", GLE);
       Success = false;
       goto clean;
     }
@@ -159,7 +463,8 @@ public:
       //
 
       const DWORD GLE = GetLastError();
-      printf("MapViewOfFile failed with GLE=%lu.\n", GLE);
+      Diagnostics::Report(Severity_t::Error, DiagnosticCode_t::MapViewFailed,
+                          "MapViewOfFile failed with GLE=%lu.", GLE);
       Success = false;
       goto clean;
     }
@@ -170,12 +475,14 @@ public:
 
     if (!GetFileSizeEx(File, &FileSize)) {
       const DWORD GLE = GetLastError();
-      printf("GetFileSizeEx failed with GLE=%lu.\n", GLE);
+      Diagnostics::Report(Severity_t::Error, DiagnosticCode_t::FileSizeFailed,
+                          "GetFileSizeEx failed with GLE=%lu.", GLE);
       Success = false;
       goto clean;
     }
 
-    FileSize_ = Page::Align(FileSize.QuadPart) + Page::Size;
+    FileSize_ = FileSize.QuadPart;
+    ViewSize_ = Page::Align(FileSize_) + Page::Size;
 
     //
     // Everything went well, so grab a copy of the handles for
@@ -191,6 +498,27 @@ public:
     ViewBase_ = ViewBase;
     ViewBase = nullptr;
 
+    //
+    // There are no huge pages for file mappings, so only populating and
+    // locking the view is supported. Failing to do either isn't fatal; it
+    // shows in the report.
+    //
+
+    if (Options_.Populate) {
+      Report_.PopulateTime = Measure([&]() {
+        WIN32_MEMORY_RANGE_ENTRY Range = {ViewBase_, SIZE_T(FileSize_)};
+        Report_.Populated =
+            PrefetchVirtualMemory(GetCurrentProcess(), 1, &Range, 0);
+      });
+    }
+
+    if (Options_.Lock) {
+      Report_.LockTime = Measure([&]() { Report_.Locked = Lock(0, 0); });
+    }
+
+    Report_.MapTime = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - Start);
+
   clean:
 
     //
@@ -214,8 +542,75 @@ public:
     return Success;
   }
 
+  uint64_t Read(const uint64_t Offset, void *Out,
+                const uint64_t Size) const override {
+    if (Offset >= FileSize_) {
+      return 0;
+    }
+
+    const uint64_t Available = std::min(Size, FileSize_ - Offset);
+    memcpy(Out, (uint8_t *)ViewBase_ + Offset, size_t(Available));
+    return Available;
+  }
+
+  //
+  // Only prefetching and releasing pages have an equivalent; releasing them
+  // means trimming them from the working set of the process. Unlocking pages
+  // that aren't locked is what does it, which is why that failure is
+  // expected.
+  //
+
+  bool Advise(const AccessHint_t Hint, const uint64_t Offset,
+              const uint64_t Size) const override {
+    if (ViewBase_ == nullptr || Offset >= FileSize_) {
+      return false;
+    }
+
+    const uint64_t Available =
+        (Size == 0) ? FileSize_ - Offset : std::min(Size, FileSize_ - Offset);
+    uint8_t *Address = (uint8_t *)ViewBase_ + Offset;
+    if (Hint == AccessHint_t::WillNeed) {
+      WIN32_MEMORY_RANGE_ENTRY Range = {Address, SIZE_T(Available)};
+      return PrefetchVirtualMemory(GetCurrentProcess(), 1, &Range, 0);
+    }
+
+    if (Hint == AccessHint_t::DontNeed) {
+      const uint64_t Start = Page::Align(Offset);
+      const uint64_t End = Page::Align(Offset + Available + Page::Size - 1);
+      bool Success = true;
+      for (const auto &[GapStart, GapEnd] : Locked_.Unlocked(Start, End)) {
+        Success &= VirtualUnlock((uint8_t *)ViewBase_ + GapStart,
+                                 SIZE_T(GapEnd - GapStart)) ||
+                   GetLastError() == ERROR_NOT_LOCKED;
+      }
+
+      return Success;
+    }
+
+    return true;
+  }
+
+  bool Lock(const uint64_t Offset, const uint64_t Size) const override {
+    if (ViewBase_ == nullptr || Offset >= FileSize_) {
+      return false;
+    }
+
+    const uint64_t Available =
+        (Size == 0) ? FileSize_ - Offset : std::min(Size, FileSize_ - Offset);
+    if (!VirtualLock((uint8_t *)ViewBase_ + Offset, SIZE_T(Available))) {
+      const DWORD GLE = GetLastError();
+      Diagnostics::Report(Severity_t::Warning, DiagnosticCode_t::LockFailed,
+                          "VirtualLock failed with GLE=%lu.", GLE);
+      return false;
+    }
+
+    Locked_.Add(Page::Align(Offset),
+                Page::Align(Offset + Available + Page::Size - 1));
+    return true;
+  }
+
   bool InBounds(const void *Ptr, const size_t Size) const {
-    const uint8_t *ViewEnd = (uint8_t *)ViewBase_ + FileSize_;
+    const uint8_t *ViewEnd = (uint8_t *)ViewBase_ + ViewSize_;
     const uint8_t *PtrEnd = (uint8_t *)Ptr + Size;
     return PtrEnd > Ptr && ViewEnd > ViewBase_ && Ptr >= ViewBase_ &&
            PtrEnd < ViewEnd;
@@ -224,11 +619,96 @@ public:
 
 #elif defined(LINUX)
 
-class FileMap_t {
+//
+// Apply a hint to a range of an open file. The hints only affect the page
+// cache, so they aren't an error on the systems that don't have them.
+//
+
+inline bool AdviseFile(const int Fd, const AccessHint_t Hint,
+                       const uint64_t Offset, const uint64_t Size) {
+#if defined(POSIX_FADV_NORMAL)
+  int Advice = POSIX_FADV_NORMAL;
+  switch (Hint) {
+  case AccessHint_t::Normal: {
+    Advice = POSIX_FADV_NORMAL;
+    break;
+  }
+
+  case AccessHint_t::Sequential: {
+    Advice = POSIX_FADV_SEQUENTIAL;
+    break;
+  }
+
+  case AccessHint_t::Random: {
+    Advice = POSIX_FADV_RANDOM;
+    break;
+  }
+
+  case AccessHint_t::WillNeed: {
+    Advice = POSIX_FADV_WILLNEED;
+    break;
+  }
+
+  case AccessHint_t::DontNeed: {
+    Advice = POSIX_FADV_DONTNEED;
+    break;
+  }
+  }
+
+  const int Error = posix_fadvise(Fd, off_t(Offset), off_t(Size), Advice);
+  if (Error != 0) {
+    Diagnostics::Report(Severity_t::Warning, DiagnosticCode_t::AdviseFailed,
+                        "posix_fadvise failed: %s", strerror(Error));
+    return false;
+  }
+#else
+  (void)Fd;
+  (void)Hint;
+  (void)Offset;
+  (void)Size;
+#endif
+
+  return true;
+}
+
+//
+// Duplicate a file descriptor; -1 if it failed.
+//
+
+inline int DuplicateFileDescriptor(const int Fd) {
+  const int Duplicate = fcntl(Fd, F_DUPFD_CLOEXEC, 0);
+  if (Duplicate < 0) {
+    Diagnostics::Report(Severity_t::Error, DiagnosticCode_t::OpenFileFailed,
+                        "Could not duplicate the file descriptor %d: %s", Fd,
+                        strerror(errno));
+  }
+
+  return Duplicate;
+}
+
+class FileMap_t : public FileBackend_t {
   void *ViewBase_ = nullptr;
   off_t ViewSize_ = 0;
+  uint64_t FileSize_ = 0;
   int Fd_ = -1;
 
+  //
+  // Is the view a copy of the file in anonymous memory? Releasing its pages
+  // would zero them, so the hints aren't applied to it.
+  //
+
+  bool Anonymous_ = false;
+
+  //
+  // How the view is set up, and how long it took.
+  //
+
+  MapOptions_t Options_;
+  MapReport_t Report_;
+  mutable LockedRanges_t Locked_;
+
+  static constexpr uint64_t HugePageSize = 0x20'0000;
+
 public:
   ~FileMap_t() {
     if (ViewBase_) {
@@ -243,32 +723,190 @@ public:
     }
   }
 
-  FileMap_t() = default;
+  explicit FileMap_t(const MapOptions_t &Options = {}) : Options_(Options) {}
   FileMap_t(const FileMap_t &) = delete;
   FileMap_t &operator=(const FileMap_t &) = delete;
 
-  constexpr void *ViewBase() const { return ViewBase_; }
+  const uint8_t *ViewBase() const override { return (uint8_t *)ViewBase_; }
+  uint64_t Size() const override { return FileSize_; }
+  bool Open(const char *PathFile) override { return MapFile(PathFile); }
+  const MapReport_t &Report() const { return Report_; }
+
+  bool OpenDescriptor(const int Fd) override {
+    const auto Start = std::chrono::steady_clock::now();
+    Fd_ = DuplicateFileDescriptor(Fd);
+    return Fd_ >= 0 && MapDescriptor(Start);
+  }
 
   bool MapFile(const char *PathFile) {
+    const auto Start = std::chrono::steady_clock::now();
     Fd_ = open(PathFile, O_RDONLY);
     if (Fd_ < 0) {
-      perror("Could not open dump file");
+      const DiagnosticCode_t Code = errno == ENOENT
+                                        ? DiagnosticCode_t::FileNotFound
+                                        : DiagnosticCode_t::OpenFileFailed;
+      Diagnostics::Report(Severity_t::Error, Code,
+                          "Could not open dump file: %s", strerror(errno));
       return false;
     }
 
+    return MapDescriptor(Start);
+  }
+
+  //
+  // Map a view of the open file.
+  //
+
+  bool MapDescriptor(const std::chrono::steady_clock::time_point Start) {
     struct stat Stat;
     if (fstat(Fd_, &Stat) < 0) {
-      perror("Could not stat dump file");
+      Diagnostics::Report(Severity_t::Error, DiagnosticCode_t::FileSizeFailed,
+                          "Could not stat dump file: %s", strerror(errno));
       return false;
     }
 
+    FileSize_ = uint64_t(Stat.st_size);
     ViewSize_ = Page::Align(Stat.st_size) + Page::Size;
-    ViewBase_ = mmap(nullptr, ViewSize_, PROT_READ, MAP_SHARED, Fd_, 0);
-    if (ViewBase_ == MAP_FAILED) {
-      perror("Could not mmap");
+    if (Options_.HugePages && InMemory()) {
+      bool Success = false;
+      Report_.HugePagesTime = Measure([&]() { Success = CopyToHugePages(); });
+      if (!Success) {
+        return false;
+      }
+
+      Report_.HugePages = true;
+    } else {
+      int Flags = MAP_SHARED;
+#if defined(MAP_POPULATE)
+      if (Options_.Populate) {
+        Flags |= MAP_POPULATE;
+      }
+#endif
+
+      const auto &MapTime = Measure([&]() {
+        ViewBase_ = mmap(nullptr, ViewSize_, PROT_READ, Flags, Fd_, 0);
+      });
+
+      if (ViewBase_ == MAP_FAILED) {
+        ViewBase_ = nullptr;
+        Diagnostics::Report(Severity_t::Error, DiagnosticCode_t::MapViewFailed,
+                            "Could not mmap: %s", strerror(errno));
+        return false;
+      }
+
+      if (Flags != MAP_SHARED) {
+        Report_.Populated = true;
+        Report_.PopulateTime = MapTime;
+      }
+    }
+
+    //
+    // Failing to lock the view isn't fatal, it shows in the report; most of
+    // the time, it is because of the limit on locked memory (RLIMIT_MEMLOCK).
+    //
+
+    if (Options_.Lock) {
+      Report_.LockTime = Measure([&]() { Report_.Locked = Lock(0, 0); });
+    }
+
+    Report_.MapTime = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - Start);
+    return true;
+  }
+
+  uint64_t Read(const uint64_t Offset, void *Out,
+                const uint64_t Size) const override {
+    if (Offset >= FileSize_) {
+      return 0;
+    }
+
+    const uint64_t Available = std::min(Size, FileSize_ - Offset);
+    memcpy(Out, (uint8_t *)ViewBase_ + Offset, size_t(Available));
+    return Available;
+  }
+
+  //
+  // The hint is applied to the view and to the file; the page cache only
+  // lets go of pages that aren't mapped anymore, which is why the view is
+  // released first.
+  //
+
+  bool Advise(const AccessHint_t Hint, const uint64_t Offset,
+              const uint64_t Size) const override {
+    if (ViewBase_ == nullptr || Offset >= FileSize_) {
       return false;
     }
 
+    if (Anonymous_) {
+      return true;
+    }
+
+    const uint64_t Available =
+        (Size == 0) ? FileSize_ - Offset : std::min(Size, FileSize_ - Offset);
+    const uint64_t Start = Page::Align(Offset);
+    const uint64_t End = Page::Align(Offset + Available + Page::Size - 1);
+    int Advice = MADV_NORMAL;
+    switch (Hint) {
+    case AccessHint_t::Normal: {
+      Advice = MADV_NORMAL;
+      break;
+    }
+
+    case AccessHint_t::Sequential: {
+      Advice = MADV_SEQUENTIAL;
+      break;
+    }
+
+    case AccessHint_t::Random: {
+      Advice = MADV_RANDOM;
+      break;
+    }
+
+    case AccessHint_t::WillNeed: {
+      Advice = MADV_WILLNEED;
+      break;
+    }
+
+    case AccessHint_t::DontNeed: {
+      Advice = MADV_DONTNEED;
+      break;
+    }
+    }
+
+    std::vector<std::pair<uint64_t, uint64_t>> Ranges = {{Start, End}};
+    if (Hint == AccessHint_t::DontNeed) {
+      Ranges = Locked_.Unlocked(Start, End);
+    }
+
+    for (const auto &[RangeStart, RangeEnd] : Ranges) {
+      if (madvise((uint8_t *)ViewBase_ + RangeStart,
+                  size_t(RangeEnd - RangeStart), Advice) < 0) {
+        Diagnostics::Report(Severity_t::Warning,
+                            DiagnosticCode_t::AdviseFailed,
+                            "madvise failed: %s", strerror(errno));
+        return false;
+      }
+    }
+
+    return AdviseFile(Fd_, Hint, Offset, Available);
+  }
+
+  bool Lock(const uint64_t Offset, const uint64_t Size) const override {
+    if (ViewBase_ == nullptr || Offset >= FileSize_) {
+      return false;
+    }
+
+    const uint64_t Available =
+        (Size == 0) ? FileSize_ - Offset : std::min(Size, FileSize_ - Offset);
+    const uint64_t Start = Page::Align(Offset);
+    const uint64_t End = Page::Align(Offset + Available + Page::Size - 1);
+    if (mlock((uint8_t *)ViewBase_ + Start, size_t(End - Start)) < 0) {
+      Diagnostics::Report(Severity_t::Warning, DiagnosticCode_t::LockFailed,
+                          "mlock failed: %s", strerror(errno));
+      return false;
+    }
+
+    Locked_.Add(Start, End);
     return true;
   }
 
@@ -278,6 +916,93 @@ public:
     return PtrEnd > Ptr && ViewEnd > ViewBase_ && Ptr >= ViewBase_ &&
            PtrEnd < ViewEnd;
   }
+
+private:
+  //
+  // Is the file hosted in memory already? Copying a file that isn't would
+  // read all of it from the disk up front.
+  //
+
+  bool InMemory() const {
+#if defined(__linux__)
+    constexpr uint32_t TmpfsMagic = 0x0102'1994;
+    constexpr uint32_t HugetlbfsMagic = 0x9584'58f6;
+    struct statfs Stat;
+    if (fstatfs(Fd_, &Stat) < 0) {
+      return false;
+    }
+
+    const uint32_t Type = uint32_t(Stat.f_type);
+    return Type == TmpfsMagic || Type == HugetlbfsMagic;
+#else
+    return false;
+#endif
+  }
+
+  //
+  // Copy the file into anonymous memory aligned on a huge page, which lets
+  // transparent huge pages back it. The view is zero-padded past the end of
+  // the file, like a mapping is. Copying the file populates the view, which is
+  // why it isn't populated when it is mapped: the pages would be faulted in
+  // before they can be huge.
+  //
+
+  bool CopyToHugePages() {
+    const uint64_t Size = (ViewSize_ + HugePageSize - 1) & ~(HugePageSize - 1);
+    void *Memory = mmap(nullptr, Size + HugePageSize, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (Memory == MAP_FAILED) {
+      Diagnostics::Report(Severity_t::Error, DiagnosticCode_t::MapViewFailed,
+                          "Could not mmap: %s", strerror(errno));
+      return false;
+    }
+
+    //
+    // Give back what is before and after the aligned part.
+    //
+
+    uint8_t *Base = (uint8_t *)Memory;
+    uint8_t *Aligned =
+        (uint8_t *)((uintptr_t(Base) + HugePageSize - 1) & ~(HugePageSize - 1));
+    if (Aligned != Base) {
+      munmap(Base, size_t(Aligned - Base));
+    }
+
+    const uint64_t Tail = HugePageSize - uint64_t(Aligned - Base);
+    if (Tail != 0) {
+      munmap(Aligned + Size, size_t(Tail));
+    }
+
+    ViewBase_ = Aligned;
+    ViewSize_ = off_t(Size);
+    Anonymous_ = true;
+#if defined(MADV_HUGEPAGE)
+    madvise(ViewBase_, size_t(ViewSize_), MADV_HUGEPAGE);
+#endif
+
+    uint64_t BytesRead = 0;
+    while (BytesRead < FileSize_) {
+      const ssize_t ChunkSize =
+          pread(Fd_, Aligned + BytesRead, size_t(FileSize_ - BytesRead),
+                off_t(BytesRead));
+      if (ChunkSize < 0 && errno == EINTR) {
+        continue;
+      }
+
+      if (ChunkSize <= 0) {
+        Diagnostics::Report(Severity_t::Error, DiagnosticCode_t::ReadFailed,
+                            "Could not read dump file: %s",
+                            ChunkSize < 0 ? strerror(errno) : "end of file");
+        return false;
+      }
+
+      BytesRead += uint64_t(ChunkSize);
+    }
+
+    Report_.Populated = Options_.Populate;
+    mprotect(ViewBase_, size_t(ViewSize_), PROT_READ);
+    return true;
+  }
 };
 #endif
 } // namespace kdmpparser
@@ -0,0 +1,197 @@
+// Axel '0vercl0k' Souchet - October 17 2026
+#pragma once
+
+#include "filemap.h"
+#include "physmem.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <system_error>
+
+namespace kdmpparser {
+
+//
+// What an index file has been built for; if any of those change, the index
+// file is stale.
+//
+
+struct IndexFileKey_t {
+
+  //
+  // Size of the dump in bytes; it is the size once decompressed for
+  // compressed dumps, as the runs are offsets into the decompressed dump.
+  //
+
+  uint64_t DumpSize = 0;
+
+  //
+  // Last write time of the dump file.
+  //
+
+  int64_t DumpLastWriteTime = 0;
+
+  //
+  // Hash of the dump header.
+  //
+
+  uint64_t HeaderHash = 0;
+
+  bool operator==(const IndexFileKey_t &Other) const {
+    return DumpSize == Other.DumpSize &&
+           DumpLastWriteTime == Other.DumpLastWriteTime &&
+           HeaderHash == Other.HeaderHash;
+  }
+};
+
+//
+// The index file is a header followed by the `NumberOfRuns` `PhysmemRun_t` of
+// the index, laid out the way `Physmem_t` uses them so that they can be used
+// straight from a read-only mapping of the file. Everything is stored in the
+// byte order of the machine that wrote it; the magic doesn't match otherwise.
+//
+// Only the dumps described by runs get an index file: the rank directory of
+// bitmap dumps is built by several threads (see `SetBitmap`), and checking
+// one loaded from a file would cost as much as building it.
+//
+
+struct IndexFileHeader_t {
+  static constexpr uint32_t ExpectedMagic = 0x5844494b; // 'KIDX'
+  static constexpr uint32_t ExpectedVersion = 2;
+
+  uint32_t Magic;
+  uint32_t Version;
+  IndexFileKey_t Key;
+  uint64_t NumberOfPages;
+  uint64_t NumberOfRuns;
+};
+
+static_assert(sizeof(PhysmemRun_t) == 0x18, "PhysmemRun_t's size looks wrong.");
+static_assert(sizeof(IndexFileHeader_t) == 0x30,
+              "IndexFileHeader_t's size looks wrong.");
+
+class IndexFile_t {
+
+  //
+  // The mapped index file.
+  //
+
+  FileMap_t FileMap_;
+
+public:
+  //
+  // Get the path of the index file of a dump.
+  //
+
+  static std::filesystem::path PathFor(const std::filesystem::path &PathFile) {
+    std::filesystem::path Path = PathFile;
+    Path += ".kdmpidx";
+    return Path;
+  }
+
+  //
+  // Compute the key of a dump of `DumpSize` bytes (see `IndexFileKey_t`); the
+  // header is hashed with FNV-1a.
+  //
+
+  static bool ComputeKey(const std::filesystem::path &PathFile,
+                         const uint64_t DumpSize, const uint8_t *Header,
+                         const size_t HeaderSize, IndexFileKey_t &Key) {
+    std::error_code Ec;
+    Key.DumpSize = DumpSize;
+    const auto &LastWriteTime = std::filesystem::last_write_time(PathFile, Ec);
+    if (Ec) {
+      return false;
+    }
+
+    Key.DumpLastWriteTime = int64_t(LastWriteTime.time_since_epoch().count());
+    Key.HeaderHash = 0xcbf29ce484222325ULL;
+    for (size_t Idx = 0; Idx < HeaderSize; Idx++) {
+      Key.HeaderHash = (Key.HeaderHash ^ Header[Idx]) * 0x100000001b3ULL;
+    }
+
+    return true;
+  }
+
+  //
+  // Map an index file and point `Physmem` to it if it has been built for
+  // `Key`. `Physmem` needs its view base set already, and the index file
+  // object needs to outlive it.
+  //
+
+  bool Load(const std::filesystem::path &Path, const IndexFileKey_t &Key,
+            Physmem_t &Physmem) {
+    std::error_code Ec;
+    const uint64_t Size = std::filesystem::file_size(Path, Ec);
+    if (Ec || Size < sizeof(IndexFileHeader_t)) {
+      return false;
+    }
+
+    if (!FileMap_.MapFile(Path.string().c_str())) {
+      return false;
+    }
+
+    const uint8_t *Base = (uint8_t *)FileMap_.ViewBase();
+    const auto &Header = *(IndexFileHeader_t *)Base;
+    if (Header.Magic != IndexFileHeader_t::ExpectedMagic ||
+        Header.Version != IndexFileHeader_t::ExpectedVersion ||
+        !(Header.Key == Key)) {
+      return false;
+    }
+
+    const uint64_t PayloadSize = Size - sizeof(Header);
+    if (Header.NumberOfRuns > (PayloadSize / sizeof(PhysmemRun_t))) {
+      return false;
+    }
+
+    return Physmem.UseRuns((PhysmemRun_t *)(Base + sizeof(Header)),
+                           Header.NumberOfRuns, Key.DumpSize) &&
+           Physmem.size() == Header.NumberOfPages;
+  }
+
+  //
+  // Write the runs of a dump to an index file. The file is written next to its
+  // final path and renamed once complete, so that readers never see a partial
+  // file.
+  //
+
+  static bool Write(const std::filesystem::path &Path,
+                    const IndexFileKey_t &Key, const Physmem_t &Physmem) {
+    IndexFileHeader_t Header = {};
+    Header.Magic = IndexFileHeader_t::ExpectedMagic;
+    Header.Version = IndexFileHeader_t::ExpectedVersion;
+    Header.Key = Key;
+    Header.NumberOfPages = Physmem.size();
+
+    const auto &Runs = Physmem.Runs();
+    Header.NumberOfRuns = Runs.size();
+
+    const auto &TempPath = TemporaryPathFor(Path);
+    FILE *File = fopen(TempPath.string().c_str(), "wb");
+    if (File == nullptr) {
+      return false;
+    }
+
+    bool Success =
+        fwrite(&Header, sizeof(Header), 1, File) == 1 &&
+        fwrite(Runs.data(), sizeof(PhysmemRun_t), Runs.size(), File) ==
+            Runs.size();
+
+    Success = fclose(File) == 0 && Success;
+
+    std::error_code Ec;
+    if (Success) {
+      std::filesystem::rename(TempPath, Path, Ec);
+      Success = !Ec;
+    }
+
+    if (!Success) {
+      std::filesystem::remove(TempPath, Ec);
+    }
+
+    return Success;
+  }
+};
+
+} // namespace kdmpparser
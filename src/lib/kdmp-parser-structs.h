@@ -1,6 +1,7 @@
 // Axel '0vercl0k' Souchet - February 15 2019
 #pragma once
 
+#include "diagnostics.h"
 #include "platform.h"
 #include <array>
 #include <cinttypes>
@@ -247,12 +248,14 @@ struct BMP_HEADER64 {
     //
 
     if (Signature != ExpectedSignature && Signature != ExpectedSignature2) {
-      printf("BMP_HEADER64::Signature looks wrong.\n");
+      Diagnostics::Report(Severity_t::Error, DiagnosticCode_t::InvalidSignature,
+                          "BMP_HEADER64::Signature looks wrong.");
       return false;
     }
 
     if (ValidDump != ExpectedValidDump) {
-      printf("BMP_HEADER64::ValidDump looks wrong.\n");
+      Diagnostics::Report(Severity_t::Error, DiagnosticCode_t::InvalidValidDump,
+                          "BMP_HEADER64::ValidDump looks wrong.");
       return false;
     }
 
@@ -485,7 +488,8 @@ struct CONTEXT {
     //
 
     if (MxCsr != MxCsr2) {
-      printf("CONTEXT::MxCsr doesn't match MxCsr2.\n");
+      Diagnostics::Report(Severity_t::Error, DiagnosticCode_t::InvalidContext,
+                          "CONTEXT::MxCsr doesn't match MxCsr2.");
       return false;
     }
 
@@ -735,12 +739,14 @@ struct HEADER64 {
     //
 
     if (Signature != ExpectedSignature) {
-      printf("HEADER64::Signature looks wrong.\n");
+      Diagnostics::Report(Severity_t::Error, DiagnosticCode_t::InvalidSignature,
+                          "HEADER64::Signature looks wrong.");
       return false;
     }
 
     if (ValidDump != ExpectedValidDump) {
-      printf("HEADER64::ValidDump looks wrong.\n");
+      Diagnostics::Report(Severity_t::Error, DiagnosticCode_t::InvalidValidDump,
+                          "HEADER64::ValidDump looks wrong.");
       return false;
     }
 
@@ -751,7 +757,9 @@ struct HEADER64 {
     switch (DumpType) {
     case DumpType_t::FullDump: {
       if (!u1.PhysicalMemoryBlock.LooksGood()) {
-        printf("The PhysicalMemoryBlockBuffer looks wrong.\n");
+        Diagnostics::Report(Severity_t::Error,
+                            DiagnosticCode_t::InvalidPhysicalMemoryBlock,
+                            "The PhysicalMemoryBlockBuffer looks wrong.");
         return false;
       }
       break;
@@ -760,7 +768,9 @@ struct HEADER64 {
     case DumpType_t::LiveKernelBitmapDump:
     case DumpType_t::BMPDump: {
       if (!u3.BmpHeader.LooksGood()) {
-        printf("The BmpHeader looks wrong.\n");
+        Diagnostics::Report(Severity_t::Error,
+                            DiagnosticCode_t::InvalidBmpHeader,
+                            "The BmpHeader looks wrong.");
         return false;
       }
       break;
@@ -769,7 +779,9 @@ struct HEADER64 {
     case DumpType_t::KernelAndUserMemoryDump:
     case DumpType_t::KernelMemoryDump: {
       if (!u3.RdmpHeader.Hdr.LooksGood()) {
-        printf("The RdmpHeader looks wrong.\n");
+        Diagnostics::Report(Severity_t::Error,
+                            DiagnosticCode_t::InvalidRdmpHeader,
+                            "The RdmpHeader looks wrong.");
         return false;
       }
       break;
@@ -777,20 +789,26 @@ struct HEADER64 {
 
     case DumpType_t::CompleteMemoryDump: {
       if (!u3.FullRdmpHeader.Hdr.LooksGood()) {
-        printf("The RdmpHeader looks wrong.\n");
+        Diagnostics::Report(Severity_t::Error,
+                            DiagnosticCode_t::InvalidRdmpHeader,
+                            "The RdmpHeader looks wrong.");
         return false;
       }
       break;
     }
 
     case DumpType_t::MiniDump: {
-      printf("Unsupported type %s (%#x).\n", DumpTypeToString(DumpType).data(),
-             uint32_t(DumpType));
+      Diagnostics::Report(Severity_t::Error,
+                          DiagnosticCode_t::UnsupportedDumpType,
+                          "Unsupported type %s (%#x).",
+                          DumpTypeToString(DumpType).data(),
+                          uint32_t(DumpType));
       return false;
     }
 
     default: {
-      printf("Unknown Type %#x.\n", uint32_t(DumpType));
+      Diagnostics::Report(Severity_t::Error, DiagnosticCode_t::UnknownDumpType,
+                          "Unknown Type %#x.", uint32_t(DumpType));
       return false;
     }
     }
@@ -1,35 +1,237 @@
 // Axel '0vercl0k' Souchet - February 15 2019
 #pragma once
 
+#include "asyncread.h"
+#include "bufferfile.h"
+#include "compressedfile.h"
+#include "diagnostics.h"
 #include "filemap.h"
+#include "indexfile.h"
 #include "kdmp-parser-structs.h"
 #include "kdmp-parser-version.h"
+#include "parallel.h"
+#include "physmem.h"
+#include "preadfile.h"
+#include "reversemap.h"
+#include "tlb.h"
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <cstdint>
 #include <cstdio>
 #include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
-#include <unordered_map>
+#include <thread>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 namespace kdmpparser {
 
 using Page_t = std::array<uint8_t, kdmpparser::Page::Size>;
-using Physmem_t = std::unordered_map<uint64_t, const uint8_t *>;
 
 struct BugCheckParameters_t {
   uint32_t BugCheckCode;
   std::array<uint64_t, 4> BugCheckCodeParameter;
 };
 
+using AddressSpaceCallback_t = std::function<void(const VirtualRange_t &)>;
+
+//
+// Invoked with the content of a physical page read by ReadPhysicalPagesAsync;
+// the content is nullptr if the page couldn't be read, and is only valid
+// during the call.
+//
+
+using PageReadCallback_t =
+    std::function<void(const uint64_t PhysicalAddress, const uint8_t *Page)>;
+
+//
+// A physical page that looks like a PML4, found by FindDirectoryTableBases.
+//
+
+struct DtbCandidate_t {
+
+  //
+  // Physical address of the page.
+  //
+
+  uint64_t DirectoryTableBase;
+
+  //
+  // Index of the entry pointing back to the page itself.
+  //
+
+  uint64_t SelfReferenceIndex;
+
+  //
+  // Number of present entries.
+  //
+
+  uint32_t NumberOfPresentEntries;
+
+  //
+  // Number of entries of the kernel half that are identical to the ones of the
+  // directory table base from the dump header.
+  //
+
+  uint32_t NumberOfKernelMatches;
+
+  //
+  // Twice the number of kernel matches, plus one if the self-reference entry
+  // sits at the same index as in the directory table base from the dump
+  // header; candidates are ranked by it.
+  //
+
+  uint32_t Score;
+};
+
+//
+// How the dump file is read.
+//
+
+enum class FileBackendType_t : uint32_t {
+
+  //
+  // Map a view of the whole file (see `FileMap_t`).
+  //
+
+  Map,
+
+  //
+  // Read the file with positional reads through a cache of file blocks (see
+  // `PreadFile_t`).
+  //
+
+  Pread
+};
+
+//
+// Options controlling how a dump is parsed.
+//
+
+struct ParseOptions_t {
+
+  //
+  // Number of threads used to build the index of the physical memory; 1 only
+  // uses the calling thread and 0 uses one thread per hardware thread.
+  //
+
+  uint32_t NumberOfThreads = 1;
+
+  //
+  // Use the index file that sits next to the dump (`<dump>.kdmpidx`) if it is
+  // up to date, instead of building the index. Otherwise, build the index and
+  // write it there for the next time. Bitmap dumps don't use index files.
+  //
+
+  bool UseIndexFile = false;
+
+  //
+  // Only map the file and check its header in Parse; the index of the physical
+  // memory is built the first time it is needed.
+  //
+
+  bool LazyPhysmem = false;
+
+  //
+  // When `LazyPhysmem` is set, build the index on a background thread right
+  // after Parse returns instead of waiting for it to be needed.
+  //
+
+  bool BuildPhysmemInBackground = false;
+
+  //
+  // Number of entries of the software TLB caching virtual address
+  // translations; 0 disables it.
+  //
+
+  uint64_t TlbCapacity = 0;
+
+  //
+  // Number of entries of the paging-structure cache, which caches the PML4Es,
+  // PDPTEs and PDEs used by the page table walks; 0 disables it.
+  //
+
+  uint64_t PagingStructureCacheCapacity = 0;
+
+  //
+  // How the dump file is read. With `Pread`, the pages are copied out of a
+  // cache of `BlockSize`-byte blocks holding at most `BlockCacheSize` bytes,
+  // and the functions handing out pointers to the content of a page copy it
+  // to a buffer first (see `GetPhysicalPage`). A compressed dump (see
+  // `CompressFile`) is always read through a cache of decompressed chunks
+  // holding at most `BlockCacheSize` bytes, whatever the backend.
+  //
+
+  FileBackendType_t FileBackend = FileBackendType_t::Map;
+  uint64_t BlockSize = PreadFile_t::DefaultBlockSize;
+  uint64_t BlockCacheSize = PreadFile_t::DefaultCacheSize;
+
+  //
+  // Hint applied to the whole dump file once it is opened (see `Advise`);
+  // `Random` suits analyses that mostly translate addresses and read scattered
+  // pages.
+  //
+
+  AccessHint_t AccessHint = AccessHint_t::Normal;
+
+  //
+  // Let the functions reading large parts of the dump apply the hint that fits
+  // the way they read it, and put `AccessHint` back once they are done. The
+  // scan of `FindDirectoryTableBases` also releases the pages it read so that
+  // they don't push the pages of other workloads out of the page cache.
+  //
+
+  bool AdviseScans = true;
+
+  //
+  // How the view of the file is set up when it is mapped (see `MapOptions_t`):
+  // read every page in up front, lock the view in memory, and copy the file
+  // into memory backed by huge pages if it is in memory already. They make
+  // `Parse` slower, but accessing the dump afterwards doesn't fault anymore;
+  // how long each of them took is in `GetMapReport`.
+  //
+
+  bool Populate = false;
+  bool LockView = false;
+  bool HugePages = false;
+};
+
 class KernelDumpParser {
 
   //
-  // The mapped file.
+  // The dump file.
+  //
+
+  std::unique_ptr<FileBackend_t> File_;
+
+  //
+  // Is the dump file a compressed dump? Its content is then only available
+  // through `File_`.
+  //
+
+  bool Compressed_ = false;
+
+  //
+  // How long setting up the view of the file took, if it is mapped.
+  //
+
+  MapReport_t MapReport_;
+
+  //
+  // Copy of the beginning of the file, up to the first page, when it isn't
+  // mapped; the headers are read from there.
   //
 
-  FileMap_t FileMap_;
+  std::vector<uint8_t> Metadata_;
 
   //
   // Header of the crash-dump.
@@ -38,90 +240,182 @@ class KernelDumpParser {
   HEADER64 *DmpHdr_ = nullptr;
 
   //
-  // File path to the crash-dump.
+  // Where the crash-dump is read from: a file path, a file descriptor or a
+  // buffer owned by the caller, or a backend that is open already.
+  //
+
+  enum class Source_t : uint32_t { Path, Descriptor, Buffer, Backend };
+  Source_t Source_ = Source_t::Path;
+
+  //
+  // File path to the crash-dump; it is empty if it isn't read from a path.
   //
 
   std::filesystem::path PathFile_;
+  int Descriptor_ = -1;
+  const void *Buffer_ = nullptr;
+  uint64_t BufferSize_ = 0;
+  std::unique_ptr<FileBackend_t> SourceFile_;
+
+  //
+  // Index of the physical memory; maps physical addresses to page data. It
+  // might be built lazily, which is why it is mutable.
+  //
+
+  mutable Physmem_t Physmem_;
+
+  //
+  // State of the index of the physical memory. Readers only use the index once
+  // it is `Built`; the transitions out of `NotBuilt` happen with
+  // `PhysmemLock_` held, so the index is built by a single thread while the
+  // others wait for it. There is nothing to index until a dump has been
+  // parsed, which is why it starts as `Failed`.
+  //
+
+  enum class PhysmemState_t : uint32_t { NotBuilt, Building, Built, Failed };
+  mutable std::atomic<PhysmemState_t> PhysmemState_{PhysmemState_t::Failed};
+  mutable std::mutex PhysmemLock_;
+
+  //
+  // Thread building the index in the background, if any.
+  //
+
+  std::thread PhysmemBuilder_;
+
+  //
+  // Options passed to Parse.
+  //
+
+  ParseOptions_t Options_;
+
+  //
+  // The index file, if the index comes from one.
+  //
+
+  mutable IndexFile_t IndexFile_;
+
+  //
+  // Cache of the virtual address translations.
+  //
+
+  mutable Tlb_t Tlb_;
+
+  //
+  // Cache of the upper level paging structure entries.
+  //
+
+  mutable PagingStructureCache_t Psc_;
+
+  //
+  // Cache of the directory table base the kernel half translations of an
+  // address space are cached under, keyed by its directory table base and the
+  // PML4 index (see `SharedDirectoryTableBase`).
+  //
+
+  mutable ShardedCache_t<uint64_t> SharedDTBs_;
 
   //
-  // Mapping between physical addresses / page data.
+  // Number of entries of the cache above; it holds the kernel half of 64
+  // address spaces.
   //
 
-  Physmem_t Physmem_;
+  static constexpr uint64_t SharedDTBsCapacity = 64 * 256;
 
 public:
+  KernelDumpParser() = default;
+  KernelDumpParser(const KernelDumpParser &) = delete;
+  KernelDumpParser &operator=(const KernelDumpParser &) = delete;
+
+  ~KernelDumpParser() {
+    if (PhysmemBuilder_.joinable()) {
+      PhysmemBuilder_.join();
+    }
+  }
+
   //
   // Actually do the parsing of the file.
   //
 
-  bool Parse(const char *PathFile) {
+  bool Parse(const char *PathFile, const ParseOptions_t &Options = {}) {
+    return ParseSource(Source_t::Path, PathFile, -1, nullptr, 0, Options);
+  }
 
-    //
-    // Copy the path file.
-    //
+  //
+  // Parse a dump that is in memory already. The buffer is owned by the caller
+  // and needs to outlive the parser, or the next call to one of the `Parse`
+  // functions; the pages are copied out of it, like when the file isn't
+  // mapped. There is no index file and no io_uring for such a dump, as they
+  // need a path.
+  //
 
-    PathFile_ = std::filesystem::path(PathFile);
-    if (!std::filesystem::exists(PathFile_)) {
-      printf("Invalid file: %s.\n", (char *)PathFile_.string().c_str());
-      return false;
-    }
+  bool Parse(const void *Buffer, const uint64_t Size,
+             const ParseOptions_t &Options = {}) {
+    return ParseSource(Source_t::Buffer, nullptr, -1, Buffer, Size, Options);
+  }
 
-    //
-    // Map a view of the file.
-    //
+  //
+  // Parse a dump from an open file descriptor, which needs to be seekable.
+  // It is owned by the caller, and can be closed once this returns as the
+  // parser works on a duplicate of it. Like for a buffer, there is no index
+  // file and no io_uring for such a dump.
+  //
 
-    if (!MapFile()) {
-      printf("MapFile failed.\n");
-      return false;
-    }
+  bool ParseDescriptor(const int Fd, const ParseOptions_t &Options = {}) {
+    return ParseSource(Source_t::Descriptor, nullptr, Fd, nullptr, 0, Options);
+  }
 
-    //
-    // Parse the DMP_HEADER.
-    //
+  //
+  // Parse a dump read through a backend that is open already, which the
+  // parser takes ownership of; it is used as is, so it isn't looked at for a
+  // compressed dump. Like for a buffer, there is no index file and no
+  // io_uring for such a dump.
+  //
 
-    if (!ParseDmpHeader()) {
-      printf("ParseDmpHeader failed.\n");
-      return false;
-    }
+  bool Parse(std::unique_ptr<FileBackend_t> File,
+             const ParseOptions_t &Options = {}) {
+    SourceFile_ = std::move(File);
+    return ParseSource(Source_t::Backend, nullptr, -1, nullptr, 0, Options);
+  }
 
-    //
-    // Retrieve the physical memory according to the type of dump we have.
-    //
+  //
+  // Make sure the index of the physical memory is built; it is built by the
+  // calling thread if nobody has started building it yet, otherwise this waits
+  // until it is done. Returns false if it couldn't be built, in which case the
+  // index is empty.
+  //
 
-    switch (DmpHdr_->DumpType) {
-    case DumpType_t::FullDump: {
-      if (!BuildPhysmemFullDump()) {
-        printf("BuildPhysmemFullDump failed.\n");
-        return false;
-      }
-      break;
+  bool EnsurePhysmem() const {
+    const PhysmemState_t State = PhysmemState_.load(std::memory_order_acquire);
+    if (State == PhysmemState_t::Built) {
+      return true;
     }
-    case DumpType_t::LiveKernelBitmapDump:
-    case DumpType_t::BMPDump: {
-      if (!BuildPhysmemBMPDump()) {
-        printf("BuildPhysmemBMPDump failed.\n");
-        return false;
-      }
-      break;
+
+    std::lock_guard<std::mutex> Lock(PhysmemLock_);
+    switch (PhysmemState_.load(std::memory_order_relaxed)) {
+    case PhysmemState_t::Built: {
+      return true;
     }
 
-    case DumpType_t::CompleteMemoryDump:
-    case DumpType_t::KernelAndUserMemoryDump:
-    case DumpType_t::KernelMemoryDump: {
-      if (!BuildPhysicalMemoryFromDump(DmpHdr_->DumpType)) {
-        printf("BuildPhysicalMemoryFromDump failed.\n");
-        return false;
-      }
-      break;
+    case PhysmemState_t::Failed: {
+      return false;
     }
 
     default: {
-      printf("Invalid type\n");
-      return false;
+      break;
     }
     }
 
-    return true;
+    PhysmemState_.store(PhysmemState_t::Building, std::memory_order_relaxed);
+    const bool Success = BuildPhysmem();
+    if (!Success) {
+      Physmem_ = Physmem_t();
+      SetPhysmemView();
+    }
+
+    PhysmemState_.store(Success ? PhysmemState_t::Built
+                                : PhysmemState_t::Failed,
+                        std::memory_order_release);
+    return Success;
   }
 
   //
@@ -155,11 +449,45 @@ public:
   }
 
   //
-  // Get the path of dump.
+  // Get the path of dump; it is empty if the dump hasn't been parsed from a
+  // path.
   //
 
   const std::filesystem::path &GetDumpPath() const { return PathFile_; }
 
+  //
+  // Get the size of the beginning of a dump, up to its first page: it holds
+  // the headers as well as the metadata describing where the pages are.
+  //
+
+  static uint64_t GetMetadataSize(const HEADER64 &Header) {
+    uint64_t FirstPageOffset = 0;
+    switch (Header.DumpType) {
+    case DumpType_t::LiveKernelBitmapDump:
+    case DumpType_t::BMPDump: {
+      FirstPageOffset = Header.u3.BmpHeader.FirstPage;
+      break;
+    }
+
+    case DumpType_t::KernelAndUserMemoryDump:
+    case DumpType_t::KernelMemoryDump: {
+      FirstPageOffset = Header.u3.RdmpHeader.Hdr.FirstPageOffset;
+      break;
+    }
+
+    case DumpType_t::CompleteMemoryDump: {
+      FirstPageOffset = Header.u3.FullRdmpHeader.Hdr.FirstPageOffset;
+      break;
+    }
+
+    default: {
+      break;
+    }
+    }
+
+    return std::max(uint64_t(sizeof(Header)), FirstPageOffset);
+  }
+
   //
   // Get the type of dump.
   //
@@ -170,7 +498,10 @@ public:
   // Get the physmem.
   //
 
-  constexpr const Physmem_t &GetPhysmem() const { return Physmem_; }
+  const Physmem_t &GetPhysmem() const {
+    EnsurePhysmem();
+    return Physmem_;
+  }
 
   //
   // Show the exception record.
@@ -265,157 +596,1434 @@ public:
   void ShowAllStructures(const uint32_t Prefix) const { DmpHdr_->Show(Prefix); }
 
   //
-  // Get the content of a physical address.
+  // Get the content of a physical address. When the dump file isn't mapped,
+  // the page is copied to a buffer owned by the calling thread, which the next
+  // call from that thread overwrites.
   //
 
   const uint8_t *GetPhysicalPage(const uint64_t PhysicalAddress) const {
+    thread_local Page_t Buffer;
+    return GetPhysicalPage(PhysicalAddress, Buffer);
+  }
 
-    //
-    // Attempt to find the physical address.
-    //
+  //
+  // Get the content of a physical address; when the dump file isn't mapped,
+  // the page is copied to `Buffer`.
+  //
 
-    const auto &Pair = Physmem_.find(PhysicalAddress);
+  const uint8_t *GetPhysicalPage(const uint64_t PhysicalAddress,
+                                 Page_t &Buffer) const {
 
     //
-    // If it doesn't exist then return nullptr.
+    // Look for the run that contains the physical address; if there is none,
+    // this returns nullptr. Otherwise we get a pointer to the content of the
+    // page.
     //
 
-    if (Pair == Physmem_.end()) {
+    if (!EnsurePhysmem()) {
       return nullptr;
     }
 
-    //
-    // Otherwise we return a pointer to the content of the page.
-    //
+    if (Physmem_.Mapped()) {
+      return Physmem_.GetPage(PhysicalAddress);
+    }
 
-    return Pair->second;
+    if (Page::Offset(PhysicalAddress) ||
+        !Physmem_.ReadPage(PhysicalAddress, Buffer.data(), Page::Size)) {
+      return nullptr;
+    }
+
+    return Buffer.data();
   }
 
   //
-  // Get the directory table base.
+  // Read physical memory; the address doesn't need to be page-aligned and the
+  // read can span several pages. Ranges that aren't in the dump are handed to
+  // `OnMissingPage` (see `MissingPageCallback_t`); without one, the read stops
+  // there. Returns the number of bytes written to `Out`.
   //
 
-  constexpr uint64_t GetDirectoryTableBase() const {
-    return DmpHdr_->DirectoryTableBase;
+  size_t ReadPhysicalMemoryPartial(
+      const uint64_t PhysicalAddress, void *Out, const size_t Size,
+      const MissingPageCallback_t &OnMissingPage = nullptr) const {
+    if (!EnsurePhysmem()) {
+      return 0;
+    }
+
+    return size_t(
+        Physmem_.Read(PhysicalAddress, (uint8_t *)Out, Size, OnMissingPage));
   }
 
   //
-  // Translate a virtual address to physical address using a directory table
-  // base.
+  // Get the longest span of memory that is contiguous both physically and in
+  // the dump file, starting at a physical address. The span points straight
+  // into the view of the dump, so no copy is involved; its `Data` is nullptr
+  // when the dump file isn't mapped.
   //
 
-  std::optional<uint64_t>
-  VirtTranslate(const uint64_t VirtualAddress,
-                const uint64_t DirectoryTableBase = 0) const {
+  std::optional<PhysmemSpan_t>
+  GetPhysicalSpan(const uint64_t PhysicalAddress) const {
+    if (!EnsurePhysmem()) {
+      return {};
+    }
 
-    //
-    // If DirectoryTableBase is null ; use the one from the dump header and
-    // clear PCID bits (bits 11:0).
-    //
+    return Physmem_.SpanAt(PhysicalAddress);
+  }
 
-    uint64_t LocalDTB = Page::Align(GetDirectoryTableBase());
+  //
+  // Get the offset in the dump file of the page of a physical address.
+  //
 
-    if (DirectoryTableBase) {
-      LocalDTB = Page::Align(DirectoryTableBase);
+  std::optional<uint64_t>
+  GetPhysicalPageFileOffset(const uint64_t PhysicalAddress) const {
+    if (!EnsurePhysmem()) {
+      return {};
     }
 
-    //
-    // Stole code from @yrp604 and @0vercl0k.
-    //
+    return Physmem_.PageOffset(PhysicalAddress / Page::Size);
+  }
 
+  //
+  // Get every span of the physical memory in the order they are stored in the
+  // dump file; whole-dump passes should use this to read the file
+  // sequentially.
+  //
+
+  Physmem_t::file_order_range GetPhysicalSpansInFileOrder() const {
+    EnsurePhysmem();
+    return Physmem_.FileOrderSpans();
+  }
+
+  //
+  // Get the spans covering a range of physical memory; the pages that aren't
+  // in the dump are skipped.
+  //
+
+  Physmem_t::span_range GetPhysicalSpans(const uint64_t PhysicalAddress,
+                                         const uint64_t Size) const {
+    EnsurePhysmem();
+    return Physmem_.Spans(PhysicalAddress, Size);
+  }
+
+  //
+  // Read physical memory; returns true if all `Size` bytes have been written to
+  // `Out`.
+  //
+
+  bool ReadPhysicalMemory(
+      const uint64_t PhysicalAddress, void *Out, const size_t Size,
+      const MissingPageCallback_t &OnMissingPage = nullptr) const {
+    return ReadPhysicalMemoryPartial(PhysicalAddress, Out, Size,
+                                     OnMissingPage) == Size;
+  }
+
+  //
+  // Get the directory table base.
+  //
+
+  constexpr uint64_t GetDirectoryTableBase() const {
+    return DmpHdr_->DirectoryTableBase;
+  }
+
+  //
+  // Translate a virtual address to physical address using a directory table
+  // base.
+  //
+
+  std::optional<uint64_t>
+  VirtTranslate(const uint64_t VirtualAddress,
+                const uint64_t DirectoryTableBase = 0) const {
+    const auto &Translation =
+        GetTranslation(VirtualAddress, DirectoryTableBase);
+    if (!Translation) {
+      return {};
+    }
+
+    return Translation->PhysicalAddress;
+  }
+
+  //
+  // Translate a virtual address to physical address using a directory table
+  // base, and get the size of the page that maps it. The translations are
+  // cached in the software TLB if it is enabled.
+  //
+
+  std::optional<Translation_t>
+  GetTranslation(const uint64_t VirtualAddress,
+                 const uint64_t DirectoryTableBase = 0) const {
+
+    //
+    // If DirectoryTableBase is null ; use the one from the dump header and
+    // clear PCID bits (bits 11:0).
+    //
+
+    uint64_t LocalDTB = Page::Align(GetDirectoryTableBase());
+
+    if (DirectoryTableBase) {
+      LocalDTB = Page::Align(DirectoryTableBase);
+    }
+
+    LocalDTB = SharedDirectoryTableBase(LocalDTB, VirtualAddress);
+    const auto &Cached = Tlb_.Lookup(LocalDTB, VirtualAddress);
+    if (Cached) {
+      return Cached;
+    }
+
+    const auto &Translation = WalkPageTables(VirtualAddress, LocalDTB);
+    if (Translation) {
+      Tlb_.Insert(LocalDTB, VirtualAddress, *Translation);
+    }
+
+    return Translation;
+  }
+
+  //
+  // Translate a batch of virtual addresses using a directory table base;
+  // `PhysicalAddresses[Idx]` receives the translation of
+  // `VirtualAddresses[Idx]`, or nothing if it doesn't translate. The addresses
+  // are walked in order so that the paging structure entries they share are
+  // read once, and their page table entries are prefetched before being read.
+  // Unlike VirtTranslate, the addresses that don't translate aren't reported.
+  //
+
+  void VirtTranslateBatch(const uint64_t *VirtualAddresses,
+                          std::optional<uint64_t> *PhysicalAddresses,
+                          const size_t NumberOfAddresses,
+                          const uint64_t DirectoryTableBase = 0) const {
+    uint64_t LocalDTB = Page::Align(GetDirectoryTableBase());
+
+    if (DirectoryTableBase) {
+      LocalDTB = Page::Align(DirectoryTableBase);
+    }
+
+    //
+    // Serve what we can from the TLB, and sort the rest by the bits of the
+    // virtual address that index the paging structures; addresses that share
+    // entries end up next to each other.
+    //
+
+    std::vector<size_t> Order;
+    Order.reserve(NumberOfAddresses);
+    for (size_t Idx = 0; Idx < NumberOfAddresses; Idx++) {
+      PhysicalAddresses[Idx].reset();
+      const auto &Cached = Tlb_.Lookup(
+          SharedDirectoryTableBase(LocalDTB, VirtualAddresses[Idx]),
+          VirtualAddresses[Idx]);
+      if (Cached) {
+        PhysicalAddresses[Idx] = Cached->PhysicalAddress;
+        continue;
+      }
+
+      Order.push_back(Idx);
+    }
+
+    const auto &Indices = [&](const size_t Idx) {
+      return VirtualAddresses[Idx] & 0xffff'ffff'ffffULL;
+    };
+
+    std::stable_sort(Order.begin(), Order.end(),
+                     [&](const size_t A, const size_t B) {
+                       return Indices(A) < Indices(B);
+                     });
+
+    //
+    // First pass: walk the upper levels, only reading an entry when the
+    // indices leading to it differ from the previous address', and prefetch
+    // the page table entries. Second pass: read the page table entries. The
+    // entries are cached under `CacheDTB`, which is the same for every address
+    // sharing a PML4E.
+    //
+
+    const MMPTE_HARDWARE Pml4(LocalDTB);
+    const uint64_t Pml4Base = Pml4.u.PageFrameNumber * Page::Size;
+    std::optional<MMPTE_HARDWARE> Pml4e, Pdpte, Pde;
+    uint64_t CacheDTB = LocalDTB;
+    std::vector<const MMPTE_HARDWARE *> Ptes(Order.size(), nullptr);
+    std::vector<MMPTE_HARDWARE> PteBuffers(Order.size(), MMPTE_HARDWARE(0));
+    std::vector<uint64_t> CacheDTBs(Order.size(), LocalDTB);
+    for (size_t Pos = 0; Pos < Order.size(); Pos++) {
+      const size_t Idx = Order[Pos];
+      const uint64_t VirtualAddress = VirtualAddresses[Idx];
+      const VIRTUAL_ADDRESS GuestAddress(VirtualAddress);
+      const uint64_t Diff =
+          Pos == 0 ? ~0ULL : Indices(Idx) ^ Indices(Order[Pos - 1]);
+      const bool NewPml4e = (Diff >> uint64_t(PagingLevel_t::Pml4)) != 0;
+      const bool NewPdpte = (Diff >> uint64_t(PagingLevel_t::Pdpt)) != 0;
+      const bool NewPde = (Diff >> uint64_t(PagingLevel_t::Pd)) != 0;
+
+      if (NewPml4e) {
+        CacheDTB = SharedDirectoryTableBase(LocalDTB, VirtualAddress);
+        Pml4e = LoadPagingEntry(CacheDTB, PagingLevel_t::Pml4, VirtualAddress,
+                                Pml4Base, GuestAddress.u.Pml4Index);
+      }
+
+      if (!Pml4e) {
+        continue;
+      }
+
+      if (NewPdpte) {
+        const uint64_t PdptBase = Pml4e->u.PageFrameNumber * Page::Size;
+        Pdpte = LoadPagingEntry(CacheDTB, PagingLevel_t::Pdpt, VirtualAddress,
+                                PdptBase, GuestAddress.u.PdPtIndex);
+      }
+
+      if (!Pdpte) {
+        continue;
+      }
+
+      const uint64_t PdBase = Pdpte->u.PageFrameNumber * Page::Size;
+      if (Pdpte->u.LargePage) {
+        const Translation_t Translation = {
+            PdBase + (VirtualAddress & 0x3fff'ffff), 0x4000'0000};
+        PhysicalAddresses[Idx] = Translation.PhysicalAddress;
+        Tlb_.Insert(CacheDTB, VirtualAddress, Translation);
+        continue;
+      }
+
+      if (NewPde) {
+        Pde = LoadPagingEntry(CacheDTB, PagingLevel_t::Pd, VirtualAddress,
+                              PdBase, GuestAddress.u.PdIndex);
+      }
+
+      if (!Pde) {
+        continue;
+      }
+
+      const uint64_t PtBase = Pde->u.PageFrameNumber * Page::Size;
+      if (Pde->u.LargePage) {
+        const Translation_t Translation = {
+            PtBase + (VirtualAddress & 0x1f'ffff), 0x20'0000};
+        PhysicalAddresses[Idx] = Translation.PhysicalAddress;
+        Tlb_.Insert(CacheDTB, VirtualAddress, Translation);
+        continue;
+      }
+
+      Ptes[Pos] =
+          GetPagingEntry(PtBase, GuestAddress.u.PtIndex, PteBuffers[Pos]);
+      CacheDTBs[Pos] = CacheDTB;
+      if (Ptes[Pos]) {
+        Prefetch(Ptes[Pos]);
+      }
+    }
+
+    for (size_t Pos = 0; Pos < Order.size(); Pos++) {
+      if (!Ptes[Pos] || !Ptes[Pos]->u.Present) {
+        continue;
+      }
+
+      const size_t Idx = Order[Pos];
+      const uint64_t PageBase = Ptes[Pos]->u.PageFrameNumber * Page::Size;
+      const Translation_t Translation = {
+          PageBase + Page::Offset(VirtualAddresses[Idx]), Page::Size};
+      PhysicalAddresses[Idx] = Translation.PhysicalAddress;
+      Tlb_.Insert(CacheDTBs[Pos], VirtualAddresses[Idx], Translation);
+    }
+  }
+
+  std::vector<std::optional<uint64_t>>
+  VirtTranslateBatch(const std::vector<uint64_t> &VirtualAddresses,
+                     const uint64_t DirectoryTableBase = 0) const {
+    std::vector<std::optional<uint64_t>> PhysicalAddresses(
+        VirtualAddresses.size());
+    VirtTranslateBatch(VirtualAddresses.data(), PhysicalAddresses.data(),
+                       VirtualAddresses.size(), DirectoryTableBase);
+    return PhysicalAddresses;
+  }
+
+  //
+  // Enumerate what is mapped in an address space, in ascending virtual address
+  // order. Neighbouring pages mapped to contiguous physical memory with the
+  // same permissions are reported as a single range. The subtrees of the 512
+  // PML4Es are walked by `NumberOfThreads` threads (0 uses one per hardware
+  // thread), but `Callback` is only invoked from the calling thread. Returns
+  // false if the PML4 isn't in the dump.
+  //
+
+  bool EnumerateAddressSpace(const uint64_t DirectoryTableBase,
+                             const AddressSpaceCallback_t &Callback,
+                             const uint32_t NumberOfThreads = 1) const {
+    uint64_t LocalDTB = Page::Align(GetDirectoryTableBase());
+
+    if (DirectoryTableBase) {
+      LocalDTB = Page::Align(DirectoryTableBase);
+    }
+
+    const MMPTE_HARDWARE Pml4(LocalDTB);
+    const uint64_t Pml4Base = Pml4.u.PageFrameNumber * Page::Size;
+    Page_t Buffer;
+    const auto *Pml4es =
+        (const MMPTE_HARDWARE *)GetPhysicalPage(Pml4Base, Buffer);
+    if (!Pml4es) {
+      return false;
+    }
+
+    //
+    // The page tables are scattered all over the dump, so reading ahead of
+    // them is wasted.
+    //
+
+    const uint64_t NumberOfEntries = Page::Size / sizeof(uint64_t);
+    std::vector<std::vector<VirtualRange_t>> Ranges(NumberOfEntries);
+    AdviseScan(AccessHint_t::Random);
+    ParallelFor(NumberOfThreads, NumberOfEntries, [&](const uint64_t Index) {
+
+      //
+      // The upper half of the address space starts at PML4E 256; its
+      // addresses are sign-extended to be canonical.
+      //
+
+      uint64_t VirtualAddress = Index << uint64_t(PagingLevel_t::Pml4);
+      if (Index >= (NumberOfEntries / 2)) {
+        VirtualAddress |= 0xffff'0000'0000'0000ULL;
+      }
+
+      const VirtualRange_t Root = {0, 0, 0, true, true, false};
+      WalkPagingEntry(Pml4es[Index], uint64_t(PagingLevel_t::Pml4),
+                      VirtualAddress, Root, Ranges[Index]);
+    });
+
+    AdviseScan(Options_.AccessHint);
+
+    //
+    // Stitch the ranges of the PML4Es together.
+    //
+
+    std::optional<VirtualRange_t> Pending;
+    for (const auto &EntryRanges : Ranges) {
+      for (const auto &Range : EntryRanges) {
+        if (Pending && ExtendVirtualRange(*Pending, Range)) {
+          continue;
+        }
+
+        if (Pending) {
+          Callback(*Pending);
+        }
+
+        Pending = Range;
+      }
+    }
+
+    if (Pending) {
+      Callback(*Pending);
+    }
+
+    return true;
+  }
+
+  //
+  // Build the index of the virtual addresses mapping each physical page, in
+  // the address spaces of `DirectoryTableBases` (0 being the one from the
+  // dump header). The address spaces are enumerated and the index built with
+  // `NumberOfThreads` threads.
+  //
+
+  bool BuildReverseMap(const std::vector<uint64_t> &DirectoryTableBases,
+                       ReverseMap_t &ReverseMap,
+                       const uint32_t NumberOfThreads = 1) const {
+    std::vector<uint64_t> LocalDTBs;
+    std::vector<std::vector<VirtualRange_t>> Ranges(DirectoryTableBases.size());
+    for (size_t Idx = 0; Idx < DirectoryTableBases.size(); Idx++) {
+      const uint64_t DirectoryTableBase = DirectoryTableBases[Idx];
+      LocalDTBs.push_back(DirectoryTableBase ? DirectoryTableBase
+                                             : GetDirectoryTableBase());
+      const bool Success = EnumerateAddressSpace(
+          DirectoryTableBase,
+          [&](const VirtualRange_t &Range) { Ranges[Idx].push_back(Range); },
+          NumberOfThreads);
+
+      if (!Success) {
+        return false;
+      }
+    }
+
+    return ReverseMap.Build(LocalDTBs, Ranges, NumberOfThreads);
+  }
+
+  //
+  // Scan every physical page with `NumberOfThreads` threads (0 uses one per
+  // hardware thread) for pages that look like a PML4: one of its present
+  // entries points back to the page itself, and none of them has reserved
+  // bits set or points past the end of the physical memory. The kernel half
+  // of every candidate is compared to the one of the directory table base from
+  // the dump header. The candidates are returned best score first.
+  //
+
+  std::vector<DtbCandidate_t>
+  FindDirectoryTableBases(const uint32_t NumberOfThreads = 1) const {
+    if (!EnsurePhysmem()) {
+      return {};
+    }
+
+    //
+    // Split the physical memory in jobs of at most `PagesPerJob` pages.
+    //
+
+    const uint64_t PagesPerJob = 0x1000;
+    std::vector<PhysmemSpan_t> Jobs;
+    uint64_t MaxPfn = 0;
+    for (const auto &Span : Physmem_.FileOrderSpans()) {
+      const uint64_t NumberOfPages = Span.Size / Page::Size;
+      MaxPfn = std::max(MaxPfn, (Span.PhysicalAddress / Page::Size) +
+                                    NumberOfPages - 1);
+      for (uint64_t PageIdx = 0; PageIdx < NumberOfPages;
+           PageIdx += PagesPerJob) {
+        const uint64_t Offset = PageIdx * Page::Size;
+        Jobs.push_back(PhysmemSpan_t{
+            Span.PhysicalAddress + Offset,
+            Span.Data ? Span.Data + Offset : nullptr,
+            std::min(PagesPerJob * Page::Size, Span.Size - Offset)});
+      }
+    }
+
+    const uint64_t KnownDtb = Page::Align(GetDirectoryTableBase());
+    Page_t KnownPml4Buffer;
+    const auto *KnownPml4 =
+        (const uint64_t *)GetPhysicalPage(KnownDtb, KnownPml4Buffer);
+    uint64_t KnownSelfReferenceIndex = 0;
+    if (KnownPml4) {
+      KnownSelfReferenceIndex = FindSelfReference(KnownPml4, KnownDtb);
+    }
+
+    //
+    // The jobs are in file order, so the dump is read front to back; once it
+    // has been read, it isn't needed anymore.
+    //
+
+    std::vector<std::vector<DtbCandidate_t>> Candidates(Jobs.size());
+    AdviseScan(AccessHint_t::Sequential);
+    ParallelFor(NumberOfThreads, Jobs.size(), [&](const uint64_t JobIdx) {
+      const PhysmemSpan_t &Job = Jobs[JobIdx];
+      const uint8_t *Data = Job.Data;
+      std::vector<uint8_t> Buffer;
+      if (!Data) {
+        Buffer.resize(size_t(Job.Size));
+        if (Physmem_.Read(Job.PhysicalAddress, Buffer.data(), Job.Size) !=
+            Job.Size) {
+          return;
+        }
+
+        Data = Buffer.data();
+      }
+
+      for (uint64_t Offset = 0; Offset < Job.Size; Offset += Page::Size) {
+        const uint64_t PhysicalAddress = Job.PhysicalAddress + Offset;
+        const auto &Candidate =
+            ScorePml4((const uint64_t *)(Data + Offset), PhysicalAddress,
+                      MaxPfn, KnownPml4, KnownSelfReferenceIndex);
+
+        if (Candidate) {
+          Candidates[JobIdx].push_back(*Candidate);
+        }
+      }
+    });
+
+    AdviseScan(AccessHint_t::DontNeed);
+    AdviseScan(Options_.AccessHint);
+
+    std::vector<DtbCandidate_t> Ranked;
+    for (const auto &JobCandidates : Candidates) {
+      Ranked.insert(Ranked.end(), JobCandidates.begin(), JobCandidates.end());
+    }
+
+    std::sort(Ranked.begin(), Ranked.end(),
+              [](const DtbCandidate_t &A, const DtbCandidate_t &B) {
+                if (A.Score != B.Score) {
+                  return A.Score > B.Score;
+                }
+
+                return A.DirectoryTableBase < B.DirectoryTableBase;
+              });
+
+    return Ranked;
+  }
+
+  //
+  // Tell the operating system how the whole dump file is about to be accessed;
+  // see `AccessHint_t`. Returns false if the hint couldn't be applied.
+  //
+
+  bool Advise(const AccessHint_t Hint) const {
+    if (!File_) {
+      return false;
+    }
+
+    return File_->Advise(Hint, 0, 0);
+  }
+
+  //
+  // Apply a hint to the pages of the dump backing `Size` bytes of physical
+  // memory at a physical address; the pages that aren't in the dump are
+  // skipped. Returns false if the hint couldn't be applied.
+  //
+
+  bool AdvisePhysicalRange(const AccessHint_t Hint,
+                           const uint64_t PhysicalAddress,
+                           const uint64_t Size) const {
+    if (!EnsurePhysmem()) {
+      return false;
+    }
+
+    if (Size == 0) {
+      return true;
+    }
+
+    const uint64_t LastAddress = (Size - 1) > (~0ULL - PhysicalAddress)
+                                     ? ~0ULL
+                                     : PhysicalAddress + Size - 1;
+    const uint64_t LastPfn = LastAddress / Page::Size;
+    std::vector<FileRange_t> FileRanges;
+    uint64_t Pfn = PhysicalAddress / Page::Size;
+    while (Pfn <= LastPfn) {
+      const auto &Run = Physmem_.NextRun(Pfn);
+      if (!Run || Run->Pfn > LastPfn) {
+        break;
+      }
+
+      const uint64_t PageCount =
+          std::min(Run->PageCount, LastPfn - Run->Pfn + 1);
+      FileRanges.push_back(
+          FileRange_t{Run->FileOffset, PageCount * Page::Size});
+      Pfn = Run->Pfn + PageCount;
+      if (Pfn == 0) {
+        break;
+      }
+    }
+
+    bool Success = true;
+    for (const auto &Range : MergeFileRanges(FileRanges)) {
+      Success &= File_->Advise(Hint, Range.Offset, Range.Size);
+    }
+
+    return Success;
+  }
+
+  //
+  // Apply a hint to the pages of the dump backing a set of physical pages, like
+  // the ones an emulator is about to load; the pages that aren't in the dump
+  // are skipped. Returns false if the hint couldn't be applied.
+  //
+
+  bool
+  AdvisePhysicalPages(const AccessHint_t Hint,
+                      const std::vector<uint64_t> &PhysicalAddresses) const {
+    if (!EnsurePhysmem()) {
+      return false;
+    }
+
+    bool Success = true;
+    for (const auto &Range : PagesFileRanges(PhysicalAddresses)) {
+      Success &= File_->Advise(Hint, Range.Offset, Range.Size);
+    }
+
+    return Success;
+  }
+
+  //
+  // Lock in memory the pages of the dump backing a set of physical pages, like
+  // the ones an emulator keeps accessing, so that accessing them never faults;
+  // the pages that aren't in the dump are skipped. This needs the file to be
+  // mapped. Returns false if they couldn't be locked.
+  //
+
+  bool LockPhysicalPages(const std::vector<uint64_t> &PhysicalAddresses) const {
+    if (!EnsurePhysmem()) {
+      return false;
+    }
+
+    bool Success = true;
+    for (const auto &Range : PagesFileRanges(PhysicalAddresses)) {
+      Success &= File_->Lock(Range.Offset, Range.Size);
+    }
+
+    return Success;
+  }
+
+  //
+  // Read a batch of physical pages, scattered all over the dump, with many
+  // reads in flight. The pages are sorted by file offset, and the ones that
+  // are next to each other in the file are read together; `Callback` is
+  // invoked with each page as its read completes, never by two threads at the
+  // same time. The reads go through io_uring if it is available, otherwise
+  // through a pool of threads reading the file (see `AsyncReadOptions_t`).
+  // The addresses need to be page-aligned; the pages that aren't in the dump
+  // are handed to `Callback` right away. Returns true if every page has been
+  // read.
+  //
+
+  bool ReadPhysicalPagesAsync(const std::vector<uint64_t> &PhysicalAddresses,
+                              const PageReadCallback_t &Callback,
+                              const AsyncReadOptions_t &Options = {}) const {
+    if (!EnsurePhysmem()) {
+      return false;
+    }
+
+    //
+    // Find where the pages are in the file.
+    //
+
+    struct PageRead_t {
+      uint64_t FileOffset;
+      uint64_t PhysicalAddress;
+    };
+
+    bool Success = true;
+    std::vector<PageRead_t> Reads;
+    Reads.reserve(PhysicalAddresses.size());
+    for (const uint64_t PhysicalAddress : PhysicalAddresses) {
+      const auto &FileOffset =
+          Page::Offset(PhysicalAddress)
+              ? std::nullopt
+              : Physmem_.PageOffset(PhysicalAddress / Page::Size);
+      if (!FileOffset) {
+        Success = false;
+        Callback(PhysicalAddress, nullptr);
+        continue;
+      }
+
+      Reads.push_back(PageRead_t{*FileOffset, PhysicalAddress});
+    }
+
+    std::sort(Reads.begin(), Reads.end(),
+              [](const PageRead_t &A, const PageRead_t &B) {
+                return A.FileOffset < B.FileOffset;
+              });
+
+    //
+    // Merge the pages that are next to each other in the file, or that are
+    // asked for more than once, into ranges of at most `MaxReadSize` bytes.
+    // `FirstRead` has the index of the first page of every range, and the
+    // number of pages as the last entry.
+    //
+
+    const uint64_t MaxReadSize =
+        std::max(Page::Size, Page::Align(Options.MaxReadSize));
+    std::vector<FileRange_t> Ranges;
+    std::vector<size_t> FirstRead;
+    for (size_t ReadIdx = 0; ReadIdx < Reads.size(); ReadIdx++) {
+      const uint64_t FileOffset = Reads[ReadIdx].FileOffset;
+      if (!Ranges.empty()) {
+        FileRange_t &Last = Ranges.back();
+        const uint64_t End = FileOffset + Page::Size;
+        if (FileOffset <= (Last.Offset + Last.Size) &&
+            (End - Last.Offset) <= MaxReadSize) {
+          Last.Size = std::max(Last.Size, End - Last.Offset);
+          continue;
+        }
+      }
+
+      Ranges.push_back(FileRange_t{FileOffset, Page::Size});
+      FirstRead.push_back(ReadIdx);
+    }
+
+    FirstRead.push_back(Reads.size());
+
+    AsyncReadOptions_t LocalOptions = Options;
+    LocalOptions.MaxReadSize = MaxReadSize;
+    const auto &OnRead = [&](const uint64_t RangeIdx, const uint8_t *Data,
+                             const uint64_t BytesRead) {
+      const FileRange_t &Range = Ranges[RangeIdx];
+      for (size_t ReadIdx = FirstRead[RangeIdx];
+           ReadIdx < FirstRead[RangeIdx + 1]; ReadIdx++) {
+        const PageRead_t &Read = Reads[ReadIdx];
+        const uint64_t Offset = Read.FileOffset - Range.Offset;
+        const uint8_t *PageData = nullptr;
+        if (Data && (Offset + Page::Size) <= BytesRead) {
+          PageData = Data + Offset;
+        }
+
+        Success &= PageData != nullptr;
+        Callback(Read.PhysicalAddress, PageData);
+      }
+    };
+
+#if defined(KDMPPARSER_IO_URING)
+    if (Options.UseIoUring && Source_ == Source_t::Path && !Compressed_ &&
+        IoUringRead(PathFile_.string().c_str(), Ranges, LocalOptions, OnRead)) {
+      return Success;
+    }
+#endif
+
+    ThreadPoolRead(*File_, Ranges, LocalOptions, OnRead);
+    return Success;
+  }
+
+  //
+  // Get how long setting up the view of the file took; see `ParseOptions_t`.
+  //
+
+  const MapReport_t &GetMapReport() const { return MapReport_; }
+
+  //
+  // Is the dump a compressed dump (see `CompressFile`)?
+  //
+
+  bool IsCompressed() const { return Compressed_; }
+
+  //
+  // Drop the translations cached in the software TLB and the paging-structure
+  // cache; either every one of them or only the ones of a directory table
+  // base. The kernel half of the address spaces that share it with the
+  // directory table base from the dump header is cached under the latter.
+  //
+
+  void
+  InvalidateTlb(const std::optional<uint64_t> &DirectoryTableBase = {}) const {
+    if (DirectoryTableBase) {
+      Tlb_.Invalidate(Page::Align(*DirectoryTableBase));
+      Psc_.Invalidate(Page::Align(*DirectoryTableBase));
+      SharedDTBs_.Invalidate(Page::Align(*DirectoryTableBase));
+      return;
+    }
+
+    Tlb_.Invalidate();
+    Psc_.Invalidate();
+    SharedDTBs_.Invalidate();
+  }
+
+  //
+  // Read virtual memory using a directory table base; the address doesn't need
+  // to be page-aligned and the read can span several pages. Each page is
+  // translated once, large pages included, and copied in one go. The read
+  // stops at the first byte that doesn't translate or isn't in the dump.
+  // Returns the number of bytes written to `Out`.
+  //
+
+  size_t ReadVirtualMemoryPartial(const uint64_t VirtualAddress, void *Out,
+                                  const size_t Size,
+                                  const uint64_t DirectoryTableBase = 0) const {
+    uint8_t *Buffer = (uint8_t *)Out;
+    size_t BytesRead = 0;
+    while (BytesRead < Size) {
+      const uint64_t Address = VirtualAddress + BytesRead;
+      const auto &Translation = GetTranslation(Address, DirectoryTableBase);
+      if (!Translation) {
+        break;
+      }
+
+      const uint64_t PageOffset = Address & (Translation->PageSize - 1);
+      const size_t ChunkSize = size_t(std::min(
+          uint64_t(Size - BytesRead), Translation->PageSize - PageOffset));
+      const size_t ChunkRead = ReadPhysicalMemoryPartial(
+          Translation->PhysicalAddress, Buffer + BytesRead, ChunkSize);
+
+      BytesRead += ChunkRead;
+      if (ChunkRead != ChunkSize) {
+        break;
+      }
+    }
+
+    return BytesRead;
+  }
+
+  //
+  // Read virtual memory; returns true if all `Size` bytes have been written to
+  // `Out`.
+  //
+
+  bool ReadVirtualMemory(const uint64_t VirtualAddress, void *Out,
+                         const size_t Size,
+                         const uint64_t DirectoryTableBase = 0) const {
+    return ReadVirtualMemoryPartial(VirtualAddress, Out, Size,
+                                    DirectoryTableBase) == Size;
+  }
+
+  //
+  // Get the content of a virtual address.
+  //
+
+  const uint8_t *GetVirtualPage(const uint64_t VirtualAddress,
+                                const uint64_t DirectoryTableBase = 0) const {
+
+    //
+    // First remove offset and translate the virtual address.
+    //
+
+    const auto &PhysicalAddress =
+        VirtTranslate(Page::Align(VirtualAddress), DirectoryTableBase);
+
+    if (!PhysicalAddress) {
+      return nullptr;
+    }
+
+    //
+    // Then get the physical page.
+    //
+
+    return GetPhysicalPage(*PhysicalAddress);
+  }
+
+  const HEADER64 &GetDumpHeader() const {
+    if (!DmpHdr_) {
+      std::abort();
+    }
+
+    return *DmpHdr_;
+  }
+
+private:
+  //
+  // Parse a dump from wherever it is read from.
+  //
+
+  bool ParseSource(const Source_t Source, const char *PathFile, const int Fd,
+                   const void *Buffer, const uint64_t BufferSize,
+                   const ParseOptions_t &Options) {
+    if (PhysmemBuilder_.joinable()) {
+      PhysmemBuilder_.join();
+    }
+
+    Options_ = Options;
+    PhysmemState_ = PhysmemState_t::Failed;
+    Tlb_.SetCapacity(Options_.TlbCapacity);
+    Psc_.SetCapacity(Options_.PagingStructureCacheCapacity);
+    SharedDTBs_.SetCapacity(
+        (Tlb_.Enabled() || Psc_.Enabled()) ? SharedDTBsCapacity : 0);
+
+    //
+    // Copy the path file, or where the dump is otherwise.
+    //
+
+    Source_ = Source;
+    PathFile_ = std::filesystem::path(PathFile ? PathFile : "");
+    Descriptor_ = Fd;
+    Buffer_ = Buffer;
+    BufferSize_ = BufferSize;
+    if (Source_ == Source_t::Path && !std::filesystem::exists(PathFile_)) {
+      Diagnostics::Report(Severity_t::Error, DiagnosticCode_t::FileNotFound,
+                          "Invalid file: %s.", PathFile_.string().c_str());
+      return false;
+    }
+
+    //
+    // Map a view of the file.
+    //
+
+    if (!MapFile()) {
+      Diagnostics::Report(Severity_t::Error, DiagnosticCode_t::MapFileFailed,
+                          "MapFile failed.");
+      return false;
+    }
+
+    //
+    // Parse the DMP_HEADER.
+    //
+
+    if (!ParseDmpHeader()) {
+      Diagnostics::Report(Severity_t::Error, DiagnosticCode_t::InvalidHeader,
+                          "ParseDmpHeader failed.");
+      return false;
+    }
+
+    //
+    // Build the index of the physical memory now, unless it has been asked to
+    // do it lazily.
+    //
+
+    PhysmemState_ = PhysmemState_t::NotBuilt;
+    if (!Options_.LazyPhysmem) {
+      return EnsurePhysmem();
+    }
+
+    if (Options_.BuildPhysmemInBackground) {
+      PhysmemBuilder_ = std::thread([this]() { EnsurePhysmem(); });
+    }
+
+    return true;
+  }
+
+  //
+  // Walk the page tables to translate a virtual address.
+  //
+
+  std::optional<Translation_t>
+  WalkPageTables(const uint64_t VirtualAddress, const uint64_t LocalDTB) const {
+
+    //
+    // Stole code from @yrp604 and @0vercl0k.
+    //
+
+    const VIRTUAL_ADDRESS GuestAddress(VirtualAddress);
+
+    //
+    // Resume the walk at the deepest level that is in the paging-structure
+    // cache.
+    //
+
+    auto Pde = Psc_.Lookup(LocalDTB, PagingLevel_t::Pd, VirtualAddress);
+    std::optional<MMPTE_HARDWARE> Pdpte;
+    if (!Pde) {
+      Pdpte = Psc_.Lookup(LocalDTB, PagingLevel_t::Pdpt, VirtualAddress);
+    }
+
+    if (!Pde && !Pdpte) {
+      auto Pml4e = Psc_.Lookup(LocalDTB, PagingLevel_t::Pml4, VirtualAddress);
+      if (!Pml4e) {
+        const MMPTE_HARDWARE Pml4(LocalDTB);
+        const uint64_t Pml4Base = Pml4.u.PageFrameNumber * Page::Size;
+        const uint64_t Pml4eGpa = Pml4Base + GuestAddress.u.Pml4Index * 8;
+        Pml4e = PhyRead8(Pml4eGpa);
+        if (!Pml4e->u.Present) {
+          Diagnostics::Report(
+              Severity_t::Debug, DiagnosticCode_t::InvalidPml4e,
+              "Invalid page map level 4, address translation failed!");
+          return {};
+        }
+
+        Psc_.Insert(LocalDTB, PagingLevel_t::Pml4, VirtualAddress, *Pml4e);
+      }
+
+      const uint64_t PdptBase = Pml4e->u.PageFrameNumber * Page::Size;
+      const uint64_t PdpteGpa = PdptBase + GuestAddress.u.PdPtIndex * 8;
+      Pdpte = PhyRead8(PdpteGpa);
+      if (!Pdpte->u.Present) {
+        Diagnostics::Report(Severity_t::Debug, DiagnosticCode_t::InvalidPdpte,
+                            "Invalid page directory pointer table, address "
+                            "translation failed!");
+        return {};
+      }
+
+      Psc_.Insert(LocalDTB, PagingLevel_t::Pdpt, VirtualAddress, *Pdpte);
+    }
+
+    if (!Pde) {
+
+      //
+      // huge pages:
+      // 7 (PS) - Page size; must be 1 (otherwise, this entry references a page
+      // directory; see Table 4-1
+      //
+
+      const uint64_t PdBase = Pdpte->u.PageFrameNumber * Page::Size;
+      if (Pdpte->u.LargePage) {
+        return Translation_t{PdBase + (VirtualAddress & 0x3fff'ffff),
+                             0x4000'0000};
+      }
+
+      const uint64_t PdeGpa = PdBase + GuestAddress.u.PdIndex * 8;
+      Pde = PhyRead8(PdeGpa);
+      if (!Pde->u.Present) {
+        Diagnostics::Report(
+            Severity_t::Debug, DiagnosticCode_t::InvalidPde,
+            "Invalid page directory entry, address translation failed!");
+        return {};
+      }
+
+      Psc_.Insert(LocalDTB, PagingLevel_t::Pd, VirtualAddress, *Pde);
+    }
+
+    //
+    // large pages:
+    // 7 (PS) - Page size; must be 1 (otherwise, this entry references a page
+    // table; see Table 4-18
+    //
+
+    const uint64_t PtBase = Pde->u.PageFrameNumber * Page::Size;
+    if (Pde->u.LargePage) {
+      return Translation_t{PtBase + (VirtualAddress & 0x1f'ffff), 0x20'0000};
+    }
+
+    const uint64_t PteGpa = PtBase + GuestAddress.u.PtIndex * 8;
+    const MMPTE_HARDWARE Pte(PhyRead8(PteGpa));
+    if (!Pte.u.Present) {
+      Diagnostics::Report(
+          Severity_t::Debug, DiagnosticCode_t::InvalidPte,
+          "Invalid page table entry, address translation failed!");
+      return {};
+    }
+
+    const uint64_t PageBase = Pte.u.PageFrameNumber * Page::Size;
+    return Translation_t{PageBase + GuestAddress.u.Offset, Page::Size};
+  }
+
+  //
+  // Get the directory table base under which the translation of a virtual
+  // address is cached. Every process shares the kernel half of the address
+  // space: when a kernel address is translated through the same PML4E as in
+  // the directory table base from the dump header, the rest of the walk is the
+  // same too, so the walk is done and cached as if it were for the latter.
+  // This way, translating kernel addresses for many processes only fills the
+  // caches once. Comparing the PML4Es takes two reads, so which directory
+  // table base a PML4E ends up under is cached as well.
+  //
+
+  uint64_t SharedDirectoryTableBase(const uint64_t LocalDTB,
+                                    const uint64_t VirtualAddress) const {
+    const uint64_t PrimaryDTB = Page::Align(GetDirectoryTableBase());
     const VIRTUAL_ADDRESS GuestAddress(VirtualAddress);
+    const uint64_t KernelPml4Index = (Page::Size / sizeof(uint64_t)) / 2;
+    if (LocalDTB == PrimaryDTB || !SharedDTBs_.Enabled() ||
+        GuestAddress.u.Pml4Index < KernelPml4Index) {
+      return LocalDTB;
+    }
+
+    const auto &Cached = SharedDTBs_.Lookup(LocalDTB, GuestAddress.u.Pml4Index);
+    if (Cached) {
+      return *Cached;
+    }
+
+    const uint64_t SharedDTB =
+        PagingEntriesMatch(LocalDTB, PrimaryDTB, GuestAddress.u.Pml4Index)
+            ? PrimaryDTB
+            : LocalDTB;
+    SharedDTBs_.Insert(LocalDTB, GuestAddress.u.Pml4Index, SharedDTB);
+    return SharedDTB;
+  }
+
+  //
+  // Are the PML4Es at an index of two directory table bases the same?
+  //
+
+  bool PagingEntriesMatch(const uint64_t LocalDTB, const uint64_t PrimaryDTB,
+                          const uint64_t Pml4Index) const {
+
     const MMPTE_HARDWARE Pml4(LocalDTB);
-    const uint64_t Pml4Base = Pml4.u.PageFrameNumber * Page::Size;
-    const uint64_t Pml4eGpa = Pml4Base + GuestAddress.u.Pml4Index * 8;
-    const MMPTE_HARDWARE Pml4e(PhyRead8(Pml4eGpa));
-    if (!Pml4e.u.Present) {
-      printf("Invalid page map level 4, address translation failed!\n");
+    const MMPTE_HARDWARE PrimaryPml4(PrimaryDTB);
+    MMPTE_HARDWARE Buffer(0), PrimaryBuffer(0);
+    const MMPTE_HARDWARE *Pml4e = GetPagingEntry(
+        Pml4.u.PageFrameNumber * Page::Size, Pml4Index, Buffer);
+    const MMPTE_HARDWARE *PrimaryPml4e = GetPagingEntry(
+        PrimaryPml4.u.PageFrameNumber * Page::Size, Pml4Index, PrimaryBuffer);
+
+    return Pml4e && PrimaryPml4e && Pml4e->AsUINT64 == PrimaryPml4e->AsUINT64;
+  }
+
+  //
+  // Get a pointer to an entry of a paging structure, or nullptr if the page
+  // that holds it isn't in the dump. When the dump file isn't mapped, the
+  // entry is copied to `Buffer`.
+  //
+
+  const MMPTE_HARDWARE *GetPagingEntry(const uint64_t TableBase,
+                                       const uint64_t Index,
+                                       MMPTE_HARDWARE &Buffer) const {
+    if (!EnsurePhysmem()) {
+      return nullptr;
+    }
+
+    if (!Physmem_.Mapped()) {
+      const uint64_t EntryAddress = TableBase + Index * sizeof(uint64_t);
+      const bool Success = Physmem_.ReadPage(
+          EntryAddress, (uint8_t *)&Buffer.AsUINT64, sizeof(Buffer));
+      return Success ? &Buffer : nullptr;
+    }
+
+    const uint8_t *Table = Physmem_.GetPage(TableBase);
+    if (!Table) {
+      return nullptr;
+    }
+
+    return (const MMPTE_HARDWARE *)(Table + Index * sizeof(uint64_t));
+  }
+
+  //
+  // Get a present entry of an upper-level paging structure, from the
+  // paging-structure cache if possible. Nothing is returned if the entry isn't
+  // present or can't be read.
+  //
+
+  std::optional<MMPTE_HARDWARE>
+  LoadPagingEntry(const uint64_t LocalDTB, const PagingLevel_t Level,
+                  const uint64_t VirtualAddress, const uint64_t TableBase,
+                  const uint64_t Index) const {
+    const auto &Cached = Psc_.Lookup(LocalDTB, Level, VirtualAddress);
+    if (Cached) {
+      return Cached;
+    }
+
+    MMPTE_HARDWARE Buffer(0);
+    const MMPTE_HARDWARE *Entry = GetPagingEntry(TableBase, Index, Buffer);
+    if (!Entry || !Entry->u.Present) {
+      return {};
+    }
+
+    Psc_.Insert(LocalDTB, Level, VirtualAddress, *Entry);
+    return *Entry;
+  }
+
+  //
+  // Walk the subtree of a paging structure entry that maps the virtual
+  // addresses starting at `VirtualAddress`, and append the ranges it maps to
+  // `Ranges`. `Shift` is the number of bits of virtual address the entry
+  // covers, and `Parent` holds the permissions of the entries above it.
+  //
+
+  void WalkPagingEntry(const MMPTE_HARDWARE Entry, const uint64_t Shift,
+                       const uint64_t VirtualAddress,
+                       const VirtualRange_t &Parent,
+                       std::vector<VirtualRange_t> &Ranges) const {
+    if (!Entry.u.Present) {
+      return;
+    }
+
+    const uint64_t Base = Entry.u.PageFrameNumber * Page::Size;
+    VirtualRange_t Range;
+    Range.VirtualAddress = VirtualAddress;
+    Range.PhysicalAddress = Base;
+    Range.Size = 1ULL << Shift;
+    Range.Write = Parent.Write && Entry.u.Write;
+    Range.UserAccessible = Parent.UserAccessible && Entry.u.UserAccessible;
+    Range.NoExecute = Parent.NoExecute || Entry.u.NoExecute;
+
+    //
+    // PDPTEs and PDEs map 1GB and 2MB pages if their PS bit is set, and PTEs
+    // always map pages.
+    //
+
+    const bool MapsPage =
+        Range.Size == Page::Size ||
+        (Entry.u.LargePage && (Shift == uint64_t(PagingLevel_t::Pdpt) ||
+                               Shift == uint64_t(PagingLevel_t::Pd)));
+
+    if (MapsPage) {
+      if (Ranges.empty() || !ExtendVirtualRange(Ranges.back(), Range)) {
+        Ranges.push_back(Range);
+      }
+
+      return;
+    }
+
+    WalkPagingStructure(Range, Shift - 9, Ranges);
+  }
+
+  //
+  // Walk the entries of the paging structure an entry points to; `Parent`
+  // describes the entry and `Shift` is the number of bits of virtual address
+  // the entries cover. The buffer the structure is copied to, when the dump
+  // file isn't mapped, lives here rather than in `WalkPagingEntry` so that
+  // only one is on the stack per level.
+  //
+
+  void WalkPagingStructure(const VirtualRange_t &Parent, const uint64_t Shift,
+                           std::vector<VirtualRange_t> &Ranges) const {
+    Page_t Buffer;
+    const auto *Entries =
+        (const MMPTE_HARDWARE *)GetPhysicalPage(Parent.PhysicalAddress, Buffer);
+    if (!Entries) {
+      return;
+    }
+
+    for (uint64_t Index = 0; Index < (Page::Size / sizeof(uint64_t)); Index++) {
+      WalkPagingEntry(Entries[Index], Shift,
+                      Parent.VirtualAddress + (Index << Shift), Parent, Ranges);
+    }
+  }
+
+  //
+  // Grow `Range` with `Next` if it directly follows it, in both virtual and
+  // physical memory, with the same permissions.
+  //
+
+  static bool ExtendVirtualRange(VirtualRange_t &Range,
+                                 const VirtualRange_t &Next) {
+    const bool Extends =
+        (Range.VirtualAddress + Range.Size) == Next.VirtualAddress &&
+        (Range.PhysicalAddress + Range.Size) == Next.PhysicalAddress &&
+        Range.Write == Next.Write &&
+        Range.UserAccessible == Next.UserAccessible &&
+        Range.NoExecute == Next.NoExecute;
+
+    if (Extends) {
+      Range.Size += Next.Size;
+    }
+
+    return Extends;
+  }
+
+  //
+  // Bits of a paging structure entry holding the page frame number, and the
+  // reserved ones above it.
+  //
+
+  static constexpr uint64_t PfnMask = 0x0000'ffff'ffff'f000ULL;
+  static constexpr uint64_t ReservedMask = 0x000f'0000'0000'0000ULL;
+
+  //
+  // Get the index of the present entry of a PML4 pointing back to itself, or
+  // the number of entries if there is none.
+  //
+
+  static uint64_t FindSelfReference(const uint64_t *Pml4,
+                                    const uint64_t PhysicalAddress) {
+    const uint64_t NumberOfEntries = Page::Size / sizeof(uint64_t);
+    for (uint64_t Index = 0; Index < NumberOfEntries; Index++) {
+      const uint64_t Entry = Pml4[Index];
+      if ((Entry & 1) && (Entry & PfnMask) == PhysicalAddress) {
+        return Index;
+      }
+    }
+
+    return NumberOfEntries;
+  }
+
+  //
+  // Get 1 if a value is zero, 0 otherwise, without a comparison; 64-bit
+  // comparisons don't vectorize on baseline x64.
+  //
+
+  static constexpr uint64_t IsZero(const uint64_t Value) {
+    return 1 ^ ((Value | (0 - Value)) >> 63);
+  }
+
+  //
+  // Check if a page looks like a PML4 and score it. The loops over the entries
+  // only use arithmetic and bitwise operations so that the compiler vectorizes
+  // them; this is what the scan spends its time on. An entry is implausible if
+  // its PS bit or reserved bits are set, or if it points past `MaxPfn`.
+  //
+
+  static std::optional<DtbCandidate_t>
+  ScorePml4(const uint64_t *Entries, const uint64_t PhysicalAddress,
+            const uint64_t MaxPfn, const uint64_t *KnownPml4,
+            const uint64_t KnownSelfReferenceIndex) {
+    const uint64_t NumberOfEntries = Page::Size / sizeof(uint64_t);
+    const uint64_t MaxAddress = MaxPfn * Page::Size;
+    const uint64_t LargePageMask = 0x80;
+    uint64_t NumberOfPresentEntries = 0;
+    uint64_t NumberOfSelfReferences = 0;
+    uint64_t ImplausibleBits = 0;
+    for (uint64_t Index = 0; Index < NumberOfEntries; Index++) {
+      const uint64_t Entry = Entries[Index];
+      const uint64_t Present = Entry & 1;
+      const uint64_t Address = Entry & PfnMask;
+      const uint64_t PastMaxAddress = (MaxAddress - Address) >> 63;
+      NumberOfPresentEntries += Present;
+      NumberOfSelfReferences += Present & IsZero(Address ^ PhysicalAddress);
+      ImplausibleBits |= (0 - Present) &
+                         ((Entry & (LargePageMask | ReservedMask)) |
+                          PastMaxAddress);
+    }
+
+    if (NumberOfSelfReferences == 0 || ImplausibleBits != 0) {
       return {};
     }
 
-    const uint64_t PdptBase = Pml4e.u.PageFrameNumber * Page::Size;
-    const uint64_t PdpteGpa = PdptBase + GuestAddress.u.PdPtIndex * 8;
-    const MMPTE_HARDWARE Pdpte(PhyRead8(PdpteGpa));
-    if (!Pdpte.u.Present) {
-      printf("Invalid page directory pointer table, address translation "
-             "failed!\n");
-      return {};
-    }
+    DtbCandidate_t Candidate = {};
+    Candidate.DirectoryTableBase = PhysicalAddress;
+    Candidate.SelfReferenceIndex = FindSelfReference(Entries, PhysicalAddress);
+    Candidate.NumberOfPresentEntries = uint32_t(NumberOfPresentEntries);
+    if (KnownPml4) {
+      uint64_t NumberOfKernelMatches = 0;
+      for (uint64_t Index = NumberOfEntries / 2; Index < NumberOfEntries;
+           Index++) {
+        NumberOfKernelMatches += IsZero(Entries[Index] ^ KnownPml4[Index]);
+      }
+
+      Candidate.NumberOfKernelMatches = uint32_t(NumberOfKernelMatches);
+      Candidate.Score = uint32_t(
+          (NumberOfKernelMatches * 2) +
+          (Candidate.SelfReferenceIndex == KnownSelfReferenceIndex));
+    }
+
+    return Candidate;
+  }
+
+  //
+  // Hint the processor that a location is about to be read.
+  //
+
+  static void Prefetch(const void *Address) {
+#if defined(_MSC_VER) && (defined(ARCH_X86) || defined(ARCH_X64))
+    _mm_prefetch((const char *)Address, _MM_HINT_T0);
+#elif defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(Address);
+#else
+    (void)Address;
+#endif
+  }
+
+  //
+  // Build the index of the physical memory.
+  //
+
+  bool BuildPhysmem() const {
 
     //
-    // huge pages:
-    // 7 (PS) - Page size; must be 1 (otherwise, this entry references a page
-    // directory; see Table 4-1
+    // Use the index file if there is an up to date one. The index of bitmap
+    // dumps is cheaper to build than to check, so they don't have one.
     //
 
-    const uint64_t PdBase = Pdpte.u.PageFrameNumber * Page::Size;
-    if (Pdpte.u.LargePage) {
-      return PdBase + (VirtualAddress & 0x3fff'ffff);
-    }
+    IndexFileKey_t IndexFileKey;
+    const std::filesystem::path &IndexFilePath =
+        IndexFile_t::PathFor(PathFile_);
+    const bool UseIndexFile =
+        Options_.UseIndexFile && Source_ == Source_t::Path &&
+        InBounds(DmpHdr_, sizeof(*DmpHdr_)) &&
+        DmpHdr_->DumpType != DumpType_t::BMPDump &&
+        DmpHdr_->DumpType != DumpType_t::LiveKernelBitmapDump &&
+        IndexFile_t::ComputeKey(PathFile_, File_->Size(), (uint8_t *)DmpHdr_,
+                                sizeof(*DmpHdr_), IndexFileKey);
+
+    if (UseIndexFile) {
+      if (IndexFile_.Load(IndexFilePath, IndexFileKey, Physmem_)) {
+        return true;
+      }
 
-    const uint64_t PdeGpa = PdBase + GuestAddress.u.PdIndex * 8;
-    const MMPTE_HARDWARE Pde(PhyRead8(PdeGpa));
-    if (!Pde.u.Present) {
-      printf("Invalid page directory entry, address translation failed!\n");
-      return {};
+      Physmem_ = Physmem_t();
+      SetPhysmemView();
     }
 
     //
-    // large pages:
-    // 7 (PS) - Page size; must be 1 (otherwise, this entry references a page
-    // table; see Table 4-18
+    // Retrieve the physical memory according to the type of dump we have.
     //
 
-    const uint64_t PtBase = Pde.u.PageFrameNumber * Page::Size;
-    if (Pde.u.LargePage) {
-      return PtBase + (VirtualAddress & 0x1f'ffff);
+    switch (DmpHdr_->DumpType) {
+    case DumpType_t::FullDump: {
+      if (!BuildPhysmemFullDump()) {
+        Diagnostics::Report(Severity_t::Error,
+                            DiagnosticCode_t::BuildPhysmemFailed,
+                            "BuildPhysmemFullDump failed.");
+        return false;
+      }
+      break;
     }
-
-    const uint64_t PteGpa = PtBase + GuestAddress.u.PtIndex * 8;
-    const MMPTE_HARDWARE Pte(PhyRead8(PteGpa));
-    if (!Pte.u.Present) {
-      printf("Invalid page table entry, address translation failed!\n");
-      return {};
+    case DumpType_t::LiveKernelBitmapDump:
+    case DumpType_t::BMPDump: {
+      if (!BuildPhysmemBMPDump()) {
+        Diagnostics::Report(Severity_t::Error,
+                            DiagnosticCode_t::BuildPhysmemFailed,
+                            "BuildPhysmemBMPDump failed.");
+        return false;
+      }
+      break;
     }
 
-    const uint64_t PageBase = Pte.u.PageFrameNumber * Page::Size;
-    return PageBase + GuestAddress.u.Offset;
-  }
-
-  //
-  // Get the content of a virtual address.
-  //
+    case DumpType_t::CompleteMemoryDump:
+    case DumpType_t::KernelAndUserMemoryDump:
+    case DumpType_t::KernelMemoryDump: {
+      if (!BuildPhysicalMemoryFromDump(DmpHdr_->DumpType)) {
+        Diagnostics::Report(Severity_t::Error,
+                            DiagnosticCode_t::BuildPhysmemFailed,
+                            "BuildPhysicalMemoryFromDump failed.");
+        return false;
+      }
+      break;
+    }
 
-  const uint8_t *GetVirtualPage(const uint64_t VirtualAddress,
-                                const uint64_t DirectoryTableBase = 0) const {
+    default: {
+      Diagnostics::Report(Severity_t::Error, DiagnosticCode_t::UnknownDumpType,
+                          "Invalid type");
+      return false;
+    }
+    }
 
     //
-    // First remove offset and translate the virtual address.
+    // Sort the runs now that we have all of them.
     //
 
-    const auto &PhysicalAddress =
-        VirtTranslate(Page::Align(VirtualAddress), DirectoryTableBase);
-
-    if (!PhysicalAddress) {
-      return nullptr;
-    }
+    Physmem_.Finalize();
 
     //
-    // Then get the physical page.
+    // Failing to write the index file is fine; the dump might be on a
+    // read-only volume for example.
     //
 
-    return GetPhysicalPage(*PhysicalAddress);
-  }
-
-  const HEADER64 &GetDumpHeader() const {
-    if (!DmpHdr_) {
-      std::abort();
+    if (UseIndexFile) {
+      IndexFile_t::Write(IndexFilePath, IndexFileKey, Physmem_);
     }
 
-    return *DmpHdr_;
+    return true;
   }
 
-private:
   //
   // Utility function to read an uint64_t from a physical address.
   //
@@ -423,33 +2031,38 @@ private:
   uint64_t PhyRead8(const uint64_t PhysicalAddress) const {
 
     //
-    // Get the physical page and read from the offset.
+    // Find the physical page and read from the offset.
     //
 
-    const uint8_t *PhysicalPage = GetPhysicalPage(Page::Align(PhysicalAddress));
-
-    if (!PhysicalPage) {
-      printf("Internal page table parsing failed!\n");
+    uint64_t Value = 0;
+    if (!EnsurePhysmem() ||
+        !Physmem_.ReadPage(PhysicalAddress, (uint8_t *)&Value,
+                           sizeof(Value))) {
+      Diagnostics::Report(Severity_t::Debug,
+                          DiagnosticCode_t::MissingPagingStructure,
+                          "Internal page table parsing failed!");
       return 0;
     }
 
-    const uint64_t *Ptr =
-        (uint64_t *)(PhysicalPage + Page::Offset(PhysicalAddress));
-    return *Ptr;
+    return Value;
   }
 
   //
   // Build a map of physical addresses / page data pointers for full dump.
   //
 
-  bool BuildPhysmemFullDump() {
+  bool BuildPhysmemFullDump() const {
 
     //
     // Walk through the runs.
     //
 
-    uint8_t *RunBase = (uint8_t *)&DmpHdr_->u3.BmpHeader;
+    uint64_t RunOffset = FileOffset(&DmpHdr_->u3.BmpHeader);
     const uint32_t NumberOfRuns = DmpHdr_->u1.PhysicalMemoryBlock.NumberOfRuns;
+    const PHYSMEM_RUN *Runs = DmpHdr_->u1.PhysicalMemoryBlock.Run;
+    if (NumberOfRuns && !InBounds(Runs, NumberOfRuns * sizeof(*Runs))) {
+      return false;
+    }
 
     //
     // Back at it, this time building the index!
@@ -461,115 +2074,75 @@ private:
       // Grab the current run as well as its base page and page count.
       //
 
-      const PHYSMEM_RUN *Run = DmpHdr_->u1.PhysicalMemoryBlock.Run + RunIdx;
+      const PHYSMEM_RUN *Run = Runs + RunIdx;
 
       const uint64_t BasePage = Run->BasePage;
       const uint64_t PageCount = Run->PageCount;
 
       //
-      // Walk the pages from the run.
+      // Now one thing to understand is that the Runs structure allows to
+      // skip for holes in memory. Instead of, padding them with empty
+      // spaces to conserve a 1:1 mapping between physical address and file
+      // offset, the Run gives you the base Pfn. This means that we don't
+      // have a 1:1 mapping between file offset and physical addresses so we
+      // need to keep track of where the Run starts in memory and then we
+      // can simply access our pages one after the other.
+      //
+      // If this is not clear enough, here is a small example:
+      //  Run[0]
+      //    BasePage = 1337, PageCount = 2
+      //  Run[1]
+      //    BasePage = 1400, PageCount = 1
+      //
+      // In the above we clearly see that there is a hole between the two
+      // runs; the dump file has 2+1 memory pages. Their Pfns are: 1337+0,
+      // 1337+1, 1400+0.
+      //
+      // Now if we want to get the file offset of those pages we start at
+      // Run0:
+      //   Run0 starts at file offset 0x2000 so Page0 is at file offset
+      //   0x2000, Page1 is at file offset 0x3000. Run1 starts at file
+      //   offset 0x2000+(2*0x1000) so Page3 is at file offset
+      //   0x2000+(2*0x1000)+0x1000.
+      //
+      // That is the reason why the index stores, for every run, the Pfn of
+      // its first page as well as its file offset.
       //
 
-      for (uint64_t PageIdx = 0; PageIdx < PageCount; PageIdx++) {
-
-        //
-        // Compute the current PFN as well as the actual physical address of
-        // the page.
-        //
-
-        const uint64_t Pfn = BasePage + PageIdx;
-        const uint64_t Pa = Pfn * Page::Size;
-
-        //
-        // Now one thing to understand is that the Runs structure allows to
-        // skip for holes in memory. Instead of, padding them with empty
-        // spaces to conserve a 1:1 mapping between physical address and file
-        // offset, the Run gives you the base Pfn. This means that we don't
-        // have a 1:1 mapping between file offset and physical addresses so we
-        // need to keep track of where the Run starts in memory and then we
-        // can simply access our pages one after the other.
-        //
-        // If this is not clear enough, here is a small example:
-        //  Run[0]
-        //    BasePage = 1337, PageCount = 2
-        //  Run[1]
-        //    BasePage = 1400, PageCount = 1
-        //
-        // In the above we clearly see that there is a hole between the two
-        // runs; the dump file has 2+1 memory pages. Their Pfns are: 1337+0,
-        // 1337+1, 1400+0.
-        //
-        // Now if we want to get the file offset of those pages we start at
-        // Run0:
-        //   Run0 starts at file offset 0x2000 so Page0 is at file offset
-        //   0x2000, Page1 is at file offset 0x3000. Run1 starts at file
-        //   offset 0x2000+(2*0x1000) so Page3 is at file offset
-        //   0x2000+(2*0x1000)+0x1000.
-        //
-        // That is the reason why the computation below is RunBase + (PageIdx
-        // * 0x1000) instead of RunBase + (Pfn * 0x1000).
-
-        const uint8_t *PageBase = RunBase + (PageIdx * Page::Size);
-
-        //
-        // Map the Pfn to a page.
-        //
-
-        Physmem_.try_emplace(Pa, PageBase);
-      }
+      Physmem_.AddRun(BasePage, PageCount, RunOffset);
 
       //
       // Move the run base past all the pages in the current run.
       //
 
-      RunBase += PageCount * Page::Size;
+      RunOffset += PageCount * Page::Size;
     }
 
     return true;
   }
 
   //
-  // Build a map of physical addresses / page data pointers for BMP dump.
+  // Build the index of the physical memory for BMP dump. The pages are stored
+  // in increasing Pfn order, so the index is a rank directory over the bitmap:
+  // the position of a page in the file is the number of bits set before its
+  // Pfn.
   //
 
-  bool BuildPhysmemBMPDump() {
-    const uint8_t *Page = (uint8_t *)DmpHdr_ + DmpHdr_->u3.BmpHeader.FirstPage;
+  bool BuildPhysmemBMPDump() const {
+    const uint64_t FirstPage = DmpHdr_->u3.BmpHeader.FirstPage;
     const uint64_t BitmapSize = DmpHdr_->u3.BmpHeader.Pages / 8;
     const uint8_t *Bitmap = DmpHdr_->u3.BmpHeader.Bitmap.data();
 
     //
-    // Walk the bitmap byte per byte.
+    // Make sure the bitmap is in bounds as it is read to build the index.
     //
 
-    for (uint64_t BitmapIdx = 0; BitmapIdx < BitmapSize; BitmapIdx++) {
-
-      //
-      // Now walk the bits of the current byte.
-      //
-
-      const uint8_t Byte = Bitmap[BitmapIdx];
-      for (uint8_t BitIdx = 0; BitIdx < 8; BitIdx++) {
-
-        //
-        // If the bit is not set we just skip to the next.
-        //
-
-        const bool BitSet = ((Byte >> BitIdx) & 1) == 1;
-        if (!BitSet) {
-          continue;
-        }
-
-        //
-        // If the bit is one we add the page to the physmem.
-        //
-
-        const uint64_t Pfn = (BitmapIdx * 8) + BitIdx;
-        const uint64_t Pa = Pfn * Page::Size;
-        Physmem_.try_emplace(Pa, Page);
-        Page += Page::Size;
-      }
+    if (BitmapSize && !InBounds(Bitmap, BitmapSize)) {
+      return false;
     }
 
+    Physmem_.SetBitmap(Bitmap, BitmapSize, FirstPage,
+                       Options_.NumberOfThreads);
     return true;
   }
 
@@ -581,9 +2154,8 @@ private:
   // Returns true on success, false otherwise.
   //
 
-  bool BuildPhysicalMemoryFromDump(const DumpType_t Type) {
+  bool BuildPhysicalMemoryFromDump(const DumpType_t Type) const {
     uint64_t FirstPageOffset = 0;
-    uint8_t *Page = nullptr;
     uint64_t MetadataSize = 0;
     uint8_t *Bitmap = nullptr;
     uint64_t TotalNumberOfPages = 0;
@@ -593,7 +2165,6 @@ private:
     case DumpType_t::KernelMemoryDump:
     case DumpType_t::KernelAndUserMemoryDump: {
       FirstPageOffset = DmpHdr_->u3.RdmpHeader.Hdr.FirstPageOffset;
-      Page = (uint8_t *)DmpHdr_ + FirstPageOffset;
       MetadataSize = DmpHdr_->u3.RdmpHeader.Hdr.MetadataSize;
       Bitmap = DmpHdr_->u3.RdmpHeader.Bitmap.data();
       break;
@@ -601,7 +2172,6 @@ private:
 
     case DumpType_t::CompleteMemoryDump: {
       FirstPageOffset = DmpHdr_->u3.FullRdmpHeader.Hdr.FirstPageOffset;
-      Page = (uint8_t *)DmpHdr_ + FirstPageOffset;
       MetadataSize = DmpHdr_->u3.FullRdmpHeader.Hdr.MetadataSize;
       Bitmap = DmpHdr_->u3.FullRdmpHeader.Bitmap.data();
       TotalNumberOfPages = DmpHdr_->u3.FullRdmpHeader.TotalNumberOfPages;
@@ -613,15 +2183,11 @@ private:
     }
     }
 
-    if (!FirstPageOffset || !Page || !MetadataSize || !Bitmap) {
+    if (!FirstPageOffset || !MetadataSize || !Bitmap) {
       return false;
     }
 
-    auto IsPageInBounds = [&](const uint8_t *Ptr) {
-      return FileMap_.InBounds(Ptr, Page::Size);
-    };
-
-    if (!IsPageInBounds(Page)) {
+    if (!InFile(FirstPageOffset, Page::Size)) {
       return false;
     }
 
@@ -635,41 +2201,182 @@ private:
       return false;
     }
 
-    for (uint64_t Offset = 0; Offset < MetadataSize;
-         Offset += sizeof(PfnRange)) {
+    //
+    // The metadata is an array of ranges whose pages are stored one after the
+    // other from `FirstPageOffset`. The file offset of a range is the sum of
+    // the sizes of the ranges before it, so the ranges are split in chunks that
+    // can be handled by several threads once we know where each chunk starts.
+    //
 
-      if (Type == DumpType_t::CompleteMemoryDump) {
-        // `CompleteMemoryDump` type seems to be bound by the
-        // `TotalNumberOfPages` field, *not* by `MetadataSize`.
-        if (CurrentPageCount == TotalNumberOfPages) {
-          break;
+    const PfnRange *Entries = (PfnRange *)Bitmap;
+    const uint64_t NumberOfEntries = MetadataSize / sizeof(PfnRange);
+    const uint32_t NumberOfThreads =
+        ResolveNumberOfThreads(Options_.NumberOfThreads);
+    const uint64_t EntriesPerChunk = std::max(
+        uint64_t(4'096), NumberOfEntries / (uint64_t(NumberOfThreads) * 4) + 1);
+    const uint64_t NumberOfChunks =
+        (NumberOfEntries + EntriesPerChunk - 1) / EntriesPerChunk;
+
+    struct Chunk_t {
+      uint64_t FirstEntry = 0;
+      uint64_t NumberOfEntries = 0;
+      uint64_t NumberOfPages = 0;
+      uint64_t PagesBefore = 0;
+      bool Clean = false;
+      std::vector<PhysmemRun_t> Runs;
+    };
+
+    std::vector<Chunk_t> Chunks(NumberOfChunks);
+
+    //
+    // First, count the pages of every chunk. A chunk is clean if its entries
+    // are in bounds, if it doesn't have a null Pfn and if its page count didn't
+    // overflow; only those can be skipped over without looking at every entry.
+    //
+
+    ParallelFor(NumberOfThreads, NumberOfChunks, [&](const uint64_t ChunkIdx) {
+      Chunk_t &Chunk = Chunks[ChunkIdx];
+      Chunk.FirstEntry = ChunkIdx * EntriesPerChunk;
+      Chunk.NumberOfEntries =
+          std::min(EntriesPerChunk, NumberOfEntries - Chunk.FirstEntry);
+
+      const PfnRange *First = Entries + Chunk.FirstEntry;
+      if (!InBounds(First, Chunk.NumberOfEntries * sizeof(PfnRange))) {
+        return;
+      }
+
+      for (uint64_t EntryIdx = 0; EntryIdx < Chunk.NumberOfEntries;
+           EntryIdx++) {
+        const PfnRange &Entry = First[EntryIdx];
+        const uint64_t NumberOfPages =
+            Chunk.NumberOfPages + Entry.NumberOfPages;
+        if (!Entry.PageFileNumber || NumberOfPages < Chunk.NumberOfPages) {
+          return;
+        }
+
+        Chunk.NumberOfPages = NumberOfPages;
+      }
+
+      Chunk.Clean = true;
+    });
+
+    //
+    // Then, find where the ranges stop as well as the number of pages before
+    // every chunk. This is the only part that needs to look at the chunks in
+    // order; the ones that aren't clean or that might reach
+    // `TotalNumberOfPages` are walked entry by entry.
+    //
+
+    uint64_t NumberOfEntriesUsed = 0;
+    bool Stop = false;
+    for (auto &Chunk : Chunks) {
+      Chunk.PagesBefore = CurrentPageCount;
+      const uint64_t PageCountAfter = CurrentPageCount + Chunk.NumberOfPages;
+      const bool BelowTotal = Type != DumpType_t::CompleteMemoryDump ||
+                              (PageCountAfter >= CurrentPageCount &&
+                               PageCountAfter < TotalNumberOfPages);
+
+      if (Chunk.Clean && BelowTotal) {
+        CurrentPageCount = PageCountAfter;
+        NumberOfEntriesUsed += Chunk.NumberOfEntries;
+        continue;
+      }
+
+      for (uint64_t EntryIdx = 0; EntryIdx < Chunk.NumberOfEntries;
+           EntryIdx++) {
+
+        if (Type == DumpType_t::CompleteMemoryDump) {
+          // `CompleteMemoryDump` type seems to be bound by the
+          // `TotalNumberOfPages` field, *not* by `MetadataSize`.
+          if (CurrentPageCount == TotalNumberOfPages) {
+            Stop = true;
+            break;
+          }
+
+          if (CurrentPageCount > TotalNumberOfPages) {
+            return false;
+          }
         }
 
-        if (CurrentPageCount > TotalNumberOfPages) {
+        const PfnRange &Entry = Entries[Chunk.FirstEntry + EntryIdx];
+        if (!InBounds(&Entry, sizeof(Entry))) {
           return false;
         }
+
+        CurrentPageCount += Entry.NumberOfPages;
+
+        const uint64_t Pfn = Entry.PageFileNumber;
+        if (!Pfn) {
+          Stop = true;
+          break;
+        }
+
+        NumberOfEntriesUsed++;
       }
 
-      const PfnRange &Entry = (PfnRange &)Bitmap[Offset];
-      if (!FileMap_.InBounds(&Entry, sizeof(Entry))) {
-        return false;
+      if (Stop) {
+        break;
       }
+    }
 
-      CurrentPageCount += Entry.NumberOfPages;
+    //
+    // Now every chunk knows where its pages start, so we can build the runs.
+    //
 
-      const uint64_t Pfn = Entry.PageFileNumber;
-      if (!Pfn) {
-        break;
+    const uint64_t MaxNumberOfPages = SIZE_MAX / Page::Size;
+    std::atomic<bool> Failed = false;
+    ParallelFor(NumberOfThreads, NumberOfChunks, [&](const uint64_t ChunkIdx) {
+      Chunk_t &Chunk = Chunks[ChunkIdx];
+      if (Chunk.FirstEntry >= NumberOfEntriesUsed) {
+        return;
       }
 
-      for (uint64_t PageIdx = 0; PageIdx < Entry.NumberOfPages; PageIdx++) {
-        if (!IsPageInBounds(Page)) {
-          return false;
+      if (Chunk.PagesBefore > MaxNumberOfPages) {
+        Failed = true;
+        return;
+      }
+
+      uint64_t RangeOffset =
+          FirstPageOffset + (Chunk.PagesBefore * Page::Size);
+      const uint64_t LastEntry = std::min(
+          NumberOfEntriesUsed, Chunk.FirstEntry + Chunk.NumberOfEntries);
+
+      for (uint64_t EntryIdx = Chunk.FirstEntry; EntryIdx < LastEntry;
+           EntryIdx++) {
+        const PfnRange &Entry = Entries[EntryIdx];
+        if (!Entry.NumberOfPages) {
+          continue;
+        }
+
+        //
+        // Make sure every page of the range is in bounds; this is the case if
+        // the last one is.
+        //
+
+        if (Entry.NumberOfPages > MaxNumberOfPages) {
+          Failed = true;
+          return;
+        }
+
+        const uint64_t RangeSize = Entry.NumberOfPages * Page::Size;
+        if (!InFile(RangeOffset, RangeSize)) {
+          Failed = true;
+          return;
         }
 
-        const uint64_t Pa = (Pfn * Page::Size) + (PageIdx * Page::Size);
-        Physmem_.try_emplace(Pa, Page);
-        Page += Page::Size;
+        Chunk.Runs.push_back(PhysmemRun_t{Entry.PageFileNumber,
+                                          Entry.NumberOfPages, RangeOffset});
+        RangeOffset += RangeSize;
+      }
+    });
+
+    if (Failed) {
+      return false;
+    }
+
+    for (const auto &Chunk : Chunks) {
+      for (const auto &Run : Chunk.Runs) {
+        Physmem_.AddRun(Run.Pfn, Run.PageCount, Run.FileOffset);
       }
     }
 
@@ -683,17 +2390,23 @@ private:
   bool ParseDmpHeader() {
 
     //
-    // The base of the view points on the HEADER64.
+    // The base of the view points on the HEADER64; when the file isn't mapped,
+    // the beginning of the file is copied first.
     //
 
-    DmpHdr_ = (HEADER64 *)FileMap_.ViewBase();
+    if (!File_->ViewBase() && !ReadMetadata()) {
+      return false;
+    }
+
+    DmpHdr_ = (HEADER64 *)Physmem_.ViewBase();
 
     //
     // Now let's make sure the structures look right.
     //
 
     if (!DmpHdr_->LooksGood()) {
-      printf("The header looks wrong.\n");
+      Diagnostics::Report(Severity_t::Error, DiagnosticCode_t::InvalidHeader,
+                          "The header looks wrong.");
       return false;
     }
 
@@ -704,7 +2417,223 @@ private:
   // Map a view of the file in memory.
   //
 
-  bool MapFile() { return FileMap_.MapFile(PathFile_.string().c_str()); }
+  bool MapFile() {
+    Compressed_ = IsCompressedSource();
+    if (Source_ == Source_t::Backend) {
+      File_ = std::move(SourceFile_);
+      if (!File_) {
+        return false;
+      }
+    } else if (Compressed_) {
+      std::unique_ptr<FileBackend_t> Buffer;
+      if (Source_ == Source_t::Buffer) {
+        Buffer = std::make_unique<BufferFile_t>(Buffer_, BufferSize_);
+      }
+
+      File_ = std::make_unique<CompressedFile_t>(Options_.BlockCacheSize,
+                                                 std::move(Buffer));
+    } else if (Source_ == Source_t::Buffer) {
+      File_ = std::make_unique<BufferFile_t>(Buffer_, BufferSize_);
+    } else if (Options_.FileBackend == FileBackendType_t::Pread) {
+      File_ = std::make_unique<PreadFile_t>(Options_.BlockSize,
+                                            Options_.BlockCacheSize);
+    } else {
+      MapOptions_t MapOptions;
+      MapOptions.Populate = Options_.Populate;
+      MapOptions.Lock = Options_.LockView;
+      MapOptions.HugePages = Options_.HugePages;
+      File_ = std::make_unique<FileMap_t>(MapOptions);
+    }
+
+    Metadata_.clear();
+    MapReport_ = {};
+    bool Success = true;
+    if (Source_ == Source_t::Descriptor) {
+      Success = File_->OpenDescriptor(Descriptor_);
+    } else if (Source_ != Source_t::Backend) {
+      Success = File_->Open(PathFile_.string().c_str());
+    }
+
+    if (!Compressed_ &&
+        (Source_ == Source_t::Path || Source_ == Source_t::Descriptor) &&
+        Options_.FileBackend == FileBackendType_t::Map) {
+      MapReport_ = static_cast<const FileMap_t &>(*File_).Report();
+    }
+
+    if (!Success) {
+      return false;
+    }
+
+    //
+    // A hint that couldn't be applied only means the file is read less
+    // efficiently, which is why it isn't a failure.
+    //
+
+    if (Options_.AccessHint != AccessHint_t::Normal) {
+      File_->Advise(Options_.AccessHint, 0, 0);
+    }
+
+    SetPhysmemView();
+    return true;
+  }
+
+  //
+  // Is the dump a compressed dump? This only looks at its signature.
+  //
+
+  bool IsCompressedSource() const {
+    switch (Source_) {
+    case Source_t::Path: {
+      return CompressedFile_t::IsCompressedFile(PathFile_.string().c_str());
+    }
+
+    case Source_t::Descriptor: {
+      PreadFile_t File(Page::Size, 0);
+      return File.OpenDescriptor(Descriptor_) &&
+             CompressedFile_t::IsCompressedFile(File);
+    }
+
+    case Source_t::Buffer: {
+      return CompressedFile_t::IsCompressedFile(
+          BufferFile_t(Buffer_, BufferSize_));
+    }
+
+    case Source_t::Backend: {
+      return false;
+    }
+    }
+
+    return false;
+  }
+
+  //
+  // Apply a hint to the whole dump file around a scan, unless it has been
+  // asked not to.
+  //
+
+  void AdviseScan(const AccessHint_t Hint) const {
+    if (Options_.AdviseScans && File_) {
+      File_->Advise(Hint, 0, 0);
+    }
+  }
+
+  //
+  // Merge the ranges of the dump file that are next to each other, or that
+  // overlap, so that each system call covers as much of the file as possible.
+  // The ranges need to be sorted by offset for them to be merged.
+  //
+
+  static std::vector<FileRange_t>
+  MergeFileRanges(const std::vector<FileRange_t> &FileRanges) {
+    std::vector<FileRange_t> Merged;
+    for (const auto &Range : FileRanges) {
+      if (!Merged.empty()) {
+        FileRange_t &Last = Merged.back();
+        if (Range.Offset >= Last.Offset &&
+            Range.Offset <= (Last.Offset + Last.Size)) {
+          const uint64_t End =
+              std::max(Last.Offset + Last.Size, Range.Offset + Range.Size);
+          Last.Size = End - Last.Offset;
+          continue;
+        }
+      }
+
+      Merged.push_back(Range);
+    }
+
+    return Merged;
+  }
+
+  //
+  // Get the merged ranges of the dump file backing a set of physical pages;
+  // the pages that aren't in the dump are skipped.
+  //
+
+  std::vector<FileRange_t>
+  PagesFileRanges(const std::vector<uint64_t> &PhysicalAddresses) const {
+    std::vector<FileRange_t> FileRanges;
+    for (const uint64_t PhysicalAddress : PhysicalAddresses) {
+      const auto &FileOffset =
+          Physmem_.PageOffset(PhysicalAddress / Page::Size);
+      if (FileOffset) {
+        FileRanges.push_back(FileRange_t{*FileOffset, Page::Size});
+      }
+    }
+
+    std::sort(FileRanges.begin(), FileRanges.end(),
+              [](const FileRange_t &A, const FileRange_t &B) {
+                return A.Offset < B.Offset;
+              });
+
+    return MergeFileRanges(FileRanges);
+  }
+
+  //
+  // Copy the beginning of a file that isn't mapped, up to its first page: it
+  // holds the headers as well as the metadata describing where the pages are.
+  // Like the view of a mapped file, the copy is zero-padded past its end.
+  //
+
+  bool ReadMetadata() {
+    HEADER64 Header = {};
+    File_->Read(0, &Header, sizeof(Header));
+
+    const uint64_t MetadataSize =
+        std::min(GetMetadataSize(Header), File_->Size());
+    Metadata_.assign(size_t(Page::Align(MetadataSize) + Page::Size), 0);
+    if (File_->Read(0, Metadata_.data(), MetadataSize) != MetadataSize) {
+      Diagnostics::Report(Severity_t::Error, DiagnosticCode_t::ReadFailed,
+                          "Could not read the headers of the dump.");
+      return false;
+    }
+
+    SetPhysmemView();
+    return true;
+  }
+
+  //
+  // Point the index of the physical memory to the view of the dump file.
+  //
+
+  void SetPhysmemView() const {
+    if (File_->ViewBase()) {
+      Physmem_.SetView(File_->ViewBase(),
+                       Page::Align(File_->Size()) + Page::Size);
+      return;
+    }
+
+    Physmem_.SetView(Metadata_.data(), Metadata_.size(), File_.get());
+  }
+
+  //
+  // Is a range of the view of the dump in bounds?
+  //
+
+  bool InBounds(const void *Ptr, const uint64_t Size) const {
+    const uint8_t *ViewBase = Physmem_.ViewBase();
+    const uint8_t *ViewEnd = ViewBase + Physmem_.ViewSize();
+    const uint8_t *PtrEnd = (uint8_t *)Ptr + Size;
+    return PtrEnd > Ptr && ViewEnd > ViewBase && Ptr >= ViewBase &&
+           PtrEnd < ViewEnd;
+  }
+
+  //
+  // Is a range of the dump file in bounds? Like for the view, the file is
+  // considered to extend to the end of its last page, plus a page.
+  //
+
+  bool InFile(const uint64_t Offset, const uint64_t Size) const {
+    const uint64_t End = Offset + Size;
+    return End > Offset && End < (Page::Align(File_->Size()) + Page::Size);
+  }
+
+  //
+  // Get the offset in the file of a pointer inside the view.
+  //
+
+  uint64_t FileOffset(const void *Ptr) const {
+    return uint64_t((uint8_t *)Ptr - Physmem_.ViewBase());
+  }
 };
 
 struct Version_t {
@@ -0,0 +1,142 @@
+// Axel '0vercl0k' Souchet - October 17 2026
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+namespace kdmpparser {
+
+//
+// Thread-safe cache that evicts the least recently used entry once it is full.
+// The entries are spread over shards, each with its own lock and its own
+// share of the capacity, so that threads looking up different keys rarely
+// contend on the same lock. Values are copied in and out of the cache, so
+// big values should be held through a `std::shared_ptr`: an entry that is
+// evicted stays alive as long as somebody holds it.
+//
+
+template <typename Value_t> class LruCache_t {
+  static constexpr uint64_t NumberOfShards = 16;
+
+  using List_t = std::list<std::pair<uint64_t, Value_t>>;
+
+  struct Shard_t {
+    std::mutex Lock;
+
+    //
+    // The entries, most recently used first.
+    //
+
+    List_t Entries;
+    std::unordered_map<uint64_t, typename List_t::iterator> Index;
+  };
+
+  std::unique_ptr<std::array<Shard_t, NumberOfShards>> Shards_;
+  uint64_t EntriesPerShard_ = 0;
+
+  //
+  // Mix the key so that consecutive keys land in different shards.
+  //
+
+  Shard_t &Shard(const uint64_t Key) const {
+    const uint64_t Hash = Key * 0x9e37'79b9'7f4a'7c15ULL;
+    return (*Shards_)[Hash >> 60];
+  }
+
+public:
+  //
+  // Set the maximum number of entries; this drops every entry, and a capacity
+  // of 0 disables the cache.
+  //
+
+  void SetCapacity(const uint64_t Capacity) {
+    Shards_.reset();
+    EntriesPerShard_ = 0;
+    if (Capacity == 0) {
+      return;
+    }
+
+    EntriesPerShard_ = (Capacity + NumberOfShards - 1) / NumberOfShards;
+    Shards_ = std::make_unique<std::array<Shard_t, NumberOfShards>>();
+  }
+
+  //
+  // Get the maximum number of entries.
+  //
+
+  uint64_t Capacity() const { return EntriesPerShard_ * NumberOfShards; }
+
+  bool Enabled() const { return Shards_ != nullptr; }
+
+  //
+  // Look up a value, and mark it as the most recently used of its shard.
+  //
+
+  std::optional<Value_t> Lookup(const uint64_t Key) const {
+    if (!Enabled()) {
+      return {};
+    }
+
+    Shard_t &Shard = this->Shard(Key);
+    std::lock_guard<std::mutex> Lock(Shard.Lock);
+    const auto &It = Shard.Index.find(Key);
+    if (It == Shard.Index.end()) {
+      return {};
+    }
+
+    Shard.Entries.splice(Shard.Entries.begin(), Shard.Entries, It->second);
+    return It->second->second;
+  }
+
+  //
+  // Insert a value, or replace the one that is there already; the least
+  // recently used entry of the shard is evicted if it is full.
+  //
+
+  void Insert(const uint64_t Key, const Value_t &Value) {
+    if (!Enabled()) {
+      return;
+    }
+
+    Shard_t &Shard = this->Shard(Key);
+    std::lock_guard<std::mutex> Lock(Shard.Lock);
+    const auto &It = Shard.Index.find(Key);
+    if (It != Shard.Index.end()) {
+      It->second->second = Value;
+      Shard.Entries.splice(Shard.Entries.begin(), Shard.Entries, It->second);
+      return;
+    }
+
+    if (Shard.Entries.size() == EntriesPerShard_) {
+      Shard.Index.erase(Shard.Entries.back().first);
+      Shard.Entries.pop_back();
+    }
+
+    Shard.Entries.emplace_front(Key, Value);
+    Shard.Index.emplace(Key, Shard.Entries.begin());
+  }
+
+  //
+  // Drop every entry.
+  //
+
+  void Clear() {
+    if (!Enabled()) {
+      return;
+    }
+
+    for (auto &Shard : *Shards_) {
+      std::lock_guard<std::mutex> Lock(Shard.Lock);
+      Shard.Index.clear();
+      Shard.Entries.clear();
+    }
+  }
+};
+
+} // namespace kdmpparser
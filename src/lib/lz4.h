@@ -0,0 +1,253 @@
+// Axel '0vercl0k' Souchet - October 17 2026
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+namespace kdmpparser {
+namespace Lz4 {
+
+//
+// Compression and decompression of LZ4 blocks (the raw block format, without
+// the frame around it): a sequence is a token with the lengths of its
+// literals and of its match, the literals, and the offset of the match.
+//
+
+constexpr size_t MinMatch = 4;
+
+//
+// The last 5 bytes of a block are always literals, and the last match starts
+// at least 12 bytes before the end of the block.
+//
+
+constexpr size_t LastLiterals = 5;
+constexpr size_t MatchFindLimit = 12;
+constexpr size_t MaxOffset = 0xffff;
+
+//
+// Get the maximum size of a block compressing `Size` bytes.
+//
+
+constexpr size_t CompressBound(const size_t Size) {
+  return Size + (Size / 255) + 16;
+}
+
+namespace Details {
+
+inline uint32_t Read32(const uint8_t *Ptr) {
+  uint32_t Value;
+  memcpy(&Value, Ptr, sizeof(Value));
+  return Value;
+}
+
+//
+// Write a length that doesn't fit in the 4 bits of the token.
+//
+
+inline uint8_t *WriteLength(uint8_t *Out, size_t Length) {
+  for (; Length >= 0xff; Length -= 0xff) {
+    *Out++ = 0xff;
+  }
+
+  *Out++ = uint8_t(Length);
+  return Out;
+}
+
+//
+// Read a length that doesn't fit in the 4 bits of the token; false if the
+// block ends before it does.
+//
+
+inline bool ReadLength(const uint8_t *&In, const uint8_t *End,
+                       size_t &Length) {
+  uint8_t Byte = 0;
+  do {
+    if (In == End) {
+      return false;
+    }
+
+    Byte = *In++;
+    Length += Byte;
+  } while (Byte == 0xff);
+
+  return true;
+}
+
+} // namespace Details
+
+//
+// Compress `Size` bytes into a block. Matches are found with a hash table of
+// the last position of every 4-byte sequence, and positions that don't match
+// are skipped faster and faster. Returns the size of the block, or 0 if it
+// doesn't fit in `Capacity` bytes.
+//
+
+inline size_t Compress(const uint8_t *In, const size_t Size, uint8_t *Out,
+                       const size_t Capacity) {
+  constexpr uint32_t HashLog = 14;
+  auto Table = std::make_unique<std::array<uint32_t, 1 << HashLog>>();
+  Table->fill(0);
+
+  const auto &Hash = [](const uint32_t Sequence) {
+    return (Sequence * 2654435761U) >> (32 - HashLog);
+  };
+
+  uint8_t *Op = Out;
+  uint8_t *OutEnd = Out + Capacity;
+  const auto &Emit = [&](const size_t Anchor, const size_t LiteralLength,
+                         const size_t Offset, const size_t MatchLength) {
+    const size_t Needed = 1 + (LiteralLength / 0xff) + 1 + LiteralLength + 2 +
+                          (MatchLength / 0xff) + 1;
+    if (size_t(OutEnd - Op) < Needed) {
+      return false;
+    }
+
+    uint8_t *Token = Op++;
+    *Token = uint8_t(std::min(LiteralLength, size_t(15)) << 4);
+    if (LiteralLength >= 15) {
+      Op = Details::WriteLength(Op, LiteralLength - 15);
+    }
+
+    memcpy(Op, In + Anchor, LiteralLength);
+    Op += LiteralLength;
+    if (MatchLength == 0) {
+      return true;
+    }
+
+    *Op++ = uint8_t(Offset);
+    *Op++ = uint8_t(Offset >> 8);
+    const size_t Length = MatchLength - MinMatch;
+    *Token |= uint8_t(std::min(Length, size_t(15)));
+    if (Length >= 15) {
+      Op = Details::WriteLength(Op, Length - 15);
+    }
+
+    return true;
+  };
+
+  size_t Anchor = 0;
+  size_t Position = 0;
+  size_t Misses = 0;
+  while ((Position + MatchFindLimit) <= Size) {
+    const uint32_t Sequence = Details::Read32(In + Position);
+    uint32_t &Entry = (*Table)[Hash(Sequence)];
+    const size_t Candidate = Entry;
+    Entry = uint32_t(Position);
+
+    if (Candidate >= Position || (Position - Candidate) > MaxOffset ||
+        Details::Read32(In + Candidate) != Sequence) {
+      Position += 1 + (Misses++ >> 6);
+      continue;
+    }
+
+    const size_t MatchEnd = Size - LastLiterals;
+    size_t MatchLength = MinMatch;
+    while ((Position + MatchLength) < MatchEnd &&
+           In[Candidate + MatchLength] == In[Position + MatchLength]) {
+      MatchLength++;
+    }
+
+    if (!Emit(Anchor, Position - Anchor, Position - Candidate, MatchLength)) {
+      return 0;
+    }
+
+    Position += MatchLength;
+    Anchor = Position;
+    Misses = 0;
+  }
+
+  if (!Emit(Anchor, Size - Anchor, 0, 0)) {
+    return 0;
+  }
+
+  return size_t(Op - Out);
+}
+
+//
+// Decompress a block into `Size` bytes; the block is untrusted, so every
+// length and offset is checked. Returns the number of bytes written to `Out`,
+// or 0 if the block is malformed or doesn't fit.
+//
+
+inline size_t Decompress(const uint8_t *In, const size_t InSize, uint8_t *Out,
+                         const size_t Size) {
+  const uint8_t *Ip = In;
+  const uint8_t *InEnd = In + InSize;
+  size_t Written = 0;
+  while (Ip < InEnd) {
+    const uint8_t Token = *Ip++;
+    size_t LiteralLength = Token >> 4;
+    if (LiteralLength == 15 &&
+        !Details::ReadLength(Ip, InEnd, LiteralLength)) {
+      return 0;
+    }
+
+    if (LiteralLength > size_t(InEnd - Ip) ||
+        LiteralLength > (Size - Written)) {
+      return 0;
+    }
+
+    //
+    // `Out` can be null when there is nothing to write to it.
+    //
+
+    if (LiteralLength != 0) {
+      memcpy(Out + Written, Ip, LiteralLength);
+    }
+
+    Ip += LiteralLength;
+    Written += LiteralLength;
+
+    //
+    // The last sequence only has literals.
+    //
+
+    if (Ip == InEnd) {
+      break;
+    }
+
+    if ((InEnd - Ip) < 2) {
+      return 0;
+    }
+
+    const size_t Offset = size_t(Ip[0]) | (size_t(Ip[1]) << 8);
+    Ip += 2;
+    if (Offset == 0 || Offset > Written) {
+      return 0;
+    }
+
+    size_t MatchLength = Token & 0xf;
+    if (MatchLength == 15 && !Details::ReadLength(Ip, InEnd, MatchLength)) {
+      return 0;
+    }
+
+    MatchLength += MinMatch;
+    if (MatchLength > (Size - Written)) {
+      return 0;
+    }
+
+    //
+    // The match can overlap the bytes it produces, in which case it repeats
+    // them.
+    //
+
+    uint8_t *Match = Out + Written - Offset;
+    if (Offset >= MatchLength) {
+      memcpy(Out + Written, Match, MatchLength);
+    } else {
+      for (size_t Idx = 0; Idx < MatchLength; Idx++) {
+        Out[Written + Idx] = Match[Idx];
+      }
+    }
+
+    Written += MatchLength;
+  }
+
+  return Written;
+}
+
+} // namespace Lz4
+} // namespace kdmpparser
@@ -0,0 +1,103 @@
+// Axel '0vercl0k' Souchet - October 17 2026
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace kdmpparser {
+
+//
+// Get the number of threads to use; 0 means one per hardware thread.
+//
+
+inline uint32_t ResolveNumberOfThreads(const uint32_t NumberOfThreads) {
+  if (NumberOfThreads) {
+    return NumberOfThreads;
+  }
+
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+//
+// Invoke `Function` for every work item in [0, NumberOfItems[. The items are
+// handed out one by one to `NumberOfThreads` threads, the calling thread being
+// one of them; the function returns once every item has been processed.
+//
+
+template <typename Function_t>
+void ParallelFor(const uint32_t NumberOfThreads, const uint64_t NumberOfItems,
+                 const Function_t &Function) {
+  const uint64_t MaxNumberOfThreads =
+      std::min(uint64_t(ResolveNumberOfThreads(NumberOfThreads)),
+               NumberOfItems);
+
+  if (MaxNumberOfThreads <= 1) {
+    for (uint64_t ItemIdx = 0; ItemIdx < NumberOfItems; ItemIdx++) {
+      Function(ItemIdx);
+    }
+
+    return;
+  }
+
+  std::atomic<uint64_t> NextItemIdx = 0;
+  const auto &Worker = [&]() {
+    for (uint64_t ItemIdx = NextItemIdx++; ItemIdx < NumberOfItems;
+         ItemIdx = NextItemIdx++) {
+      Function(ItemIdx);
+    }
+  };
+
+  std::vector<std::thread> Threads;
+  for (uint64_t ThreadIdx = 1; ThreadIdx < MaxNumberOfThreads; ThreadIdx++) {
+    Threads.emplace_back(Worker);
+  }
+
+  Worker();
+  for (auto &Thread : Threads) {
+    Thread.join();
+  }
+}
+
+//
+// Sort [First, Last[ with `NumberOfThreads` threads: chunks are sorted
+// concurrently, then merged pairwise until a single one is left.
+//
+
+template <typename Iterator_t, typename Compare_t>
+void ParallelSort(const uint32_t NumberOfThreads, const Iterator_t First,
+                  const Iterator_t Last, const Compare_t &Compare) {
+  const uint64_t MinChunkSize = 0x1'0000;
+  const uint64_t Size = uint64_t(Last - First);
+  const uint64_t NumberOfChunks =
+      std::min(uint64_t(ResolveNumberOfThreads(NumberOfThreads)),
+               std::max(uint64_t(1), Size / MinChunkSize));
+
+  if (NumberOfChunks <= 1) {
+    std::sort(First, Last, Compare);
+    return;
+  }
+
+  const auto &Bound = [&](const uint64_t ChunkIdx) {
+    return First + ((Size * std::min(ChunkIdx, NumberOfChunks)) /
+                    NumberOfChunks);
+  };
+
+  ParallelFor(NumberOfThreads, NumberOfChunks, [&](const uint64_t ChunkIdx) {
+    std::sort(Bound(ChunkIdx), Bound(ChunkIdx + 1), Compare);
+  });
+
+  for (uint64_t Width = 1; Width < NumberOfChunks; Width *= 2) {
+    const uint64_t NumberOfMerges =
+        (NumberOfChunks + (2 * Width) - 1) / (2 * Width);
+    ParallelFor(NumberOfThreads, NumberOfMerges, [&](const uint64_t MergeIdx) {
+      const uint64_t ChunkIdx = MergeIdx * 2 * Width;
+      std::inplace_merge(Bound(ChunkIdx), Bound(ChunkIdx + Width),
+                         Bound(ChunkIdx + (2 * Width)), Compare);
+    });
+  }
+}
+
+} // namespace kdmpparser
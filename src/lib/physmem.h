@@ -0,0 +1,1259 @@
+// Axel '0vercl0k' Souchet - October 17 2026
+#pragma once
+
+#include "filemap.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#if defined(ARCH_X64) || defined(ARCH_X86)
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace kdmpparser {
+
+//
+// A run of physical pages that are contiguous both in physical memory and in
+// the dump file.
+//
+
+struct PhysmemRun_t {
+
+  //
+  // Page frame number of the first page of the run.
+  //
+
+  uint64_t Pfn;
+
+  //
+  // Number of pages in the run.
+  //
+
+  uint64_t PageCount;
+
+  //
+  // Offset of the first page of the run in the dump file.
+  //
+
+  uint64_t FileOffset;
+};
+
+//
+// Range of physical memory that is contiguous both in physical memory and in
+// the dump file; `Data` points straight into the view of the file, or is
+// nullptr if the file isn't mapped (see `FileBackend_t`).
+//
+
+struct PhysmemSpan_t {
+
+  //
+  // Physical address of the first byte of the span.
+  //
+
+  uint64_t PhysicalAddress;
+
+  //
+  // Content of the span.
+  //
+
+  const uint8_t *Data;
+
+  //
+  // Size of the span in bytes.
+  //
+
+  uint64_t Size;
+};
+
+//
+// Invoked by reads for every range of physical memory that isn't in the dump.
+// It can fill the `Size` bytes at `Out` and return true to carry on with the
+// read, or return false to stop the read at `PhysicalAddress`.
+//
+
+using MissingPageCallback_t = std::function<bool(
+    const uint64_t PhysicalAddress, uint8_t *Out, const uint64_t Size)>;
+
+//
+// Missing page callback that fills the missing ranges with zeros.
+//
+
+inline bool ZeroMissingPages(const uint64_t, uint8_t *Out,
+                             const uint64_t Size) {
+  memset(Out, 0, size_t(Size));
+  return true;
+}
+
+//
+// Read-only view over an array that is owned by someone else; the arrays of
+// the index either live in vectors or in a mapped index file.
+//
+
+template <typename Type_t> class ArrayView_t {
+  const Type_t *Data_ = nullptr;
+  size_t Size_ = 0;
+
+public:
+  ArrayView_t() = default;
+  ArrayView_t(const Type_t *Data, const size_t Size)
+      : Data_(Data), Size_(Size) {}
+  ArrayView_t(const std::vector<Type_t> &Vector)
+      : Data_(Vector.data()), Size_(Vector.size()) {}
+
+  const Type_t *data() const { return Data_; }
+  size_t size() const { return Size_; }
+  bool empty() const { return Size_ == 0; }
+  const Type_t *begin() const { return Data_; }
+  const Type_t *end() const { return Data_ + Size_; }
+  const Type_t *cbegin() const { return begin(); }
+  const Type_t *cend() const { return end(); }
+  const Type_t &operator[](const size_t Idx) const { return Data_[Idx]; }
+};
+
+//
+// Rank directory over the bitmap of BMP dumps. In those dumps, the pages are
+// stored in the file in increasing Pfn order, so the position of a page is the
+// number of bits set before its Pfn in the bitmap. The directory stores the
+// number of bits set before every superblock of 64k bits, and before every
+// 64-bit word relative to its superblock; that is about a quarter of a bit per
+// page and finding a page takes a single popcount.
+//
+
+class BitmapIndex_t {
+
+  //
+  // Number of 64-bit words in a superblock. It is chosen so that the rank of
+  // a word relative to its superblock fits in 16 bits.
+  //
+
+  static constexpr uint64_t WordsPerSuperblock = 1024;
+
+  //
+  // The bitmap; it lives in the dump file.
+  //
+
+  const uint8_t *Bitmap_ = nullptr;
+
+  //
+  // Size of the bitmap in bytes.
+  //
+
+  uint64_t BitmapSize_ = 0;
+
+  //
+  // Number of bits set before every superblock.
+  //
+
+  std::vector<uint64_t> SuperblockRanks_;
+
+  //
+  // Number of bits set before every word, relative to its superblock.
+  //
+
+  std::vector<uint16_t> WordRanks_;
+
+  //
+  // Number of bits set in the whole bitmap.
+  //
+
+  uint64_t NumberOfBitsSet_ = 0;
+
+public:
+  //
+  // Build the rank directory for a bitmap. The superblocks are independent
+  // from each other, so they can be counted by several threads; a prefix sum
+  // of their counts gives their ranks.
+  //
+
+  void Build(const uint8_t *Bitmap, const uint64_t BitmapSize,
+             const uint32_t NumberOfThreads = 1) {
+    Bitmap_ = Bitmap;
+    BitmapSize_ = BitmapSize;
+    NumberOfBitsSet_ = 0;
+
+    const uint64_t NumberOfWords = this->NumberOfWords();
+    const uint64_t NumberOfSuperblocks =
+        (NumberOfWords + WordsPerSuperblock - 1) / WordsPerSuperblock;
+    SuperblockRanks_.assign(NumberOfSuperblocks, 0);
+    WordRanks_.assign(NumberOfWords, 0);
+
+    ParallelFor(NumberOfThreads, NumberOfSuperblocks,
+                [&](const uint64_t SuperblockIdx) {
+                  const uint64_t FirstWordIdx =
+                      SuperblockIdx * WordsPerSuperblock;
+                  const uint64_t LastWordIdx = std::min(
+                      NumberOfWords, FirstWordIdx + WordsPerSuperblock);
+                  uint64_t Count = 0;
+                  for (uint64_t WordIdx = FirstWordIdx; WordIdx < LastWordIdx;
+                       WordIdx++) {
+                    WordRanks_[WordIdx] = uint16_t(Count);
+                    Count += PopCount(Word(WordIdx));
+                  }
+
+                  SuperblockRanks_[SuperblockIdx] = Count;
+                });
+
+    for (auto &SuperblockRank : SuperblockRanks_) {
+      const uint64_t Count = SuperblockRank;
+      SuperblockRank = NumberOfBitsSet_;
+      NumberOfBitsSet_ += Count;
+    }
+  }
+
+  //
+  // Get the number of bits set in the bitmap.
+  //
+
+  uint64_t NumberOfBitsSet() const { return NumberOfBitsSet_; }
+
+  //
+  // Get the number of bits in the bitmap.
+  //
+
+  uint64_t NumberOfBits() const { return BitmapSize_ * 8; }
+
+  //
+  // Get the number of bits set before a bit if it is set.
+  //
+
+  std::optional<uint64_t> Rank(const uint64_t BitIdx) const {
+    if (BitIdx >= NumberOfBits()) {
+      return {};
+    }
+
+    const uint64_t WordIdx = BitIdx / 64;
+    const uint64_t BitMask = 1ULL << (BitIdx % 64);
+    const uint64_t Bits = Word(WordIdx);
+    if (!(Bits & BitMask)) {
+      return {};
+    }
+
+    return SuperblockRanks_[WordIdx / WordsPerSuperblock] +
+           WordRanks_[WordIdx] + PopCount(Bits & (BitMask - 1));
+  }
+
+  //
+  // Read a 64-bit word of the bitmap; the last one might be partial.
+  //
+
+  uint64_t Word(const uint64_t WordIdx) const {
+    const uint64_t Offset = WordIdx * sizeof(uint64_t);
+    const uint64_t Size =
+        std::min(uint64_t(sizeof(uint64_t)), BitmapSize_ - Offset);
+    uint64_t Bits = 0;
+    memcpy(&Bits, Bitmap_ + Offset, size_t(Size));
+    return Bits;
+  }
+
+  //
+  // Find the first bit set at, or after, a bit. Returns `NumberOfBits()` if
+  // there is none.
+  //
+
+  uint64_t FindNextSet(const uint64_t BitIdx) const {
+    return FindNext(BitIdx, 0);
+  }
+
+  //
+  // Find the first bit clear at, or after, a bit. Returns `NumberOfBits()` if
+  // there is none.
+  //
+
+  uint64_t FindNextClear(const uint64_t BitIdx) const {
+    return FindNext(BitIdx, ~0ULL);
+  }
+
+  static uint64_t PopCount(const uint64_t Word) {
+    return std::bitset<64>(Word).count();
+  }
+
+  static uint64_t CountTrailingZeros(const uint64_t Word) {
+#if defined(_MSC_VER)
+    unsigned long Idx = 0;
+#if defined(ARCH_X86)
+    if (_BitScanForward(&Idx, uint32_t(Word))) {
+      return Idx;
+    }
+
+    _BitScanForward(&Idx, uint32_t(Word >> 32));
+    return Idx + 32;
+#else
+    _BitScanForward64(&Idx, Word);
+    return Idx;
+#endif
+#else
+    return __builtin_ctzll(Word);
+#endif
+  }
+
+  uint64_t NumberOfWords() const {
+    return (BitmapSize_ + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+  }
+
+private:
+  //
+  // Find the first bit at, or after, a bit that differs from the bits of
+  // `Skip`, which is either all zeros or all ones.
+  //
+
+  uint64_t FindNext(const uint64_t BitIdx, const uint64_t Skip) const {
+    const uint64_t NumberOfBits = this->NumberOfBits();
+    if (BitIdx >= NumberOfBits) {
+      return NumberOfBits;
+    }
+
+    //
+    // Ignore the bits below `BitIdx` in the first word, and then look for a
+    // word that has at least one interesting bit.
+    //
+
+    uint64_t WordIdx = BitIdx / 64;
+    uint64_t Bits = (Word(WordIdx) ^ Skip) & (~0ULL << (BitIdx % 64));
+    while (!Bits) {
+      WordIdx = SkipWords(WordIdx + 1, Skip);
+      if (WordIdx >= NumberOfWords()) {
+        return NumberOfBits;
+      }
+
+      Bits = Word(WordIdx) ^ Skip;
+    }
+
+    //
+    // The last word is padded with zeros, so when looking for a clear bit we
+    // might find one past the end of the bitmap.
+    //
+
+    return std::min(NumberOfBits, (WordIdx * 64) + CountTrailingZeros(Bits));
+  }
+
+  //
+  // Skip the full words that are equal to `Skip` starting from a word; returns
+  // the index of the first word that is not.
+  //
+
+  uint64_t SkipWords(uint64_t WordIdx, const uint64_t Skip) const {
+    const uint64_t NumberOfFullWords = BitmapSize_ / sizeof(uint64_t);
+
+#if defined(ARCH_X64) || defined(ARCH_X86)
+
+    //
+    // Compare 128 bits at a time with SSE2 which is available on every x86 /
+    // x64 processor we care about.
+    //
+
+    const __m128i Pattern = _mm_set1_epi8(char(Skip));
+    for (; (WordIdx + 2) <= NumberOfFullWords; WordIdx += 2) {
+      const __m128i Words =
+          _mm_loadu_si128((const __m128i *)(Bitmap_ + (WordIdx * 8)));
+      if (_mm_movemask_epi8(_mm_cmpeq_epi8(Words, Pattern)) != 0xffff) {
+        break;
+      }
+    }
+#endif
+
+    for (; WordIdx < NumberOfFullWords; WordIdx++) {
+      if (Word(WordIdx) != Skip) {
+        break;
+      }
+    }
+
+    return WordIdx;
+  }
+};
+
+//
+// Index of the physical memory available in the dump. Instead of keeping one
+// entry per page, it keeps a sorted array of runs and finds pages via binary
+// search; this means its footprint grows with the number of runs, not with the
+// number of pages. For BMP dumps, it uses a rank directory over the bitmap of
+// the dump instead (see `BitmapIndex_t`).
+//
+// It mimics the read-only interface of an associative container where the keys
+// are page-aligned physical addresses and the values are pointers to the page
+// content; the pointers are nullptr if the dump file isn't mapped.
+//
+
+class Physmem_t {
+
+  //
+  // Base and size of the view of the dump file. When the file isn't mapped,
+  // the view only holds the beginning of the file, up to the first page, and
+  // the pages are read from `Backend_`.
+  //
+
+  const uint8_t *ViewBase_ = nullptr;
+  uint64_t ViewSize_ = 0;
+  const FileBackend_t *Backend_ = nullptr;
+
+  //
+  // The runs sorted by Pfn; they don't overlap.
+  //
+
+  std::vector<PhysmemRun_t> Runs_;
+
+  //
+  // Runs stored outside of the index (in an index file for example); if set,
+  // they are used instead of `Runs_`.
+  //
+
+  ArrayView_t<PhysmemRun_t> ExternalRuns_;
+
+  //
+  // Indices of the runs sorted by file offset; it is empty if the runs are
+  // stored in the file in the same order as they are in memory.
+  //
+
+  std::vector<uint64_t> FileOrder_;
+
+  //
+  // The rank directory, if the physical memory is described by a bitmap.
+  //
+
+  std::optional<BitmapIndex_t> Bitmap_;
+
+  //
+  // File offset of the page that corresponds to the first bit set in the
+  // bitmap.
+  //
+
+  uint64_t BitmapFirstPage_ = 0;
+
+  //
+  // Total number of pages in the index.
+  //
+
+  uint64_t NumberOfPages_ = 0;
+
+public:
+  using key_type = uint64_t;
+  using mapped_type = const uint8_t *;
+  using value_type = std::pair<key_type, mapped_type>;
+  using size_type = size_t;
+
+  //
+  // Iterator that walks every page of the physical memory in increasing
+  // physical address order.
+  //
+
+  class const_iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Physmem_t::value_type;
+    using difference_type = ptrdiff_t;
+    using pointer = const value_type *;
+    using reference = const value_type &;
+
+  private:
+    const Physmem_t *Physmem_ = nullptr;
+    std::optional<PhysmemRun_t> Run_;
+    uint64_t PageIdx_ = 0;
+    value_type Current_ = {0, nullptr};
+
+    void Update() {
+      if (!Run_) {
+        return;
+      }
+
+      Current_.first = (Run_->Pfn + PageIdx_) * Page::Size;
+      Current_.second =
+          Physmem_->Data(Run_->FileOffset + (PageIdx_ * Page::Size));
+    }
+
+  public:
+    const_iterator() = default;
+    const_iterator(const Physmem_t *Physmem,
+                   const std::optional<PhysmemRun_t> &Run)
+        : Physmem_(Physmem), Run_(Run) {
+      Update();
+    }
+
+    reference operator*() const { return Current_; }
+    pointer operator->() const { return &Current_; }
+
+    const_iterator &operator++() {
+      PageIdx_++;
+      if (PageIdx_ == Run_->PageCount) {
+        Run_ = Physmem_->NextRun(Run_->Pfn + Run_->PageCount);
+        PageIdx_ = 0;
+      }
+
+      Update();
+      return *this;
+    }
+
+    const_iterator operator++(int) {
+      const_iterator Old = *this;
+      ++*this;
+      return Old;
+    }
+
+    bool operator==(const const_iterator &Other) const {
+      if (Physmem_ != Other.Physmem_ ||
+          Run_.has_value() != Other.Run_.has_value()) {
+        return false;
+      }
+
+      return !Run_ || Current_.first == Other.Current_.first;
+    }
+
+    bool operator!=(const const_iterator &Other) const {
+      return !(*this == Other);
+    }
+  };
+
+  using iterator = const_iterator;
+
+  //
+  // Iterator that walks the spans covering a range of physical memory, in
+  // increasing physical address order; the holes are skipped.
+  //
+
+  class span_iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = PhysmemSpan_t;
+    using difference_type = ptrdiff_t;
+    using pointer = const value_type *;
+    using reference = const value_type &;
+
+  private:
+    const Physmem_t *Physmem_ = nullptr;
+    uint64_t EndAddress_ = 0;
+    std::optional<PhysmemSpan_t> Current_;
+
+    //
+    // Clip a span so that it doesn't go past the end of the range.
+    //
+
+    void Clip(const std::optional<PhysmemSpan_t> &Span) {
+      Current_.reset();
+      if (!Span || Span->PhysicalAddress >= EndAddress_) {
+        return;
+      }
+
+      Current_ = Span;
+      Current_->Size =
+          std::min(Current_->Size, EndAddress_ - Current_->PhysicalAddress);
+    }
+
+  public:
+    span_iterator() = default;
+    explicit span_iterator(const Physmem_t *Physmem) : Physmem_(Physmem) {}
+    span_iterator(const Physmem_t *Physmem, const uint64_t PhysicalAddress,
+                  const uint64_t EndAddress)
+        : Physmem_(Physmem), EndAddress_(EndAddress) {
+      auto Span = Physmem_->SpanAt(PhysicalAddress);
+      if (!Span) {
+        Span = Physmem_->NextSpan(PhysicalAddress / Page::Size);
+      }
+
+      Clip(Span);
+    }
+
+    reference operator*() const { return *Current_; }
+    pointer operator->() const { return &*Current_; }
+
+    span_iterator &operator++() {
+      const uint64_t SpanEnd = Current_->PhysicalAddress + Current_->Size;
+      if (SpanEnd >= EndAddress_) {
+        Current_.reset();
+        return *this;
+      }
+
+      Clip(Physmem_->NextSpan(SpanEnd / Page::Size));
+      return *this;
+    }
+
+    span_iterator operator++(int) {
+      span_iterator Old = *this;
+      ++*this;
+      return Old;
+    }
+
+    bool operator==(const span_iterator &Other) const {
+      if (Physmem_ != Other.Physmem_ ||
+          Current_.has_value() != Other.Current_.has_value()) {
+        return false;
+      }
+
+      return !Current_ ||
+             Current_->PhysicalAddress == Other.Current_->PhysicalAddress;
+    }
+
+    bool operator!=(const span_iterator &Other) const {
+      return !(*this == Other);
+    }
+  };
+
+  //
+  // Iterator that walks every span of the physical memory in increasing file
+  // offset order.
+  //
+
+  class file_order_iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = PhysmemSpan_t;
+    using difference_type = ptrdiff_t;
+    using pointer = const value_type *;
+    using reference = const value_type &;
+
+  private:
+    const Physmem_t *Physmem_ = nullptr;
+
+    //
+    // Index of the current run in file order; for bitmap dumps, it is the Pfn
+    // the next span is looked for from.
+    //
+
+    uint64_t Position_ = 0;
+    std::optional<PhysmemSpan_t> Current_;
+
+    void Update() {
+      Current_.reset();
+
+      //
+      // The pages of bitmap dumps are stored in increasing Pfn order, so the
+      // spans are walked in memory order.
+      //
+
+      if (Physmem_->Bitmap_) {
+        Current_ = Physmem_->NextSpan(Position_);
+        return;
+      }
+
+      const auto &Runs = Physmem_->Runs();
+      if (Position_ >= Runs.size()) {
+        return;
+      }
+
+      const auto &FileOrder = Physmem_->FileOrder_;
+      const auto &Run =
+          Runs[FileOrder.empty() ? Position_ : FileOrder[Position_]];
+      Current_ = PhysmemSpan_t{Run.Pfn * Page::Size,
+                               Physmem_->Data(Run.FileOffset),
+                               Run.PageCount * Page::Size};
+    }
+
+  public:
+    file_order_iterator() = default;
+    explicit file_order_iterator(const Physmem_t *Physmem)
+        : Physmem_(Physmem) {}
+    file_order_iterator(const Physmem_t *Physmem, const uint64_t Position)
+        : Physmem_(Physmem), Position_(Position) {
+      Update();
+    }
+
+    reference operator*() const { return *Current_; }
+    pointer operator->() const { return &*Current_; }
+
+    file_order_iterator &operator++() {
+
+      if (Physmem_->Bitmap_) {
+        Position_ = (Current_->PhysicalAddress + Current_->Size) / Page::Size;
+      } else {
+        Position_++;
+      }
+
+      Update();
+      return *this;
+    }
+
+    file_order_iterator operator++(int) {
+      file_order_iterator Old = *this;
+      ++*this;
+      return Old;
+    }
+
+    bool operator==(const file_order_iterator &Other) const {
+      if (Physmem_ != Other.Physmem_ ||
+          Current_.has_value() != Other.Current_.has_value()) {
+        return false;
+      }
+
+      return !Current_ ||
+             Current_->PhysicalAddress == Other.Current_->PhysicalAddress;
+    }
+
+    bool operator!=(const file_order_iterator &Other) const {
+      return !(*this == Other);
+    }
+  };
+
+  //
+  // A pair of iterators that can be used in range-based for loops; see
+  // `Spans` and `FileOrderSpans`.
+  //
+
+  template <typename Iterator_t> class range {
+    Iterator_t Begin_;
+    Iterator_t End_;
+
+  public:
+    range(const Iterator_t &Begin, const Iterator_t &End)
+        : Begin_(Begin), End_(End) {}
+
+    Iterator_t begin() const { return Begin_; }
+    Iterator_t end() const { return End_; }
+  };
+
+  using span_range = range<span_iterator>;
+  using file_order_range = range<file_order_iterator>;
+
+  //
+  // Set the view the file offsets are relative to. If `Backend` is set, the
+  // view doesn't cover the pages and they are read from the backend instead.
+  //
+
+  void SetView(const uint8_t *ViewBase, const uint64_t ViewSize,
+               const FileBackend_t *Backend = nullptr) {
+    ViewBase_ = ViewBase;
+    ViewSize_ = ViewSize;
+    Backend_ = Backend;
+  }
+
+  //
+  // Is the content of the pages in the view?
+  //
+
+  bool Mapped() const { return Backend_ == nullptr; }
+
+  //
+  // Get a pointer to the data at a file offset, or nullptr if the pages aren't
+  // in the view.
+  //
+
+  const uint8_t *Data(const uint64_t FileOffset) const {
+    if (!Mapped()) {
+      return nullptr;
+    }
+
+    return ViewBase_ + FileOffset;
+  }
+
+  //
+  // Copy the data at a file offset, from the view or from the backend. Returns
+  // false if the backend couldn't read all of it.
+  //
+
+  bool ReadData(const uint64_t FileOffset, uint8_t *Out,
+                const uint64_t Size) const {
+    if (Mapped()) {
+      memcpy(Out, ViewBase_ + FileOffset, size_t(Size));
+      return true;
+    }
+
+    return Backend_->Read(FileOffset, Out, Size) == Size;
+  }
+
+  //
+  // Add a run of pages to the index. The run is merged with the previous one
+  // if they are contiguous both in physical memory and in the file, which
+  // means it is fine to add pages one by one. `Finalize` needs to be called
+  // once every run has been added.
+  //
+
+  void AddRun(const uint64_t Pfn, const uint64_t PageCount,
+              const uint64_t FileOffset) {
+    if (PageCount == 0) {
+      return;
+    }
+
+    if (!Runs_.empty()) {
+      PhysmemRun_t &Last = Runs_.back();
+      const bool PfnContiguous = (Last.Pfn + Last.PageCount) == Pfn;
+      const bool FileContiguous =
+          (Last.FileOffset + (Last.PageCount * Page::Size)) == FileOffset;
+      if (PfnContiguous && FileContiguous) {
+        Last.PageCount += PageCount;
+        return;
+      }
+    }
+
+    Runs_.push_back({Pfn, PageCount, FileOffset});
+  }
+
+  //
+  // Sort the runs, deal with overlapping ones and merge the contiguous ones.
+  // If a page is described by several runs, the first run added wins.
+  //
+
+  void Finalize() {
+    if (Bitmap_ || !ExternalRuns_.empty()) {
+      return;
+    }
+
+    const bool SortedAndDisjoint =
+        std::adjacent_find(Runs_.cbegin(), Runs_.cend(),
+                           [](const PhysmemRun_t &A, const PhysmemRun_t &B) {
+                             return B.Pfn < (A.Pfn + A.PageCount);
+                           }) == Runs_.cend();
+
+    std::vector<PhysmemRun_t> Runs = std::move(Runs_);
+    Runs_.clear();
+    NumberOfPages_ = 0;
+
+    if (!SortedAndDisjoint) {
+      SortRuns(Runs);
+    }
+
+    for (const auto &Run : Runs) {
+      AddRun(Run.Pfn, Run.PageCount, Run.FileOffset);
+      NumberOfPages_ += Run.PageCount;
+    }
+
+    Runs_.shrink_to_fit();
+    BuildFileOrder();
+  }
+
+  //
+  // Use a bitmap to describe the physical memory: bit N is set if the page
+  // with Pfn N is in the dump. The pages are stored one after the other from
+  // `FirstPage`, in increasing Pfn order.
+  //
+
+  void SetBitmap(const uint8_t *Bitmap, const uint64_t BitmapSize,
+                 const uint64_t FirstPage, const uint32_t NumberOfThreads = 1) {
+    Runs_.clear();
+    ExternalRuns_ = {};
+    FileOrder_.clear();
+    Bitmap_.emplace();
+    Bitmap_->Build(Bitmap, BitmapSize, NumberOfThreads);
+    BitmapFirstPage_ = FirstPage;
+    NumberOfPages_ = Bitmap_->NumberOfBitsSet();
+  }
+
+  //
+  // Use runs that are sorted by Pfn and don't overlap, instead of building
+  // them; the array needs to outlive the index. Returns false if the runs
+  // don't look right.
+  //
+
+  bool UseRuns(const PhysmemRun_t *Runs, const uint64_t NumberOfRuns,
+               const uint64_t ViewSize) {
+    Runs_.clear();
+    Bitmap_.reset();
+    ExternalRuns_ = {Runs, size_t(NumberOfRuns)};
+    NumberOfPages_ = 0;
+
+    //
+    // The runs are used to compute pointers into the view, so make sure they
+    // stay in bounds.
+    //
+
+    uint64_t NextPfn = 0;
+    for (const auto &Run : ExternalRuns_) {
+      const uint64_t MaxPageCount = ViewSize / Page::Size;
+      if (Run.Pfn < NextPfn || Run.PageCount == 0 ||
+          Run.PageCount > MaxPageCount || Run.FileOffset > ViewSize ||
+          (ViewSize - Run.FileOffset) < (Run.PageCount * Page::Size) ||
+          (Run.Pfn + Run.PageCount) < Run.Pfn) {
+        ExternalRuns_ = {};
+        return false;
+      }
+
+      NextPfn = Run.Pfn + Run.PageCount;
+      NumberOfPages_ += Run.PageCount;
+    }
+
+    BuildFileOrder();
+    return true;
+  }
+
+  //
+  // Get the runs; they are empty if the physical memory is described by a
+  // bitmap.
+  //
+
+  ArrayView_t<PhysmemRun_t> Runs() const {
+    if (!ExternalRuns_.empty()) {
+      return ExternalRuns_;
+    }
+
+    return Runs_;
+  }
+
+  //
+  // Get the view the file offsets are relative to.
+  //
+
+  const uint8_t *ViewBase() const { return ViewBase_; }
+  uint64_t ViewSize() const { return ViewSize_; }
+
+  //
+  // Get the file offset of a page.
+  //
+
+  std::optional<uint64_t> PageOffset(const uint64_t Pfn) const {
+    if (Bitmap_) {
+      const auto &Rank = Bitmap_->Rank(Pfn);
+      if (!Rank) {
+        return {};
+      }
+
+      return BitmapFirstPage_ + (*Rank * Page::Size);
+    }
+
+    const PhysmemRun_t *Run = FindRun(Pfn);
+    if (!Run) {
+      return {};
+    }
+
+    return Run->FileOffset + ((Pfn - Run->Pfn) * Page::Size);
+  }
+
+  //
+  // Get the run that starts at a Pfn and spans as many pages as possible.
+  //
+
+  std::optional<PhysmemRun_t> RunAt(const uint64_t Pfn) const {
+    if (Bitmap_) {
+      const auto &FileOffset = PageOffset(Pfn);
+      if (!FileOffset) {
+        return {};
+      }
+
+      const uint64_t PageCount = Bitmap_->FindNextClear(Pfn + 1) - Pfn;
+      return PhysmemRun_t{Pfn, PageCount, *FileOffset};
+    }
+
+    const PhysmemRun_t *Run = FindRun(Pfn);
+    if (!Run) {
+      return {};
+    }
+
+    const uint64_t PageIdx = Pfn - Run->Pfn;
+    return PhysmemRun_t{Pfn, Run->PageCount - PageIdx,
+                        Run->FileOffset + (PageIdx * Page::Size)};
+  }
+
+  //
+  // Get the first run that starts at, or after, a Pfn.
+  //
+
+  std::optional<PhysmemRun_t> NextRun(const uint64_t Pfn) const {
+    if (Bitmap_) {
+      const uint64_t NextPfn = Bitmap_->FindNextSet(Pfn);
+      if (NextPfn >= Bitmap_->NumberOfBits()) {
+        return {};
+      }
+
+      return RunAt(NextPfn);
+    }
+
+    const auto &Runs = this->Runs();
+    const auto &It = std::lower_bound(
+        Runs.cbegin(), Runs.cend(), Pfn,
+        [](const PhysmemRun_t &Run, const uint64_t Pfn) {
+          return (Run.Pfn + Run.PageCount) <= Pfn;
+        });
+
+    if (It == Runs.cend()) {
+      return {};
+    }
+
+    return RunAt(std::max(Pfn, It->Pfn));
+  }
+
+  //
+  // Get a pointer to the content of a page; the physical address needs to be
+  // page-aligned.
+  //
+
+  const uint8_t *GetPage(const uint64_t PhysicalAddress) const {
+    if (Page::Offset(PhysicalAddress)) {
+      return nullptr;
+    }
+
+    const auto &FileOffset = PageOffset(PhysicalAddress / Page::Size);
+    if (!FileOffset) {
+      return nullptr;
+    }
+
+    return Data(*FileOffset);
+  }
+
+  //
+  // Copy `Size` bytes at a physical address; they need to be in a single page.
+  // Returns false if the page isn't in the dump or couldn't be read.
+  //
+
+  bool ReadPage(const uint64_t PhysicalAddress, uint8_t *Out,
+                const uint64_t Size) const {
+    const auto &FileOffset = PageOffset(PhysicalAddress / Page::Size);
+    if (!FileOffset) {
+      return false;
+    }
+
+    return ReadData(*FileOffset + Page::Offset(PhysicalAddress), Out, Size);
+  }
+
+  //
+  // Get the longest span that starts at a physical address; the address
+  // doesn't need to be aligned.
+  //
+
+  std::optional<PhysmemSpan_t> SpanAt(const uint64_t PhysicalAddress) const {
+    const auto &Run = RunAt(PhysicalAddress / Page::Size);
+    if (!Run) {
+      return {};
+    }
+
+    //
+    // The content of the span is only there if the file is mapped; offsetting
+    // a null `Data` would make it look like it is.
+    //
+
+    const uint64_t Offset = Page::Offset(PhysicalAddress);
+    const uint8_t *SpanData = Data(Run->FileOffset);
+    return PhysmemSpan_t{PhysicalAddress,
+                         SpanData ? SpanData + Offset : nullptr,
+                         (Run->PageCount * Page::Size) - Offset};
+  }
+
+  //
+  // Get the first span that starts at, or after, a Pfn.
+  //
+
+  std::optional<PhysmemSpan_t> NextSpan(const uint64_t Pfn) const {
+    const auto &Run = NextRun(Pfn);
+    if (!Run) {
+      return {};
+    }
+
+    return PhysmemSpan_t{Run->Pfn * Page::Size, Data(Run->FileOffset),
+                         Run->PageCount * Page::Size};
+  }
+
+  //
+  // Get the spans covering `Size` bytes of physical memory starting at a
+  // physical address; the first and the last spans are clipped to the range.
+  //
+
+  span_range Spans(const uint64_t PhysicalAddress, const uint64_t Size) const {
+    const uint64_t MaxSize = 0 - PhysicalAddress;
+    const uint64_t EndAddress =
+        (MaxSize && Size >= MaxSize) ? ~0ULL : PhysicalAddress + Size;
+    return span_range(span_iterator(this, PhysicalAddress, EndAddress),
+                      span_iterator(this));
+  }
+
+  //
+  // Get every span of the physical memory in increasing file offset order;
+  // walking the dump this way reads the file sequentially.
+  //
+
+  file_order_range FileOrderSpans() const {
+    return file_order_range(file_order_iterator(this, 0),
+                            file_order_iterator(this));
+  }
+
+  //
+  // Read physical memory; the address doesn't need to be aligned. Every run
+  // the read touches is copied in one go, and ranges that aren't in the dump
+  // are handed to `OnMissingPage`; without one, the read stops at the first of
+  // them. The read also stops if the backend fails to read a run. Returns the
+  // number of bytes written to `Out`.
+  //
+
+  uint64_t Read(uint64_t PhysicalAddress, uint8_t *Out, uint64_t Size,
+                const MissingPageCallback_t &OnMissingPage = nullptr) const {
+    uint64_t BytesRead = 0;
+    while (Size > 0) {
+      const auto &Run = RunAt(PhysicalAddress / Page::Size);
+      const uint64_t Offset = Page::Offset(PhysicalAddress);
+      uint64_t Available = 0;
+      if (Run) {
+        Available = (Run->PageCount * Page::Size) - Offset;
+      } else {
+
+        //
+        // The hole goes up to the next span, or to the end of the physical
+        // address space if there is none.
+        //
+
+        const auto &Next = NextSpan(PhysicalAddress / Page::Size);
+        Available = Next ? Next->PhysicalAddress - PhysicalAddress
+                         : (0 - PhysicalAddress);
+      }
+
+      //
+      // `Available` is 0 when the end of the physical address space wraps
+      // around.
+      //
+
+      const uint64_t ChunkSize = Available ? std::min(Size, Available) : Size;
+      if (Run) {
+        if (!ReadData(Run->FileOffset + Offset, Out, ChunkSize)) {
+          break;
+        }
+      } else if (!OnMissingPage ||
+                 !OnMissingPage(PhysicalAddress, Out, ChunkSize)) {
+        break;
+      }
+
+      PhysicalAddress += ChunkSize;
+      Out += ChunkSize;
+      Size -= ChunkSize;
+      BytesRead += ChunkSize;
+    }
+
+    return BytesRead;
+  }
+
+  const_iterator find(const key_type PhysicalAddress) const {
+    if (Page::Offset(PhysicalAddress)) {
+      return end();
+    }
+
+    return const_iterator(this, RunAt(PhysicalAddress / Page::Size));
+  }
+
+  size_type count(const key_type PhysicalAddress) const {
+    return GetPage(PhysicalAddress) != nullptr;
+  }
+
+  size_type size() const { return size_type(NumberOfPages_); }
+  bool empty() const { return NumberOfPages_ == 0; }
+  const_iterator begin() const { return const_iterator(this, NextRun(0)); }
+  const_iterator end() const { return const_iterator(this, {}); }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+
+private:
+  //
+  // Sort the runs by file offset if they aren't already.
+  //
+
+  void BuildFileOrder() {
+    FileOrder_.clear();
+    const auto &Runs = this->Runs();
+    const bool InFileOrder =
+        std::adjacent_find(Runs.cbegin(), Runs.cend(),
+                           [](const PhysmemRun_t &A, const PhysmemRun_t &B) {
+                             return B.FileOffset < A.FileOffset;
+                           }) == Runs.cend();
+
+    if (InFileOrder) {
+      return;
+    }
+
+    FileOrder_.resize(Runs.size());
+    for (uint64_t RunIdx = 0; RunIdx < Runs.size(); RunIdx++) {
+      FileOrder_[RunIdx] = RunIdx;
+    }
+
+    std::sort(FileOrder_.begin(), FileOrder_.end(),
+              [&](const uint64_t A, const uint64_t B) {
+                return Runs[A].FileOffset < Runs[B].FileOffset;
+              });
+  }
+
+  //
+  // Find the run that contains a page frame number.
+  //
+
+  const PhysmemRun_t *FindRun(const uint64_t Pfn) const {
+    const auto &Runs = this->Runs();
+    auto It = std::upper_bound(
+        Runs.cbegin(), Runs.cend(), Pfn,
+        [](const uint64_t Pfn, const PhysmemRun_t &Run) {
+          return Pfn < Run.Pfn;
+        });
+
+    if (It == Runs.cbegin()) {
+      return nullptr;
+    }
+
+    It--;
+    if ((Pfn - It->Pfn) >= It->PageCount) {
+      return nullptr;
+    }
+
+    return It;
+  }
+
+  //
+  // Sort runs by Pfn. If runs overlap, the pages are attributed to the run that
+  // appears first in `Runs`.
+  //
+
+  static void SortRuns(std::vector<PhysmemRun_t> &Runs) {
+
+    //
+    // Dumps almost never have overlapping runs, so try a plain sort first and
+    // only fall back to the slower hole filling if it turns out they overlap.
+    //
+
+    std::vector<PhysmemRun_t> Sorted = Runs;
+    std::sort(Sorted.begin(), Sorted.end(),
+              [](const PhysmemRun_t &A, const PhysmemRun_t &B) {
+                return A.Pfn < B.Pfn;
+              });
+
+    const bool Overlap =
+        std::adjacent_find(Sorted.cbegin(), Sorted.cend(),
+                           [](const PhysmemRun_t &A, const PhysmemRun_t &B) {
+                             return B.Pfn < (A.Pfn + A.PageCount);
+                           }) != Sorted.cend();
+
+    if (!Overlap) {
+      Runs = std::move(Sorted);
+      return;
+    }
+
+    std::map<uint64_t, PhysmemRun_t> Disjoint;
+    for (const auto &Run : Runs) {
+      const uint64_t End = Run.Pfn + Run.PageCount;
+      uint64_t Cursor = Run.Pfn;
+      auto It = Disjoint.upper_bound(Cursor);
+      if (It != Disjoint.begin()) {
+        const PhysmemRun_t &Prev = std::prev(It)->second;
+        Cursor = std::max(Cursor, Prev.Pfn + Prev.PageCount);
+      }
+
+      //
+      // Fill the holes between the runs already known.
+      //
+
+      while (Cursor < End) {
+        const uint64_t HoleEnd =
+            It == Disjoint.end() ? End : std::min(End, It->first);
+        if (Cursor < HoleEnd) {
+          const uint64_t FileOffset =
+              Run.FileOffset + ((Cursor - Run.Pfn) * Page::Size);
+          Disjoint.emplace(Cursor,
+                           PhysmemRun_t{Cursor, HoleEnd - Cursor, FileOffset});
+        }
+
+        if (It == Disjoint.end()) {
+          break;
+        }
+
+        Cursor = std::max(Cursor, It->first + It->second.PageCount);
+        It++;
+      }
+    }
+
+    Runs.clear();
+    for (const auto &[_, Run] : Disjoint) {
+      Runs.push_back(Run);
+    }
+  }
+};
+
+} // namespace kdmpparser
@@ -0,0 +1,291 @@
+// Axel '0vercl0k' Souchet - October 17 2026
+#pragma once
+
+#include "diagnostics.h"
+#include "filemap.h"
+#include "lrucache.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#if defined(LINUX)
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+namespace kdmpparser {
+
+//
+// File backend that reads the file with positional reads instead of mapping
+// it. The file is read in blocks of `BlockSize` bytes that are kept in a
+// sharded LRU cache of at most `CacheSize` bytes, so the memory it uses stays
+// bounded whatever the size of the dump. I/O errors make the reads come back
+// short instead of faulting, like touching a mapped file would.
+//
+
+class PreadFile_t : public FileBackend_t {
+
+  //
+  // Size of the blocks; it is a multiple of the page size.
+  //
+
+  uint64_t BlockSize_ = 0;
+
+  //
+  // Blocks read from the file, keyed by their index. The last block of the
+  // file can be shorter than the others.
+  //
+
+  using Block_t = std::shared_ptr<const std::vector<uint8_t>>;
+  mutable LruCache_t<Block_t> Blocks_;
+
+  uint64_t FileSize_ = 0;
+
+#if defined(WINDOWS)
+  HANDLE File_ = INVALID_HANDLE_VALUE;
+#elif defined(LINUX)
+  int Fd_ = -1;
+#endif
+
+public:
+  static constexpr uint64_t DefaultBlockSize = 0x1'0000;
+  static constexpr uint64_t DefaultCacheSize = 0x1000'0000;
+
+  //
+  // A `CacheSize` smaller than `BlockSize` disables the cache; every read then
+  // goes to the file.
+  //
+
+  explicit PreadFile_t(const uint64_t BlockSize = DefaultBlockSize,
+                       const uint64_t CacheSize = DefaultCacheSize) {
+    BlockSize_ = std::max(Page::Size, Page::Align(BlockSize));
+    Blocks_.SetCapacity(CacheSize / BlockSize_);
+  }
+
+  ~PreadFile_t() override {
+#if defined(WINDOWS)
+    if (File_ != INVALID_HANDLE_VALUE) {
+      CloseHandle(File_);
+      File_ = INVALID_HANDLE_VALUE;
+    }
+#elif defined(LINUX)
+    if (Fd_ != -1) {
+      close(Fd_);
+      Fd_ = -1;
+    }
+#endif
+  }
+
+  PreadFile_t(const PreadFile_t &) = delete;
+  PreadFile_t &operator=(const PreadFile_t &) = delete;
+
+  uint64_t BlockSize() const { return BlockSize_; }
+  uint64_t CacheSize() const { return Blocks_.Capacity() * BlockSize_; }
+  uint64_t Size() const override { return FileSize_; }
+
+  bool Open(const char *PathFile) override {
+#if defined(WINDOWS)
+    File_ = CreateFileA(PathFile, GENERIC_READ, FILE_SHARE_READ, nullptr,
+                        OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (File_ == INVALID_HANDLE_VALUE) {
+      const DWORD GLE = GetLastError();
+      const DiagnosticCode_t Code = GLE == ERROR_FILE_NOT_FOUND
+                                        ? DiagnosticCode_t::FileNotFound
+                                        : DiagnosticCode_t::OpenFileFailed;
+      Diagnostics::Report(Severity_t::Error, Code,
+                          "CreateFile failed with GLE=%lu.", GLE);
+      return false;
+    }
+#elif defined(LINUX)
+    Fd_ = open(PathFile, O_RDONLY);
+    if (Fd_ < 0) {
+      const DiagnosticCode_t Code = errno == ENOENT
+                                        ? DiagnosticCode_t::FileNotFound
+                                        : DiagnosticCode_t::OpenFileFailed;
+      Diagnostics::Report(Severity_t::Error, Code,
+                          "Could not open dump file: %s", strerror(errno));
+      return false;
+    }
+#endif
+
+    return Setup();
+  }
+
+  bool OpenDescriptor(const int Fd) override {
+#if defined(WINDOWS)
+    File_ = DuplicateFileDescriptor(Fd);
+    if (File_ == nullptr) {
+      File_ = INVALID_HANDLE_VALUE;
+      return false;
+    }
+#elif defined(LINUX)
+    Fd_ = DuplicateFileDescriptor(Fd);
+    if (Fd_ < 0) {
+      return false;
+    }
+#endif
+
+    return Setup();
+  }
+
+  uint64_t Read(const uint64_t Offset, void *Out,
+                const uint64_t Size) const override {
+    if (Offset >= FileSize_) {
+      return 0;
+    }
+
+    const uint64_t Available = std::min(Size, FileSize_ - Offset);
+    if (!Blocks_.Enabled()) {
+      return ReadAt(Offset, Out, Available);
+    }
+
+    uint8_t *Buffer = (uint8_t *)Out;
+    uint64_t BytesRead = 0;
+    while (BytesRead < Available) {
+      const uint64_t Current = Offset + BytesRead;
+      const uint64_t BlockIdx = Current / BlockSize_;
+      const uint64_t BlockOffset = Current % BlockSize_;
+      auto Block = Blocks_.Lookup(BlockIdx);
+      if (!Block) {
+        Block = LoadBlock(BlockIdx);
+        if (!*Block) {
+          break;
+        }
+      }
+
+      const auto &Data = **Block;
+      const uint64_t ChunkSize =
+          std::min(Available - BytesRead, Data.size() - BlockOffset);
+      memcpy(Buffer + BytesRead, Data.data() + BlockOffset, size_t(ChunkSize));
+      BytesRead += ChunkSize;
+    }
+
+    return BytesRead;
+  }
+
+  //
+  // The hints only apply to the page cache of the file; the blocks already
+  // in the cache stay there.
+  //
+
+  bool Advise(const AccessHint_t Hint, const uint64_t Offset,
+              const uint64_t Size) const override {
+#if defined(LINUX)
+    if (Fd_ == -1 || Offset >= FileSize_) {
+      return false;
+    }
+
+    return AdviseFile(Fd_, Hint, Offset, Size);
+#else
+    (void)Hint;
+    (void)Offset;
+    (void)Size;
+    return true;
+#endif
+  }
+
+private:
+  //
+  // Get the size of the open file.
+  //
+
+  bool Setup() {
+#if defined(WINDOWS)
+    LARGE_INTEGER FileSize = {0};
+    if (!GetFileSizeEx(File_, &FileSize)) {
+      const DWORD GLE = GetLastError();
+      Diagnostics::Report(Severity_t::Error, DiagnosticCode_t::FileSizeFailed,
+                          "GetFileSizeEx failed with GLE=%lu.", GLE);
+      return false;
+    }
+
+    FileSize_ = uint64_t(FileSize.QuadPart);
+#elif defined(LINUX)
+    struct stat Stat;
+    if (fstat(Fd_, &Stat) < 0) {
+      Diagnostics::Report(Severity_t::Error, DiagnosticCode_t::FileSizeFailed,
+                          "Could not stat dump file: %s", strerror(errno));
+      return false;
+    }
+
+    FileSize_ = uint64_t(Stat.st_size);
+#endif
+
+    Blocks_.Clear();
+    return true;
+  }
+
+  //
+  // Read a block from the file and insert it in the cache; nullptr is returned
+  // if the read failed.
+  //
+
+  Block_t LoadBlock(const uint64_t BlockIdx) const {
+    const uint64_t BlockOffset = BlockIdx * BlockSize_;
+    const uint64_t Size = std::min(BlockSize_, FileSize_ - BlockOffset);
+    auto Data = std::make_shared<std::vector<uint8_t>>(size_t(Size));
+    if (ReadAt(BlockOffset, Data->data(), Size) != Size) {
+      return nullptr;
+    }
+
+    Block_t Block = std::move(Data);
+    Blocks_.Insert(BlockIdx, Block);
+    return Block;
+  }
+
+  //
+  // Read from the file, bypassing the cache. Returns the number of bytes read;
+  // failures are reported as diagnostics.
+  //
+
+  uint64_t ReadAt(const uint64_t Offset, void *Out, const uint64_t Size) const {
+    uint8_t *Buffer = (uint8_t *)Out;
+    uint64_t BytesRead = 0;
+    while (BytesRead < Size) {
+      const uint64_t Remaining = std::min(Size - BytesRead, uint64_t(1) << 30);
+#if defined(WINDOWS)
+      const uint64_t Current = Offset + BytesRead;
+      OVERLAPPED Overlapped = {};
+      Overlapped.Offset = DWORD(Current);
+      Overlapped.OffsetHigh = DWORD(Current >> 32);
+      DWORD ChunkSize = 0;
+      if (!ReadFile(File_, Buffer + BytesRead, DWORD(Remaining), &ChunkSize,
+                    &Overlapped)) {
+        const DWORD GLE = GetLastError();
+        Diagnostics::Report(Severity_t::Error, DiagnosticCode_t::ReadFailed,
+                            "ReadFile failed with GLE=%lu.", GLE);
+        break;
+      }
+#elif defined(LINUX)
+      const ssize_t ChunkSize =
+          pread(Fd_, Buffer + BytesRead, size_t(Remaining),
+                off_t(Offset + BytesRead));
+      if (ChunkSize < 0 && errno == EINTR) {
+        continue;
+      }
+
+      if (ChunkSize < 0) {
+        Diagnostics::Report(Severity_t::Error, DiagnosticCode_t::ReadFailed,
+                            "Could not read dump file: %s", strerror(errno));
+        break;
+      }
+#endif
+
+      if (ChunkSize == 0) {
+        break;
+      }
+
+      BytesRead += uint64_t(ChunkSize);
+    }
+
+    return BytesRead;
+  }
+};
+
+} // namespace kdmpparser
@@ -0,0 +1,156 @@
+// Axel '0vercl0k' Souchet - October 17 2026
+#pragma once
+
+#include "filemap.h"
+#include "parallel.h"
+#include "tlb.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace kdmpparser {
+
+//
+// A virtual address that maps a physical address.
+//
+
+struct ReverseMapping_t {
+  uint64_t DirectoryTableBase;
+  uint64_t VirtualAddress;
+};
+
+//
+// Index of the virtual pages mapping each physical page, in one or more
+// address spaces. Every mapped virtual page is an entry made of its physical
+// page frame number, the index of its directory table base and its virtual
+// address; the entries are sorted, so that the mappings of a physical page
+// are found with a binary search.
+//
+
+class ReverseMap_t {
+
+  //
+  // The key packs the page frame number (at most 40 bits) above the index of
+  // the directory table base.
+  //
+
+  static constexpr uint64_t DirectoryTableBaseBits = 16;
+
+  struct Entry_t {
+    uint64_t Key;
+    uint64_t VirtualPage;
+
+    bool operator<(const Entry_t &Other) const {
+      return Key < Other.Key ||
+             (Key == Other.Key && VirtualPage < Other.VirtualPage);
+    }
+  };
+
+  std::vector<uint64_t> DirectoryTableBases_;
+  std::vector<Entry_t> Entries_;
+
+public:
+  static constexpr uint64_t MaxNumberOfDirectoryTableBases =
+      1ULL << DirectoryTableBaseBits;
+
+  //
+  // Build the index out of the ranges mapped by each directory table base;
+  // `Ranges[Idx]` are the ranges mapped by `DirectoryTableBases[Idx]`. The
+  // entries are generated and sorted by `NumberOfThreads` threads.
+  //
+
+  bool Build(const std::vector<uint64_t> &DirectoryTableBases,
+             const std::vector<std::vector<VirtualRange_t>> &Ranges,
+             const uint32_t NumberOfThreads = 1) {
+    DirectoryTableBases_.clear();
+    Entries_.clear();
+    if (DirectoryTableBases.size() != Ranges.size() ||
+        DirectoryTableBases.size() > MaxNumberOfDirectoryTableBases) {
+      return false;
+    }
+
+    //
+    // Figure out where the entries of every range go.
+    //
+
+    struct Job_t {
+      uint64_t DirectoryTableBaseIdx;
+      const VirtualRange_t *Range;
+      uint64_t FirstEntry;
+    };
+
+    std::vector<Job_t> Jobs;
+    uint64_t NumberOfEntries = 0;
+    for (size_t DtbIdx = 0; DtbIdx < Ranges.size(); DtbIdx++) {
+      for (const auto &Range : Ranges[DtbIdx]) {
+        Jobs.push_back(Job_t{DtbIdx, &Range, NumberOfEntries});
+        NumberOfEntries += Range.Size / Page::Size;
+      }
+    }
+
+    Entries_.resize(NumberOfEntries);
+    ParallelFor(NumberOfThreads, Jobs.size(), [&](const uint64_t JobIdx) {
+      const Job_t &Job = Jobs[JobIdx];
+      const uint64_t FirstPfn = Job.Range->PhysicalAddress / Page::Size;
+      const uint64_t NumberOfPages = Job.Range->Size / Page::Size;
+      for (uint64_t PageIdx = 0; PageIdx < NumberOfPages; PageIdx++) {
+        Entry_t &Entry = Entries_[Job.FirstEntry + PageIdx];
+        Entry.Key = ((FirstPfn + PageIdx) << DirectoryTableBaseBits) |
+                    Job.DirectoryTableBaseIdx;
+        Entry.VirtualPage = Job.Range->VirtualAddress + (PageIdx * Page::Size);
+      }
+    });
+
+    ParallelSort(NumberOfThreads, Entries_.begin(), Entries_.end(),
+                 std::less<Entry_t>());
+
+    for (const uint64_t DirectoryTableBase : DirectoryTableBases) {
+      DirectoryTableBases_.push_back(Page::Align(DirectoryTableBase));
+    }
+
+    return true;
+  }
+
+  //
+  // Get the virtual addresses that map a physical address, sorted by
+  // directory table base index then virtual address.
+  //
+
+  std::vector<ReverseMapping_t> Find(const uint64_t PhysicalAddress) const {
+    const uint64_t Pfn = PhysicalAddress / Page::Size;
+    const Entry_t First = {Pfn << DirectoryTableBaseBits, 0};
+    std::vector<ReverseMapping_t> Mappings;
+    auto Entry = std::lower_bound(Entries_.begin(), Entries_.end(), First);
+    for (; Entry != Entries_.end(); Entry++) {
+      if ((Entry->Key >> DirectoryTableBaseBits) != Pfn) {
+        break;
+      }
+
+      const uint64_t DtbIdx = Entry->Key & (MaxNumberOfDirectoryTableBases - 1);
+      Mappings.push_back(
+          ReverseMapping_t{DirectoryTableBases_[DtbIdx],
+                           Entry->VirtualPage + Page::Offset(PhysicalAddress)});
+    }
+
+    return Mappings;
+  }
+
+  //
+  // Get the directory table bases the index has been built for.
+  //
+
+  const std::vector<uint64_t> &DirectoryTableBases() const {
+    return DirectoryTableBases_;
+  }
+
+  //
+  // Get the number of mapped virtual pages.
+  //
+
+  size_t size() const { return Entries_.size(); }
+  bool empty() const { return Entries_.empty(); }
+};
+
+} // namespace kdmpparser
@@ -0,0 +1,388 @@
+// Axel '0vercl0k' Souchet - October 17 2026
+#pragma once
+
+#include "diagnostics.h"
+#include "filemap.h"
+#include "kdmp-parser.h"
+#include "physmem.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#if defined(WINDOWS)
+#include <io.h>
+#elif defined(LINUX)
+#include <errno.h>
+#include <unistd.h>
+#endif
+
+namespace kdmpparser {
+
+//
+// Read the next bytes of a stream to `Out`. Returns the number of bytes read,
+// which can be less than `Size`; 0 means that the stream is over, or that it
+// failed.
+//
+
+using StreamReadCallback_t =
+    std::function<uint64_t(void *Out, const uint64_t Size)>;
+
+//
+// Invoked with the content of every page of the dump as it goes by; the page
+// is only valid during the call. Returns false to stop streaming.
+//
+
+using StreamPageCallback_t = std::function<bool(
+    const uint64_t PhysicalAddress, const uint8_t *Page)>;
+
+//
+// Options controlling how a dump is streamed.
+//
+
+struct StreamOptions_t {
+
+  //
+  // Maximum size of the beginning of the dump, up to its first page, which is
+  // kept in memory: it holds the headers as well as the metadata describing
+  // where the pages are.
+  //
+
+  uint64_t MaxMetadataSize = 0x1000'0000;
+
+  //
+  // Size of the buffer the pages are read to; it is rounded up to a page.
+  //
+
+  uint64_t BufferSize = 0x10'0000;
+};
+
+//
+// Parse a dump in a single pass, without seeking, as it is read from a pipe or
+// a socket. The headers and the metadata at the beginning of the dump are read
+// first, and parsed like a dump that would end there, which gives the runs of
+// pages in the order they are stored; then every page is handed to a callback
+// as it goes by. The memory used is the one of the metadata and of a buffer of
+// pages, whatever the size of the dump.
+//
+
+class StreamParser_t {
+
+  //
+  // Backend serving the beginning of the dump that has been read; nothing
+  // else of the dump is available, so reads past it come back empty.
+  //
+
+  class MetadataFile_t : public FileBackend_t {
+    std::vector<uint8_t> Metadata_;
+    uint64_t Size_ = 0;
+
+  public:
+    MetadataFile_t(std::vector<uint8_t> Metadata, const uint64_t Size)
+        : Metadata_(std::move(Metadata)), Size_(Size) {}
+
+    bool Open(const char *) override { return true; }
+    uint64_t Size() const override { return Size_; }
+
+    uint64_t Read(const uint64_t Offset, void *Out,
+                  const uint64_t Size) const override {
+      if (Offset >= Metadata_.size()) {
+        return 0;
+      }
+
+      const uint64_t Available = std::min(Size, Metadata_.size() - Offset);
+      memcpy(Out, Metadata_.data() + Offset, size_t(Available));
+      return Available;
+    }
+  };
+
+  //
+  // The size of a stream isn't known until it is over, so a dump that doesn't
+  // say how big it is is assumed to be this big.
+  //
+
+  static constexpr uint64_t UnknownStreamSize = 1ULL << 52;
+
+  //
+  // The dump as far as its metadata goes.
+  //
+
+  KernelDumpParser Dmp_;
+
+  //
+  // The runs of pages, sorted by file offset.
+  //
+
+  std::vector<PhysmemRun_t> Runs_;
+
+  //
+  // Number of bytes of the stream that have been read.
+  //
+
+  uint64_t Position_ = 0;
+
+  //
+  // Bytes that have been read past the metadata, and that are handed out
+  // before reading more of the stream.
+  //
+
+  std::vector<uint8_t> Lookahead_;
+  StreamOptions_t Options_;
+
+public:
+  //
+  // Get a stream reading from a file descriptor owned by the caller.
+  //
+
+  static StreamReadCallback_t DescriptorReader(const int Fd) {
+    return [Fd](void *Out, const uint64_t Size) -> uint64_t {
+      const uint32_t ChunkSize =
+          uint32_t(std::min(Size, uint64_t(0x4000'0000)));
+      while (true) {
+#if defined(WINDOWS)
+        const int BytesRead = _read(Fd, Out, ChunkSize);
+#else
+        const ssize_t BytesRead = read(Fd, Out, ChunkSize);
+        if (BytesRead < 0 && errno == EINTR) {
+          continue;
+        }
+#endif
+
+        if (BytesRead < 0) {
+          Diagnostics::Report(Severity_t::Error, DiagnosticCode_t::ReadFailed,
+                              "Could not read the stream: %s",
+                              strerror(errno));
+          return 0;
+        }
+
+        return uint64_t(BytesRead);
+      }
+    };
+  }
+
+  //
+  // Read and parse the beginning of the dump, up to its first page. Once this
+  // returns, the headers are available through `GetDumpParser` and the runs
+  // of pages through `GetRuns`. Failures are reported as diagnostics.
+  //
+
+  bool ParseMetadata(const StreamReadCallback_t &Read,
+                     const StreamOptions_t &Options = {}) {
+    Options_ = Options;
+    Runs_.clear();
+    Position_ = 0;
+    Lookahead_.clear();
+
+    HEADER64 Header = {};
+    if (!ReadExactly(Read, &Header, sizeof(Header))) {
+      Diagnostics::Report(Severity_t::Error, DiagnosticCode_t::ReadFailed,
+                          "Could not read the header of the dump.");
+      return false;
+    }
+
+    const uint64_t MetadataSize = KernelDumpParser::GetMetadataSize(Header);
+    if (MetadataSize > Options_.MaxMetadataSize) {
+      Diagnostics::Report(Severity_t::Error, DiagnosticCode_t::InvalidHeader,
+                          "The metadata of the dump is 0x%" PRIx64
+                          " bytes, which is more than the 0x%" PRIx64
+                          " bytes allowed.",
+                          MetadataSize, Options_.MaxMetadataSize);
+      return false;
+    }
+
+    std::vector<uint8_t> Metadata(MetadataSize);
+    memcpy(Metadata.data(), &Header, sizeof(Header));
+    if (!ReadExactly(Read, Metadata.data() + sizeof(Header),
+                     MetadataSize - sizeof(Header))) {
+      Diagnostics::Report(Severity_t::Error, DiagnosticCode_t::ReadFailed,
+                          "Could not read the metadata of the dump.");
+      return false;
+    }
+
+    uint64_t Size = uint64_t(Header.RequiredDumpSpace);
+    if (Size <= MetadataSize || Size > UnknownStreamSize) {
+      Size = UnknownStreamSize;
+    }
+
+    auto File = std::make_unique<MetadataFile_t>(std::move(Metadata), Size);
+    const MetadataFile_t &MetadataFile = *File;
+    if (!Dmp_.Parse(std::move(File))) {
+      return false;
+    }
+
+    //
+    // Walk the pages in the order they are stored; pages that are next to
+    // each other in both physical memory and the file make a single run.
+    //
+
+    for (const auto &Span : Dmp_.GetPhysicalSpansInFileOrder()) {
+      const auto &FileOffset =
+          Dmp_.GetPhysicalPageFileOffset(Span.PhysicalAddress);
+      if (!FileOffset) {
+        continue;
+      }
+
+      Runs_.push_back(PhysmemRun_t{Span.PhysicalAddress / Page::Size,
+                                   Span.Size / Page::Size, *FileOffset});
+    }
+
+    std::sort(Runs_.begin(), Runs_.end(),
+              [](const PhysmemRun_t &A, const PhysmemRun_t &B) {
+                return A.FileOffset < B.FileOffset;
+              });
+
+    //
+    // The header of a full dump overlaps its first page, so the beginning of
+    // the pages might have been read already.
+    //
+
+    const uint64_t FirstPageOffset =
+        Runs_.empty() ? MetadataSize
+                      : std::min(MetadataSize, Runs_.front().FileOffset);
+    Lookahead_.resize(size_t(MetadataSize - FirstPageOffset));
+    MetadataFile.Read(FirstPageOffset, Lookahead_.data(), Lookahead_.size());
+    Position_ = FirstPageOffset;
+    return true;
+  }
+
+  //
+  // Read the rest of the dump, and invoke `OnPage` with every page in file
+  // order. Pages stored before the end of a page that has been read already
+  // can't be read anymore, and are skipped. Returns true if every page has
+  // been read and handed to `OnPage`.
+  //
+
+  bool ReadPages(const StreamReadCallback_t &Read,
+                 const StreamPageCallback_t &OnPage) {
+    const uint64_t BufferSize = std::max(
+        Page::Size, Page::Align(Options_.BufferSize + Page::Size - 1));
+    std::vector<uint8_t> Buffer(BufferSize);
+    bool Success = true;
+    for (const auto &Run : Runs_) {
+      uint64_t FirstPageIdx = 0;
+      if (Run.FileOffset < Position_) {
+        FirstPageIdx = std::min(
+            Run.PageCount,
+            (Position_ - Run.FileOffset + Page::Size - 1) / Page::Size);
+        Diagnostics::Report(Severity_t::Warning, DiagnosticCode_t::ReadFailed,
+                            "0x%" PRIx64 " pages of the run at 0x%" PRIx64
+                            " have gone by already.",
+                            FirstPageIdx, Run.FileOffset);
+        Success = false;
+      }
+
+      uint64_t PageIdx = FirstPageIdx;
+      const uint64_t FirstPageOffset = Run.FileOffset + PageIdx * Page::Size;
+      if (PageIdx < Run.PageCount &&
+          !Skip(Read, FirstPageOffset - Position_, Buffer)) {
+        return false;
+      }
+
+      while (PageIdx < Run.PageCount) {
+        const uint64_t NumberOfPages =
+            std::min(Run.PageCount - PageIdx, BufferSize / Page::Size);
+        if (!ReadExactly(Read, Buffer.data(), NumberOfPages * Page::Size)) {
+          Diagnostics::Report(Severity_t::Error, DiagnosticCode_t::ReadFailed,
+                              "The stream ended before the page at 0x%" PRIx64
+                              ".",
+                              Position_);
+          return false;
+        }
+
+        for (uint64_t Idx = 0; Idx < NumberOfPages; Idx++) {
+          const uint64_t PhysicalAddress =
+              (Run.Pfn + PageIdx + Idx) * Page::Size;
+          if (!OnPage(PhysicalAddress, Buffer.data() + Idx * Page::Size)) {
+            return false;
+          }
+        }
+
+        PageIdx += NumberOfPages;
+      }
+    }
+
+    return Success;
+  }
+
+  //
+  // Parse the beginning of the dump, then read the rest of it.
+  //
+
+  bool Parse(const StreamReadCallback_t &Read,
+             const StreamPageCallback_t &OnPage,
+             const StreamOptions_t &Options = {}) {
+    return ParseMetadata(Read, Options) && ReadPages(Read, OnPage);
+  }
+
+  //
+  // Get the dump as far as its metadata goes: its headers are available, but
+  // its pages aren't.
+  //
+
+  const KernelDumpParser &GetDumpParser() const { return Dmp_; }
+
+  //
+  // Get the runs of pages in the order they are stored in the dump.
+  //
+
+  const std::vector<PhysmemRun_t> &GetRuns() const { return Runs_; }
+
+  //
+  // Get the number of bytes of the stream that have been read.
+  //
+
+  uint64_t GetPosition() const { return Position_; }
+
+private:
+  //
+  // Read exactly `Size` bytes of the stream.
+  //
+
+  bool ReadExactly(const StreamReadCallback_t &Read, void *Out,
+                   const uint64_t Size) {
+    uint8_t *Buffer = (uint8_t *)Out;
+    uint64_t BytesRead = std::min(Size, uint64_t(Lookahead_.size()));
+    if (BytesRead != 0) {
+      memcpy(Buffer, Lookahead_.data(), size_t(BytesRead));
+      Lookahead_.erase(Lookahead_.begin(), Lookahead_.begin() + BytesRead);
+    }
+
+    while (BytesRead < Size) {
+      const uint64_t ChunkSize = Read(Buffer + BytesRead, Size - BytesRead);
+      if (ChunkSize == 0) {
+        return false;
+      }
+
+      BytesRead += std::min(ChunkSize, Size - BytesRead);
+    }
+
+    Position_ += Size;
+    return true;
+  }
+
+  //
+  // Read and throw away `Size` bytes of the stream.
+  //
+
+  bool Skip(const StreamReadCallback_t &Read, uint64_t Size,
+            std::vector<uint8_t> &Buffer) {
+    while (Size != 0) {
+      const uint64_t ChunkSize = std::min(Size, uint64_t(Buffer.size()));
+      if (!ReadExactly(Read, Buffer.data(), ChunkSize)) {
+        Diagnostics::Report(Severity_t::Error, DiagnosticCode_t::ReadFailed,
+                            "The stream ended at 0x%" PRIx64 ".", Position_);
+        return false;
+      }
+
+      Size -= ChunkSize;
+    }
+
+    return true;
+  }
+};
+
+} // namespace kdmpparser
@@ -0,0 +1,317 @@
+// Axel '0vercl0k' Souchet - October 17 2026
+#pragma once
+
+#include "filemap.h"
+#include "kdmp-parser-structs.h"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace kdmpparser {
+
+//
+// The result of a virtual address translation.
+//
+
+struct Translation_t {
+
+  //
+  // The physical address the virtual address translates to.
+  //
+
+  uint64_t PhysicalAddress;
+
+  //
+  // Size of the page that maps the virtual address: 4KB, 2MB or 1GB.
+  //
+
+  uint64_t PageSize;
+};
+
+//
+// A range of virtual memory mapped to contiguous physical memory with the same
+// permissions.
+//
+
+struct VirtualRange_t {
+  uint64_t VirtualAddress;
+  uint64_t PhysicalAddress;
+  uint64_t Size;
+
+  //
+  // Effective permissions: the range is writable and user accessible only if
+  // every paging structure entry leading to it is, and it isn't executable if
+  // any of them says so.
+  //
+
+  bool Write;
+  bool UserAccessible;
+  bool NoExecute;
+};
+
+//
+// Cache of values keyed by directory table base and a 64-bit key. The table is
+// direct-mapped and split in shards that each have their own lock, so that
+// concurrent readers seldom contend. Since a dump never changes, the entries
+// never go stale; `Invalidate` is only useful to get rid of entries that are
+// not needed anymore.
+//
+
+template <typename Value_t> class ShardedCache_t {
+
+  //
+  // Number of shards; a power of two.
+  //
+
+  static constexpr uint64_t NumberOfShards = 64;
+
+  struct Entry_t {
+    bool Valid = false;
+    uint64_t DirectoryTableBase = 0;
+    uint64_t Key = 0;
+    Value_t Value = {};
+  };
+
+  struct Shard_t {
+    std::mutex Lock;
+    std::vector<Entry_t> Entries;
+  };
+
+  std::unique_ptr<std::array<Shard_t, NumberOfShards>> Shards_;
+
+  //
+  // Number of entries per shard; a power of two.
+  //
+
+  uint64_t EntriesPerShard_ = 0;
+
+  //
+  // Mix the directory table base and the key to spread the entries over the
+  // shards and the slots.
+  //
+
+  static uint64_t Hash(const uint64_t DirectoryTableBase, const uint64_t Key) {
+    uint64_t Hash = Key ^ (DirectoryTableBase * 0x9e3779b97f4a7c15ULL);
+    Hash ^= Hash >> 29;
+    Hash *= 0xbf58476d1ce4e5b9ULL;
+    Hash ^= Hash >> 32;
+    return Hash;
+  }
+
+  Shard_t &Shard(const uint64_t Hash) const {
+    return (*Shards_)[Hash % NumberOfShards];
+  }
+
+  Entry_t &Slot(const uint64_t Hash, Shard_t &Shard) const {
+    return Shard.Entries[(Hash / NumberOfShards) & (EntriesPerShard_ - 1)];
+  }
+
+public:
+  //
+  // Set the number of entries of the cache; 0 disables it. This drops every
+  // entry, and isn't safe to call while the cache is used.
+  //
+
+  void SetCapacity(const uint64_t Capacity) {
+    Shards_.reset();
+    EntriesPerShard_ = 0;
+    if (Capacity == 0) {
+      return;
+    }
+
+    const uint64_t MaxEntriesPerShard = 1ULL << 32;
+    EntriesPerShard_ = 1;
+    while ((EntriesPerShard_ * NumberOfShards) < Capacity &&
+           EntriesPerShard_ < MaxEntriesPerShard) {
+      EntriesPerShard_ *= 2;
+    }
+
+    Shards_ = std::make_unique<std::array<Shard_t, NumberOfShards>>();
+    for (auto &Shard : *Shards_) {
+      Shard.Entries.resize(EntriesPerShard_);
+    }
+  }
+
+  //
+  // Get the number of entries of the cache.
+  //
+
+  uint64_t Capacity() const { return EntriesPerShard_ * NumberOfShards; }
+
+  bool Enabled() const { return Shards_ != nullptr; }
+
+  std::optional<Value_t> Lookup(const uint64_t DirectoryTableBase,
+                                const uint64_t Key) const {
+    if (!Enabled()) {
+      return {};
+    }
+
+    const uint64_t Hash = ShardedCache_t::Hash(DirectoryTableBase, Key);
+    Shard_t &Shard = this->Shard(Hash);
+    std::lock_guard<std::mutex> Lock(Shard.Lock);
+    const Entry_t &Entry = Slot(Hash, Shard);
+    if (!Entry.Valid || Entry.DirectoryTableBase != DirectoryTableBase ||
+        Entry.Key != Key) {
+      return {};
+    }
+
+    return Entry.Value;
+  }
+
+  //
+  // Insert a value; it replaces whatever entry was in its slot.
+  //
+
+  void Insert(const uint64_t DirectoryTableBase, const uint64_t Key,
+              const Value_t &Value) {
+    if (!Enabled()) {
+      return;
+    }
+
+    const uint64_t Hash = ShardedCache_t::Hash(DirectoryTableBase, Key);
+    Shard_t &Shard = this->Shard(Hash);
+    std::lock_guard<std::mutex> Lock(Shard.Lock);
+    Entry_t &Entry = Slot(Hash, Shard);
+    Entry.Valid = true;
+    Entry.DirectoryTableBase = DirectoryTableBase;
+    Entry.Key = Key;
+    Entry.Value = Value;
+  }
+
+  //
+  // Drop every entry, or only the ones of a directory table base.
+  //
+
+  void Invalidate(const std::optional<uint64_t> &DirectoryTableBase = {}) {
+    if (!Enabled()) {
+      return;
+    }
+
+    for (auto &Shard : *Shards_) {
+      std::lock_guard<std::mutex> Lock(Shard.Lock);
+      for (auto &Entry : Shard.Entries) {
+        if (!DirectoryTableBase ||
+            Entry.DirectoryTableBase == *DirectoryTableBase) {
+          Entry.Valid = false;
+        }
+      }
+    }
+  }
+};
+
+//
+// Software TLB: caches the result of the page table walks, keyed by directory
+// table base and virtual page. Large pages are cached per 4KB virtual page, so
+// that a lookup is always a single probe.
+//
+
+class Tlb_t {
+  struct Entry_t {
+    uint64_t PhysicalPage;
+    uint64_t PageSize;
+  };
+
+  ShardedCache_t<Entry_t> Cache_;
+
+public:
+  void SetCapacity(const uint64_t Capacity) { Cache_.SetCapacity(Capacity); }
+  uint64_t Capacity() const { return Cache_.Capacity(); }
+  bool Enabled() const { return Cache_.Enabled(); }
+
+  //
+  // Look up the translation of a virtual address.
+  //
+
+  std::optional<Translation_t> Lookup(const uint64_t DirectoryTableBase,
+                                      const uint64_t VirtualAddress) const {
+    const auto &Entry =
+        Cache_.Lookup(DirectoryTableBase, Page::Align(VirtualAddress));
+    if (!Entry) {
+      return {};
+    }
+
+    return Translation_t{Entry->PhysicalPage + Page::Offset(VirtualAddress),
+                         Entry->PageSize};
+  }
+
+  //
+  // Remember the translation of a virtual address.
+  //
+
+  void Insert(const uint64_t DirectoryTableBase, const uint64_t VirtualAddress,
+              const Translation_t &Translation) {
+    Cache_.Insert(DirectoryTableBase, Page::Align(VirtualAddress),
+                  Entry_t{Page::Align(Translation.PhysicalAddress),
+                          Translation.PageSize});
+  }
+
+  void Invalidate(const std::optional<uint64_t> &DirectoryTableBase = {}) {
+    Cache_.Invalidate(DirectoryTableBase);
+  }
+};
+
+//
+// Levels of the paging structures whose entries can be cached.
+//
+
+enum class PagingLevel_t : uint64_t { Pml4 = 39, Pdpt = 30, Pd = 21 };
+
+//
+// Paging-structure cache: caches the present PML4Es, PDPTEs and PDEs, keyed by
+// directory table base and the indices that lead to them (the bits of the
+// virtual address above the level). A walk resumes at the deepest level that
+// is cached, so walking neighbouring addresses only reads their PTEs.
+//
+
+class PagingStructureCache_t {
+  ShardedCache_t<uint64_t> Cache_;
+
+  //
+  // The key is made of the level and the bits of the canonical virtual address
+  // that index the paging structures down to the level.
+  //
+
+  static uint64_t Key(const PagingLevel_t Level,
+                      const uint64_t VirtualAddress) {
+    const uint64_t Shift = uint64_t(Level);
+    const uint64_t Indices = (VirtualAddress & 0xffff'ffff'ffffULL) >> Shift;
+    return (Shift << 56) | Indices;
+  }
+
+public:
+  void SetCapacity(const uint64_t Capacity) { Cache_.SetCapacity(Capacity); }
+  uint64_t Capacity() const { return Cache_.Capacity(); }
+  bool Enabled() const { return Cache_.Enabled(); }
+
+  //
+  // Look up the entry of a level that is used to translate a virtual address.
+  //
+
+  std::optional<MMPTE_HARDWARE> Lookup(const uint64_t DirectoryTableBase,
+                                       const PagingLevel_t Level,
+                                       const uint64_t VirtualAddress) const {
+    const auto &Entry =
+        Cache_.Lookup(DirectoryTableBase, Key(Level, VirtualAddress));
+    if (!Entry) {
+      return {};
+    }
+
+    return MMPTE_HARDWARE(*Entry);
+  }
+
+  void Insert(const uint64_t DirectoryTableBase, const PagingLevel_t Level,
+              const uint64_t VirtualAddress, const MMPTE_HARDWARE Entry) {
+    Cache_.Insert(DirectoryTableBase, Key(Level, VirtualAddress),
+                  Entry.AsUINT64);
+  }
+
+  void Invalidate(const std::optional<uint64_t> &DirectoryTableBase = {}) {
+    Cache_.Invalidate(DirectoryTableBase);
+  }
+};
+
+} // namespace kdmpparser
@@ -1,11 +1,16 @@
 // Axel '0vercl0k' Souchet - February 15 2019
 #include "kdmp-parser.h"
+#include "streamparser.h"
 
 #include <algorithm>
 #include <cctype>
 #include <cstring>
 #include <string_view>
-#include <vector>
+
+#if defined(WINDOWS)
+#include <fcntl.h>
+#include <io.h>
+#endif
 
 //
 // Delimiter.
@@ -64,7 +69,13 @@ struct Options_t {
   uint64_t PhysicalAddress = 0;
 
   //
-  // The path to the dump file.
+  // If -z is used, this is where the compressed dump is written.
+  //
+
+  std::string_view CompressedPath;
+
+  //
+  // The path to the dump file; - reads the dump from stdin in a single pass.
   //
 
   std::string_view DumpPath;
@@ -75,7 +86,8 @@ struct Options_t {
 //
 
 void Help() {
-  printf("parser.exe [-p [<physical address>]] [-c] [-e] [-h] <kdump path>\n");
+  printf("parser.exe [-p [<physical address>]] [-c] [-e] [-z <output>] [-h] "
+         "<kdump path>\n");
   printf("\n");
   printf("Examples:\n");
   printf("  Show every structures of the dump:\n");
@@ -94,6 +106,14 @@ void Help() {
   printf("  Show the context record as well as the page at physical "
          "address 0x1000:\n");
   printf("    parser.exe -c -p 0x1000 full.dmp\n");
+  printf("\n");
+  printf("  Write a compressed copy of the dump, that can be parsed like the "
+         "dump:\n");
+  printf("    parser.exe -z full.dmp.lz4 full.dmp\n");
+  printf("\n");
+  printf("  Show the context record and every page of a dump read from "
+         "stdin:\n");
+  printf("    cat full.dmp | parser.exe -c -p -\n");
 }
 
 //
@@ -125,6 +145,87 @@ void Hexdump(const uint64_t Address, const void *Buffer, size_t Len) {
   }
 }
 
+//
+// Show what has been asked about a dump read from stdin, as it goes by; the
+// pages are shown in the order they are stored.
+//
+
+int StreamDump(const Options_t &Opts) {
+  if (!Opts.CompressedPath.empty()) {
+    printf("A dump read from stdin can't be compressed, exiting.\n");
+    return EXIT_FAILURE;
+  }
+
+#if defined(WINDOWS)
+  _setmode(_fileno(stdin), _O_BINARY);
+#endif
+
+  kdmpparser::StreamParser_t Stream;
+  const auto &Read = kdmpparser::StreamParser_t::DescriptorReader(0);
+  if (!Stream.ParseMetadata(Read)) {
+    printf("Parsing of the dump failed, exiting.\n");
+    return EXIT_FAILURE;
+  }
+
+  const kdmpparser::KernelDumpParser &Dmp = Stream.GetDumpParser();
+  if (Opts.ShowAllStructures) {
+    printf(DELIMITER "\nDump structures:\n");
+    Dmp.ShowAllStructures(2);
+  }
+
+  if (Opts.ShowContextRecord) {
+    printf(DELIMITER "\nContext Record:\n");
+    Dmp.ShowContextRecord(2);
+  }
+
+  if (Opts.ShowExceptionRecord) {
+    printf(DELIMITER "\nException Record:\n");
+    Dmp.ShowExceptionRecord(2);
+  }
+
+  //
+  // The rest of the dump is read even if no page is shown, to make sure that
+  // it is all there.
+  //
+
+  if (Opts.ShowPhysicalMem) {
+    printf(DELIMITER "\nPhysical memory:\n");
+  }
+
+  bool Found = false;
+  const bool Success = Stream.ReadPages(
+      Read, [&](const uint64_t PhysicalAddress, const uint8_t *Page) {
+        if (!Opts.ShowPhysicalMem) {
+          return true;
+        }
+
+        if (!Opts.PhysicalAddress) {
+          Hexdump(PhysicalAddress, Page, 16);
+          return true;
+        }
+
+        if (PhysicalAddress != kdmpparser::Page::Align(Opts.PhysicalAddress)) {
+          return true;
+        }
+
+        Found = true;
+        Hexdump(Opts.PhysicalAddress, Page, 0x1000);
+        return false;
+      });
+
+  if (Opts.ShowPhysicalMem && Opts.PhysicalAddress && !Found) {
+    printf("0x%" PRIx64 " is not a valid physical address.\n",
+           Opts.PhysicalAddress);
+  }
+
+  if (!Success && !Found) {
+    printf("Reading of the dump failed, exiting.\n");
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
 //
 // Let's do some work!
 //
@@ -197,6 +298,13 @@ int main(int argc, const char *argv[]) {
       //
 
       Opts.ShowAllStructures = true;
+    } else if (Arg == "-z" && !IsLastArg) {
+
+      //
+      // Compress the dump to the path that follows.
+      //
+
+      Opts.CompressedPath = argv[++ArgIdx];
     } else if (Arg == "-h") {
 
       //
@@ -249,12 +357,21 @@ int main(int argc, const char *argv[]) {
   //
 
   if (!Opts.ShowContextRecord && !Opts.ShowPhysicalMem &&
-      !Opts.ShowAllStructures && !Opts.ShowExceptionRecord) {
+      !Opts.ShowAllStructures && !Opts.ShowExceptionRecord &&
+      Opts.CompressedPath.empty()) {
     printf("Forcing to show the context record as no option as been "
            "passed.\n\n");
     Opts.ShowContextRecord = 1;
   }
 
+  //
+  // A dump read from stdin can only be read once, so it is streamed.
+  //
+
+  if (Opts.DumpPath == "-") {
+    return StreamDump(Opts);
+  }
+
   //
   // Create the parser instance.
   //
@@ -270,6 +387,30 @@ int main(int argc, const char *argv[]) {
     return EXIT_FAILURE;
   }
 
+  //
+  // If the user wants a compressed copy of the dump, then write it.
+  //
+
+  if (!Opts.CompressedPath.empty()) {
+    if (!kdmpparser::CompressFile(Opts.DumpPath.data(),
+                                  Opts.CompressedPath.data())) {
+      printf("Compression of the dump failed, exiting.\n");
+      return EXIT_FAILURE;
+    }
+
+    kdmpparser::CompressedFile_t Compressed(0);
+    if (!Compressed.Open(Opts.CompressedPath.data())) {
+      printf("The compressed dump could not be opened, exiting.\n");
+      return EXIT_FAILURE;
+    }
+
+    printf("Compressed 0x%" PRIx64 " bytes into 0x%" PRIx64
+           " bytes (%.1f%%).\n",
+           Compressed.Size(), Compressed.CompressedSize(),
+           (100. * double(Compressed.CompressedSize())) /
+               double(std::max(Compressed.Size(), uint64_t(1))));
+  }
+
   //
   // If the user wants all the structures, then show them.
   //
@@ -327,37 +468,11 @@ int main(int argc, const char *argv[]) {
 
       //
       // If the user didn't specify a physical address then dump the first
-      // 16 bytes of every physical pages.
-      //
-      // Note that as the physmem is unordered, so we order the addresses here
-      // so that it is nicer for the user as they probably don't expect unorder.
-      //
-
-      const auto &Physmem = Dmp.GetPhysmem();
-      std::vector<kdmpparser::Physmem_t::key_type> OrderedPhysicalAddresses;
-      OrderedPhysicalAddresses.reserve(Physmem.size());
-
-      //
-      // Stuff the physical addresses in a vector.
-      //
-
-      for (const auto &[PhysicalAddress, _] : Dmp.GetPhysmem()) {
-        OrderedPhysicalAddresses.emplace_back(PhysicalAddress);
-      }
-
-      //
-      // Sort them.
-      //
-
-      std::sort(OrderedPhysicalAddresses.begin(),
-                OrderedPhysicalAddresses.end());
-
-      //
-      // And now we can iterate through them and get the page content.
+      // 16 bytes of every physical pages. Note that the physmem is walked in
+      // increasing physical address order.
       //
 
-      for (const auto PhysicalAddress : OrderedPhysicalAddresses) {
-        const uint8_t *Page = Dmp.GetPhysicalPage(PhysicalAddress);
+      for (const auto &[PhysicalAddress, Page] : Dmp.GetPhysmem()) {
         Hexdump(PhysicalAddress, Page, 16);
       }
     }
@@ -3,8 +3,9 @@ Root module of `kdmp_parser` Python package.
 """
 
 import enum
+import os
 import pathlib
-from typing import Optional, Union
+from typing import BinaryIO, Callable, Dict, List, Optional, Union
 
 #
 # `_kdmp_parser` is the C++ module. It contains the port of all C++ classes/enums/etc. in their
@@ -12,8 +13,23 @@ from typing import Optional, Union
 #
 from ._kdmp_parser import (  # type: ignore
     version,
+    CompressFile as _CompressFile,
+    AccessHint_t as AccessHint,
+    AsyncReadOptions_t as _AsyncReadOptions_t,
     DumpType_t as _DumpType_t,
+    DtbCandidate_t as _DtbCandidate_t,
+    FileBackendType_t as _FileBackendType_t,
     KernelDumpParser as _KernelDumpParser,
+    MapReport_t as _MapReport_t,
+    ParseOptions_t as _ParseOptions_t,
+    PhysmemRun_t as _PhysmemRun_t,
+    ReverseMap_t as _ReverseMap_t,
+    StreamOptions_t as _StreamOptions_t,
+    StreamParser_t as _StreamParser_t,
+    VirtualRange_t as _VirtualRange_t,
+    DiagnosticCode_t as DiagnosticCode,
+    Severity_t as Severity,
+    SetDiagnosticsCallback as set_diagnostics_callback,
     CONTEXT as __CONTEXT,
     HEADER64 as __HEADER64,
 )
@@ -34,32 +50,112 @@ class DumpType(enum.IntEnum):
     CompleteMemoryDump = _DumpType_t.CompleteMemoryDump.value
 
 
+def compress_file(
+    input_path: Union[str, pathlib.Path],
+    output_path: Union[str, pathlib.Path],
+    number_of_threads: int = 0,
+) -> bool:
+    """Write a compressed copy of a dump, that `KernelDumpParser` parses like the dump
+
+    Args:
+        input_path (Union[str, pathlib.Path]): the dump to compress
+        output_path (Union[str, pathlib.Path]): where to write the compressed dump
+        number_of_threads (int): the number of threads compressing the dump, 0 for one per hardware thread
+
+    Returns:
+        bool: True if the compressed dump has been written
+    """
+    return _CompressFile(
+        str(pathlib.Path(input_path).absolute()),
+        str(pathlib.Path(output_path).absolute()),
+        NumberOfThreads=number_of_threads,
+    )
+
+
 class KernelDumpParser:
-    def __init__(self, path: Union[str, pathlib.Path]):
+    def __init__(
+        self,
+        path: Union[str, pathlib.Path, bytes, int],
+        number_of_threads: int = 1,
+        use_index_file: bool = False,
+        lazy_physmem: bool = False,
+        build_physmem_in_background: bool = False,
+        tlb_capacity: int = 0,
+        paging_structure_cache_capacity: int = 0,
+        use_pread: bool = False,
+        block_size: int = 0x10000,
+        block_cache_size: int = 0x10000000,
+        access_hint: AccessHint = AccessHint.Normal,
+        advise_scans: bool = True,
+        populate: bool = False,
+        lock_view: bool = False,
+        huge_pages: bool = False,
+    ):
         """Parse a kernel dump file
 
         Args:
-            path (pathlib.Path|str): Path to the kernel dump file
+            path (pathlib.Path|str|bytes|int): Path to the kernel dump file, its content, or a seekable
+            file descriptor open on it, which can be closed once the dump is parsed
+            number_of_threads (int): Number of threads used to index the physical memory, 0 to use all of them
+            use_index_file (bool): Load the index from `<path>.kdmpidx` if it is up to date, write it otherwise (bitmap dumps don't have one)
+            lazy_physmem (bool): Build the index of the physical memory the first time it is needed
+            build_physmem_in_background (bool): With `lazy_physmem`, build the index on a background thread
+            tlb_capacity (int): Number of virtual address translations to cache, 0 to disable the cache
+            paging_structure_cache_capacity (int): Number of PML4E/PDPTE/PDE entries to cache, 0 to disable the cache
+            use_pread (bool): Read the file with positional reads through a block cache instead of mapping it
+            block_size (int): With `use_pread`, size of the blocks read from the file
+            block_cache_size (int): With `use_pread`, maximum number of bytes of blocks to cache
+            access_hint (AccessHint): Hint applied to the whole file once it is opened, see `advise`
+            advise_scans (bool): Let the scans apply the hint that fits them, and release the pages
+            read by `find_directory_table_bases`
+            populate (bool): Read every page of the file in when it is mapped
+            lock_view (bool): Lock the view of the file in memory
+            huge_pages (bool): Copy the file into memory backed by huge pages if it is hosted on
+            tmpfs or hugetlbfs, instead of mapping it
         """
         if isinstance(path, str):
             path = pathlib.Path(path)
 
-        if not isinstance(path, pathlib.Path):
+        if not isinstance(path, (pathlib.Path, bytes, int)):
             raise TypeError
 
-        if not path.exists():
+        if isinstance(path, pathlib.Path) and not path.exists():
             raise ValueError
 
+        options = _ParseOptions_t()
+        options.NumberOfThreads = number_of_threads
+        options.UseIndexFile = use_index_file
+        options.LazyPhysmem = lazy_physmem
+        options.BuildPhysmemInBackground = build_physmem_in_background
+        options.TlbCapacity = tlb_capacity
+        options.PagingStructureCacheCapacity = paging_structure_cache_capacity
+        options.FileBackend = _FileBackendType_t.Pread if use_pread else _FileBackendType_t.Map
+        options.BlockSize = block_size
+        options.BlockCacheSize = block_cache_size
+        options.AccessHint = access_hint
+        options.AdviseScans = advise_scans
+        options.Populate = populate
+        options.LockView = lock_view
+        options.HugePages = huge_pages
+        self.filepath: Optional[pathlib.Path] = path if isinstance(path, pathlib.Path) else None
         self.__dump = _KernelDumpParser()
-        if not self.__dump.Parse(str(path.absolute())):
-            raise RuntimeError(f"Invalid kernel dump file: {path}")
+        if isinstance(path, pathlib.Path):
+            success = self.__dump.Parse(str(path.absolute()), options)
+        elif isinstance(path, bytes):
+            success = self.__dump.Parse(path, options)
+        else:
+            success = self.__dump.ParseDescriptor(path, options)
+
+        if not success:
+            raise RuntimeError(f"Invalid kernel dump file: {self.filepath or type(path).__name__}")
 
-        self.filepath = path
         self.context: __CONTEXT = self.__dump.GetContext()
         self.directory_table_base: int = self.__dump.GetDirectoryTableBase() & ~0xFFF
         self.type = DumpType(self.__dump.GetDumpType().value)
         self.header: __HEADER64 = self.__dump.GetDumpHeader()
         self.pages = _PageIterator(self.__dump)
+        self.map_report: _MapReport_t = self.__dump.GetMapReport()
+        self.compressed: bool = self.__dump.IsCompressed()
         return
 
     def __repr__(self) -> str:
@@ -81,6 +177,55 @@ class KernelDumpParser:
 
         return bytearray(raw_page)
 
+    def read_physical_memory(
+        self, physical_address: int, size: int, fill_byte: Optional[int] = None
+    ) -> bytes:
+        """Read physical memory from the memory dump; the read can be unaligned and
+        span several pages
+
+        Args:
+            physical_address (int): The physical address to read from
+            size (int): The number of bytes to read
+            fill_byte (Optional[int]): if given, pages missing from the dump read as this byte
+
+        Returns:
+            bytes: The bytes read; shorter than `size` if the read hit a missing page
+        """
+        return self.__dump.ReadPhysicalMemory(physical_address, size, fill_byte)
+
+    def read_physical_pages(
+        self,
+        physical_addresses: List[int],
+        queue_depth: int = 128,
+        max_read_size: int = 0x20000,
+        use_io_uring: bool = True,
+        number_of_threads: int = 0,
+    ) -> Dict[int, Optional[bytearray]]:
+        """Read a batch of physical pages scattered over the dump with many reads in flight;
+        the pages next to each other in the file are read together
+
+        Args:
+            physical_addresses (List[int]): the page-aligned physical addresses to read
+            queue_depth (int): maximum number of reads in flight
+            max_read_size (int): maximum size of a read
+            use_io_uring (bool): use io_uring when it is available
+            number_of_threads (int): without io_uring, number of threads reading the file; 0
+            uses one per hardware thread
+
+        Returns:
+            Dict[int, Optional[bytearray]]: The bytes in every page, or None if it couldn't be
+            read
+        """
+        options = _AsyncReadOptions_t()
+        options.QueueDepth = queue_depth
+        options.MaxReadSize = max_read_size
+        options.UseIoUring = use_io_uring
+        options.NumberOfThreads = number_of_threads
+        pages = self.__dump.ReadPhysicalPagesAsync(physical_addresses, options)
+        return {
+            address: bytearray(page) if page is not None else None for address, page in pages
+        }
+
     def read_virtual_page(
         self, virtual_address: int, directory_table_base: Optional[int] = 0
     ) -> Optional[bytearray]:
@@ -99,6 +244,23 @@ class KernelDumpParser:
 
         return bytearray(raw_page)
 
+    def read_virtual_memory(
+        self, virtual_address: int, size: int, directory_table_base: Optional[int] = 0
+    ) -> bytes:
+        """Read virtual memory from the memory dump; the read can be unaligned and span
+        several pages, and every page is only translated once
+
+        Args:
+            virtual_address (int): The virtual address to read from
+            size (int): The number of bytes to read
+            directory_table_base (Optional[int]): if given, corresponds to the DirectoryTableBase value
+
+        Returns:
+            bytes: The bytes read; shorter than `size` if the read hit an address that doesn't
+            translate or a missing page
+        """
+        return self.__dump.ReadVirtualMemory(virtual_address, size, directory_table_base)
+
     def translate_virtual(
         self, virtual_address: int, directory_table_base: Optional[int] = 0
     ) -> Optional[int]:
@@ -115,3 +277,172 @@ class KernelDumpParser:
             otherwise
         """
         return self.__dump.VirtTranslate(virtual_address, directory_table_base)
+
+    def translate_virtual_batch(
+        self, virtual_addresses: List[int], directory_table_base: Optional[int] = 0
+    ) -> List[Optional[int]]:
+        """Translate a batch of virtual addresses to physical. The paging structure entries
+        shared by the addresses are only read once, which makes it cheaper than translating
+        them one by one. A directory table base can be optionally provided
+
+        Args:
+            virtual_addresses (List[int]): the virtual addresses to translate
+            directory_table_base (Optional[int]): if given, corresponds to the DirectoryTableBase
+            value
+
+        Returns:
+            List[Optional[int]]: For each virtual address, the physical address it translates
+            to, or None if it doesn't translate
+        """
+        return self.__dump.VirtTranslateBatch(virtual_addresses, directory_table_base)
+
+    def enumerate_address_space(
+        self, directory_table_base: Optional[int] = 0, number_of_threads: int = 1
+    ) -> List[_VirtualRange_t]:
+        """Enumerate what is mapped in an address space, in ascending virtual address order.
+        Neighbouring pages mapped to contiguous physical memory with the same permissions
+        are reported as a single range. A directory table base can be optionally provided
+
+        Args:
+            directory_table_base (Optional[int]): if given, corresponds to the DirectoryTableBase
+            value
+            number_of_threads (int): number of threads walking the page tables; 0 uses one per
+            hardware thread
+
+        Returns:
+            List[VirtualRange_t]: The mapped ranges, with their VirtualAddress, PhysicalAddress,
+            Size, Write, UserAccessible and NoExecute attributes
+        """
+        return self.__dump.EnumerateAddressSpace(directory_table_base, number_of_threads)
+
+    def build_reverse_map(
+        self, directory_table_bases: Optional[List[int]] = None, number_of_threads: int = 1
+    ) -> Optional[_ReverseMap_t]:
+        """Build the index of the virtual addresses mapping each physical page, in one or more
+        address spaces. Its `Find(physical_address)` method returns the mappings of a physical
+        address, each with a DirectoryTableBase and a VirtualAddress attribute
+
+        Args:
+            directory_table_bases (Optional[List[int]]): the directory table bases of the
+            address spaces to index; defaults to the one from the dump header
+            number_of_threads (int): number of threads building the index; 0 uses one per
+            hardware thread
+
+        Returns:
+            Optional[ReverseMap_t]: The index, or None if an address space couldn't be walked
+        """
+        return self.__dump.BuildReverseMap(directory_table_bases or [0], number_of_threads)
+
+    def find_directory_table_bases(self, number_of_threads: int = 1) -> List[_DtbCandidate_t]:
+        """Scan the physical memory for pages that look like a PML4: one of their entries
+        points back to themselves and none of them looks wrong. Candidates whose kernel half
+        matches the one of the directory table base from the dump header score higher
+
+        Args:
+            number_of_threads (int): number of threads scanning the physical memory; 0 uses one
+            per hardware thread
+
+        Returns:
+            List[DtbCandidate_t]: The candidates, best score first
+        """
+        return self.__dump.FindDirectoryTableBases(number_of_threads)
+
+    def advise(
+        self, hint: AccessHint, physical_address: Optional[int] = None, size: int = 0
+    ) -> bool:
+        """Tell the operating system how the dump file is about to be accessed: read
+        sequentially, read randomly, needed soon (prefetched) or not needed anymore (released
+        from the page cache)
+
+        Args:
+            hint (AccessHint): how the file is about to be accessed
+            physical_address (Optional[int]): if given, only the pages of the dump backing
+            `size` bytes of physical memory at this address get the hint; otherwise the whole
+            file does
+            size (int): the number of bytes of physical memory
+
+        Returns:
+            bool: True if the hint has been applied, False otherwise
+        """
+        if physical_address is None:
+            return self.__dump.Advise(hint)
+
+        return self.__dump.AdvisePhysicalRange(hint, physical_address, size)
+
+    def advise_physical_pages(self, hint: AccessHint, physical_addresses: List[int]) -> bool:
+        """Apply a hint to the pages of the dump backing a set of physical pages, like the
+        ones about to be loaded in an emulator
+
+        Args:
+            hint (AccessHint): how the pages are about to be accessed
+            physical_addresses (List[int]): the physical addresses of the pages
+
+        Returns:
+            bool: True if the hint has been applied, False otherwise
+        """
+        return self.__dump.AdvisePhysicalPages(hint, physical_addresses)
+
+    def lock_physical_pages(self, physical_addresses: List[int]) -> bool:
+        """Lock in memory the pages of the dump backing a set of physical pages, so that
+        accessing them never faults. The file needs to be mapped
+
+        Args:
+            physical_addresses (List[int]): the physical addresses of the pages
+
+        Returns:
+            bool: True if the pages have been locked, False otherwise
+        """
+        return self.__dump.LockPhysicalPages(physical_addresses)
+
+
+class StreamParser:
+    def __init__(
+        self,
+        stream: Union[BinaryIO, int],
+        max_metadata_size: int = 0x10000000,
+        buffer_size: int = 0x100000,
+    ):
+        """Parse a kernel dump in a single pass, as it is read from a pipe or a socket: the
+        headers and the metadata at the beginning of the dump are parsed right away, and the
+        pages are read by `read_pages`
+
+        Args:
+            stream (BinaryIO|int): a file object, or a file descriptor, the dump is read from
+            max_metadata_size (int): maximum number of bytes of headers and metadata to keep
+            buffer_size (int): size of the buffer the pages are read to
+        """
+        if isinstance(stream, int):
+            fd = stream
+            self.__read = lambda size: os.read(fd, size)
+        elif hasattr(stream, "read"):
+            self.__read = stream.read
+        else:
+            raise TypeError
+
+        options = _StreamOptions_t()
+        options.MaxMetadataSize = max_metadata_size
+        options.BufferSize = buffer_size
+        self.__stream = _StreamParser_t()
+        if not self.__stream.ParseMetadata(self.__read, options):
+            raise RuntimeError("Invalid kernel dump stream")
+
+        dump = self.__stream.GetDumpParser()
+        self.context: __CONTEXT = dump.GetContext()
+        self.directory_table_base: int = dump.GetDirectoryTableBase() & ~0xFFF
+        self.type = DumpType(dump.GetDumpType().value)
+        self.header: __HEADER64 = dump.GetDumpHeader()
+        self.runs: List[_PhysmemRun_t] = self.__stream.GetRuns()
+        return
+
+    def read_pages(self, on_page: Callable[[int, bytes], Optional[bool]]) -> bool:
+        """Read the rest of the dump, and hand every page to `on_page` as it goes by, in the
+        order the pages are stored
+
+        Args:
+            on_page (Callable[[int, bytes], Optional[bool]]): receives the physical address
+            and the content of a page; returning False stops the stream
+
+        Returns:
+            bool: True if every page has been read and handed to `on_page`
+        """
+        return self.__stream.ReadPages(self.__read, on_page)
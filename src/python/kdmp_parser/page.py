@@ -31,13 +31,16 @@ class PageIterator:
         return len(list(self.keys()))
 
     def keys(self) -> Generator[int, None, None]:
-        for page_addr in self.__dump.GetPhysmem():
-            yield page_addr
+        # Walk the pages in the order they are stored in the dump file, so that
+        # whole-dump passes read it sequentially.
+        for span in self.__dump.GetPhysicalSpansInFileOrder():
+            for page_offset in range(0, span.Size, size):
+                yield span.PhysicalAddress + page_offset
 
     def values(self) -> Generator[bytearray, None, None]:
-        for page_addr in self.__dump.GetPhysmem():
+        for page_addr in self.keys():
             yield self[page_addr]
 
     def items(self) -> Generator["tuple[int, bytearray]", None, None]:
-        for page_addr in self.__dump.GetPhysmem():
+        for page_addr in self.keys():
             yield page_addr, self[page_addr]
@@ -8,17 +8,22 @@
 //
 
 #include "kdmp-parser.h"
+#include "streamparser.h"
 
 #include <cstring>
+#include <mutex>
 #include <nanobind/nanobind.h>
 #include <nanobind/stl/array.h>
 #include <nanobind/stl/bind_map.h>
+#include <nanobind/stl/chrono.h>
 #include <nanobind/stl/filesystem.h>
 #include <nanobind/stl/optional.h>
 #include <nanobind/stl/pair.h>
 #include <nanobind/stl/string.h>
 #include <nanobind/stl/unordered_map.h>
 #include <nanobind/stl/variant.h>
+#include <nanobind/stl/vector.h>
+#include <string>
 #include <vector>
 
 namespace nb = nanobind;
@@ -278,6 +283,138 @@ NB_MODULE(_kdmp_parser, m) {
   m.def("PageOffset", &kdmpparser::Page::Offset, "Address"_a,
         "Get the offset to the page for the given address.");
 
+  using Severity_t = kdmpparser::Severity_t;
+  nb::enum_<Severity_t>(m, "Severity_t")
+      .value("Debug", Severity_t::Debug)
+      .value("Info", Severity_t::Info)
+      .value("Warning", Severity_t::Warning)
+      .value("Error", Severity_t::Error)
+      .export_values();
+
+  using DiagnosticCode_t = kdmpparser::DiagnosticCode_t;
+  nb::enum_<DiagnosticCode_t>(m, "DiagnosticCode_t")
+      .value("FileNotFound", DiagnosticCode_t::FileNotFound)
+      .value("OpenFileFailed", DiagnosticCode_t::OpenFileFailed)
+      .value("FileSizeFailed", DiagnosticCode_t::FileSizeFailed)
+      .value("MapViewFailed", DiagnosticCode_t::MapViewFailed)
+      .value("MapFileFailed", DiagnosticCode_t::MapFileFailed)
+      .value("ReadFailed", DiagnosticCode_t::ReadFailed)
+      .value("AdviseFailed", DiagnosticCode_t::AdviseFailed)
+      .value("LockFailed", DiagnosticCode_t::LockFailed)
+      .value("InvalidCompressedFile", DiagnosticCode_t::InvalidCompressedFile)
+      .value("InvalidSignature", DiagnosticCode_t::InvalidSignature)
+      .value("InvalidValidDump", DiagnosticCode_t::InvalidValidDump)
+      .value("InvalidPhysicalMemoryBlock",
+             DiagnosticCode_t::InvalidPhysicalMemoryBlock)
+      .value("InvalidBmpHeader", DiagnosticCode_t::InvalidBmpHeader)
+      .value("InvalidRdmpHeader", DiagnosticCode_t::InvalidRdmpHeader)
+      .value("InvalidContext", DiagnosticCode_t::InvalidContext)
+      .value("UnsupportedDumpType", DiagnosticCode_t::UnsupportedDumpType)
+      .value("UnknownDumpType", DiagnosticCode_t::UnknownDumpType)
+      .value("InvalidHeader", DiagnosticCode_t::InvalidHeader)
+      .value("BuildPhysmemFailed", DiagnosticCode_t::BuildPhysmemFailed)
+      .value("InvalidPml4e", DiagnosticCode_t::InvalidPml4e)
+      .value("InvalidPdpte", DiagnosticCode_t::InvalidPdpte)
+      .value("InvalidPde", DiagnosticCode_t::InvalidPde)
+      .value("InvalidPte", DiagnosticCode_t::InvalidPte)
+      .value("MissingPagingStructure",
+             DiagnosticCode_t::MissingPagingStructure);
+
+  //
+  // The Python callback is leaked on purpose: it can't be released once the
+  // interpreter is gone.
+  //
+  // The library reports from its worker threads while the thread that waits
+  // for them can hold the GIL, so a thread that doesn't hold it can't take
+  // it without risking a deadlock. The diagnostics of those threads are
+  // queued instead, and delivered by the interpreter once it runs Python
+  // code again, or before the next diagnostic of a thread holding the GIL.
+  //
+
+  struct PendingDiagnostic_t {
+    Severity_t Severity;
+    DiagnosticCode_t Code;
+    std::string Message;
+  };
+
+  static nb::object *DiagnosticsCallback = new nb::object();
+  static std::mutex *PendingDiagnosticsLock = new std::mutex();
+  static std::vector<PendingDiagnostic_t> *PendingDiagnostics =
+      new std::vector<PendingDiagnostic_t>();
+
+  static const auto Deliver = [](const Severity_t Severity,
+                                 const DiagnosticCode_t Code,
+                                 const char *Message) {
+    if (DiagnosticsCallback->is_none()) {
+      return;
+    }
+
+    try {
+      (*DiagnosticsCallback)(Severity, Code, Message);
+    } catch (nb::python_error &Error) {
+      Error.discard_as_unraisable("kdmp_parser diagnostics");
+    }
+  };
+
+  static const auto DeliverPending = []() {
+    std::vector<PendingDiagnostic_t> Pending;
+    {
+      std::lock_guard<std::mutex> Lock(*PendingDiagnosticsLock);
+      Pending.swap(*PendingDiagnostics);
+    }
+
+    for (const auto &Diagnostic : Pending) {
+      Deliver(Diagnostic.Severity, Diagnostic.Code,
+              Diagnostic.Message.c_str());
+    }
+  };
+
+  m.def(
+      "SetDiagnosticsCallback",
+      [](const nb::object &Callback, const Severity_t MinimumSeverity) {
+        if (Callback.is_none()) {
+          kdmpparser::Diagnostics::SetCallback(nullptr, MinimumSeverity);
+          std::lock_guard<std::mutex> Lock(*PendingDiagnosticsLock);
+          PendingDiagnostics->clear();
+          *DiagnosticsCallback = nb::none();
+          return;
+        }
+
+        *DiagnosticsCallback = Callback;
+        kdmpparser::Diagnostics::SetCallback(
+            [](const kdmpparser::Diagnostic_t &Diagnostic) {
+              if (PyGILState_Check()) {
+                DeliverPending();
+                Deliver(Diagnostic.Severity, Diagnostic.Code,
+                        Diagnostic.Message);
+                return;
+              }
+
+              {
+                std::lock_guard<std::mutex> Lock(*PendingDiagnosticsLock);
+                PendingDiagnostics->push_back(PendingDiagnostic_t{
+                    Diagnostic.Severity, Diagnostic.Code, Diagnostic.Message});
+              }
+
+              Py_AddPendingCall(
+                  [](void *) {
+                    DeliverPending();
+                    return 0;
+                  },
+                  nullptr);
+            },
+            MinimumSeverity);
+      },
+      "Callback"_a.none(), "MinimumSeverity"_a = Severity_t::Info,
+      "Set the callable receiving the diagnostics as (severity, code, "
+      "message); None silences the library.");
+
+  m.def("CompressFile", &kdmpparser::CompressFile, "InputPath"_a,
+        "OutputPath"_a,
+        "ChunkSize"_a = kdmpparser::CompressedFileHeader_t::DefaultChunkSize,
+        "NumberOfThreads"_a = 0,
+        "Write a compressed copy of a dump, that can be parsed like the dump.");
+
   using BugCheckParameters_t = kdmpparser::BugCheckParameters_t;
   nb::class_<BugCheckParameters_t>(m, "BugCheckParameters_t")
       .def(nb::init<>())
@@ -285,10 +422,117 @@ NB_MODULE(_kdmp_parser, m) {
       .def_ro("BugCheckCodeParameter",
               &BugCheckParameters_t::BugCheckCodeParameter);
 
+  using PhysmemSpan_t = kdmpparser::PhysmemSpan_t;
+  nb::class_<PhysmemSpan_t>(m, "PhysmemSpan_t")
+      .def_ro("PhysicalAddress", &PhysmemSpan_t::PhysicalAddress)
+      .def_ro("Size", &PhysmemSpan_t::Size);
+
+  using PhysmemRun_t = kdmpparser::PhysmemRun_t;
+  nb::class_<PhysmemRun_t>(m, "PhysmemRun_t")
+      .def_ro("Pfn", &PhysmemRun_t::Pfn)
+      .def_ro("PageCount", &PhysmemRun_t::PageCount)
+      .def_ro("FileOffset", &PhysmemRun_t::FileOffset);
+
+  using VirtualRange_t = kdmpparser::VirtualRange_t;
+  nb::class_<VirtualRange_t>(m, "VirtualRange_t")
+      .def_ro("VirtualAddress", &VirtualRange_t::VirtualAddress)
+      .def_ro("PhysicalAddress", &VirtualRange_t::PhysicalAddress)
+      .def_ro("Size", &VirtualRange_t::Size)
+      .def_ro("Write", &VirtualRange_t::Write)
+      .def_ro("UserAccessible", &VirtualRange_t::UserAccessible)
+      .def_ro("NoExecute", &VirtualRange_t::NoExecute);
+
+  using DtbCandidate_t = kdmpparser::DtbCandidate_t;
+  nb::class_<DtbCandidate_t>(m, "DtbCandidate_t")
+      .def_ro("DirectoryTableBase", &DtbCandidate_t::DirectoryTableBase)
+      .def_ro("SelfReferenceIndex", &DtbCandidate_t::SelfReferenceIndex)
+      .def_ro("NumberOfPresentEntries",
+              &DtbCandidate_t::NumberOfPresentEntries)
+      .def_ro("NumberOfKernelMatches", &DtbCandidate_t::NumberOfKernelMatches)
+      .def_ro("Score", &DtbCandidate_t::Score);
+
+  using ReverseMapping_t = kdmpparser::ReverseMapping_t;
+  nb::class_<ReverseMapping_t>(m, "ReverseMapping_t")
+      .def_ro("DirectoryTableBase", &ReverseMapping_t::DirectoryTableBase)
+      .def_ro("VirtualAddress", &ReverseMapping_t::VirtualAddress);
+
+  using ReverseMap_t = kdmpparser::ReverseMap_t;
+  nb::class_<ReverseMap_t>(m, "ReverseMap_t")
+      .def(nb::init<>())
+      .def("Find", &ReverseMap_t::Find, "PhysicalAddress"_a)
+      .def("DirectoryTableBases", &ReverseMap_t::DirectoryTableBases)
+      .def("__len__", &ReverseMap_t::size);
+
+  using FileBackendType_t = kdmpparser::FileBackendType_t;
+  nb::enum_<FileBackendType_t>(m, "FileBackendType_t")
+      .value("Map", FileBackendType_t::Map)
+      .value("Pread", FileBackendType_t::Pread)
+      .export_values();
+
+  using AccessHint_t = kdmpparser::AccessHint_t;
+  nb::enum_<AccessHint_t>(m, "AccessHint_t")
+      .value("Normal", AccessHint_t::Normal)
+      .value("Sequential", AccessHint_t::Sequential)
+      .value("Random", AccessHint_t::Random)
+      .value("WillNeed", AccessHint_t::WillNeed)
+      .value("DontNeed", AccessHint_t::DontNeed)
+      .export_values();
+
+  using MapReport_t = kdmpparser::MapReport_t;
+  nb::class_<MapReport_t>(m, "MapReport_t")
+      .def_ro("MapTime", &MapReport_t::MapTime)
+      .def_ro("Populated", &MapReport_t::Populated)
+      .def_ro("PopulateTime", &MapReport_t::PopulateTime)
+      .def_ro("Locked", &MapReport_t::Locked)
+      .def_ro("LockTime", &MapReport_t::LockTime)
+      .def_ro("HugePages", &MapReport_t::HugePages)
+      .def_ro("HugePagesTime", &MapReport_t::HugePagesTime);
+
+  using AsyncReadOptions_t = kdmpparser::AsyncReadOptions_t;
+  nb::class_<AsyncReadOptions_t>(m, "AsyncReadOptions_t")
+      .def(nb::init<>())
+      .def_rw("QueueDepth", &AsyncReadOptions_t::QueueDepth)
+      .def_rw("MaxReadSize", &AsyncReadOptions_t::MaxReadSize)
+      .def_rw("UseIoUring", &AsyncReadOptions_t::UseIoUring)
+      .def_rw("NumberOfThreads", &AsyncReadOptions_t::NumberOfThreads);
+
+  using ParseOptions_t = kdmpparser::ParseOptions_t;
+  nb::class_<ParseOptions_t>(m, "ParseOptions_t")
+      .def(nb::init<>())
+      .def_rw("NumberOfThreads", &ParseOptions_t::NumberOfThreads)
+      .def_rw("UseIndexFile", &ParseOptions_t::UseIndexFile)
+      .def_rw("LazyPhysmem", &ParseOptions_t::LazyPhysmem)
+      .def_rw("BuildPhysmemInBackground",
+              &ParseOptions_t::BuildPhysmemInBackground)
+      .def_rw("TlbCapacity", &ParseOptions_t::TlbCapacity)
+      .def_rw("PagingStructureCacheCapacity",
+              &ParseOptions_t::PagingStructureCacheCapacity)
+      .def_rw("FileBackend", &ParseOptions_t::FileBackend)
+      .def_rw("BlockSize", &ParseOptions_t::BlockSize)
+      .def_rw("BlockCacheSize", &ParseOptions_t::BlockCacheSize)
+      .def_rw("AccessHint", &ParseOptions_t::AccessHint)
+      .def_rw("AdviseScans", &ParseOptions_t::AdviseScans)
+      .def_rw("Populate", &ParseOptions_t::Populate)
+      .def_rw("LockView", &ParseOptions_t::LockView)
+      .def_rw("HugePages", &ParseOptions_t::HugePages);
+
   using KernelDumpParser = kdmpparser::KernelDumpParser;
   nb::class_<KernelDumpParser>(m, "KernelDumpParser")
       .def(nb::init<>())
-      .def("Parse", &KernelDumpParser::Parse, "PathFile"_a)
+      .def("Parse",
+           nb::overload_cast<const char *, const ParseOptions_t &>(
+               &KernelDumpParser::Parse),
+           "PathFile"_a, "Options"_a = ParseOptions_t())
+      .def(
+          "Parse",
+          [](KernelDumpParser &Parser, const nb::bytes &Buffer,
+             const ParseOptions_t &Options) {
+            return Parser.Parse(Buffer.c_str(), Buffer.size(), Options);
+          },
+          "Buffer"_a, "Options"_a = ParseOptions_t(), nb::keep_alive<1, 2>())
+      .def("ParseDescriptor", &KernelDumpParser::ParseDescriptor, "Fd"_a,
+           "Options"_a = ParseOptions_t())
+      .def("EnsurePhysmem", &KernelDumpParser::EnsurePhysmem)
       .def("GetContext", &KernelDumpParser::GetContext)
       .def("GetDumpHeader", &KernelDumpParser::GetDumpHeader,
            nb::rv_policy::reference)
@@ -301,6 +545,14 @@ NB_MODULE(_kdmp_parser, m) {
                                           "it", PhysMem.cbegin(),
                                           PhysMem.cend());
            })
+      .def("GetPhysicalSpansInFileOrder",
+           [](const KernelDumpParser &Parser) {
+             const auto &Spans = Parser.GetPhysicalSpansInFileOrder();
+             return nb::make_iterator(nb::type<PhysmemSpan_t>(), "it",
+                                      Spans.begin(), Spans.end());
+           })
+      .def("GetPhysicalPageFileOffset",
+           &KernelDumpParser::GetPhysicalPageFileOffset, "PhysicalAddress"_a)
       .def("ShowExceptionRecord", &KernelDumpParser::ShowExceptionRecord,
            "Prefix"_a = 0)
       .def("ShowContextRecord", &KernelDumpParser::ShowContextRecord,
@@ -321,9 +573,118 @@ NB_MODULE(_kdmp_parser, m) {
             return Out;
           },
           "PhysicalAddress"_a)
+      .def(
+          "ReadPhysicalMemory",
+          [](const KernelDumpParser &Parser, const uint64_t PhysicalAddress,
+             const size_t Size, const std::optional<uint8_t> FillByte) {
+            std::vector<uint8_t> Out(Size);
+            kdmpparser::MissingPageCallback_t OnMissingPage;
+            if (FillByte) {
+              OnMissingPage = [&](const uint64_t, uint8_t *Out,
+                                  const uint64_t Size) {
+                memset(Out, *FillByte, size_t(Size));
+                return true;
+              };
+            }
+
+            const size_t BytesRead = Parser.ReadPhysicalMemoryPartial(
+                PhysicalAddress, Out.data(), Size, OnMissingPage);
+            return nb::bytes((const char *)Out.data(), BytesRead);
+          },
+          "PhysicalAddress"_a, "Size"_a, "FillByte"_a = nb::none())
       .def("GetDirectoryTableBase", &KernelDumpParser::GetDirectoryTableBase)
+      .def(
+          "ReadVirtualMemory",
+          [](const KernelDumpParser &Parser, const uint64_t VirtualAddress,
+             const size_t Size, const uint64_t DirectoryTableBase) {
+            std::vector<uint8_t> Out(Size);
+            const size_t BytesRead = Parser.ReadVirtualMemoryPartial(
+                VirtualAddress, Out.data(), Size, DirectoryTableBase);
+            return nb::bytes((const char *)Out.data(), BytesRead);
+          },
+          "VirtualAddress"_a, "Size"_a, "DirectoryTableBase"_a = 0)
       .def("VirtTranslate", &KernelDumpParser::VirtTranslate,
            "VirtualAddress"_a, "DirectoryTableBase"_a)
+      .def(
+          "VirtTranslateBatch",
+          [](const KernelDumpParser &Parser,
+             const std::vector<uint64_t> &VirtualAddresses,
+             const uint64_t DirectoryTableBase) {
+            return Parser.VirtTranslateBatch(VirtualAddresses,
+                                             DirectoryTableBase);
+          },
+          "VirtualAddresses"_a, "DirectoryTableBase"_a = 0)
+      .def(
+          "EnumerateAddressSpace",
+          [](const KernelDumpParser &Parser, const uint64_t DirectoryTableBase,
+             const uint32_t NumberOfThreads) {
+            std::vector<VirtualRange_t> Ranges;
+            Parser.EnumerateAddressSpace(
+                DirectoryTableBase,
+                [&](const VirtualRange_t &Range) { Ranges.push_back(Range); },
+                NumberOfThreads);
+            return Ranges;
+          },
+          "DirectoryTableBase"_a = 0, "NumberOfThreads"_a = 1)
+      .def(
+          "BuildReverseMap",
+          [](const KernelDumpParser &Parser,
+             const std::vector<uint64_t> &DirectoryTableBases,
+             const uint32_t NumberOfThreads) -> std::optional<ReverseMap_t> {
+            ReverseMap_t ReverseMap;
+            if (!Parser.BuildReverseMap(DirectoryTableBases, ReverseMap,
+                                        NumberOfThreads)) {
+              return std::nullopt;
+            }
+
+            return ReverseMap;
+          },
+          "DirectoryTableBases"_a, "NumberOfThreads"_a = 1)
+      .def("FindDirectoryTableBases",
+           &KernelDumpParser::FindDirectoryTableBases,
+           "NumberOfThreads"_a = 1)
+      .def("Advise", &KernelDumpParser::Advise, "Hint"_a)
+      .def("AdvisePhysicalRange", &KernelDumpParser::AdvisePhysicalRange,
+           "Hint"_a, "PhysicalAddress"_a, "Size"_a)
+      .def("AdvisePhysicalPages", &KernelDumpParser::AdvisePhysicalPages,
+           "Hint"_a, "PhysicalAddresses"_a)
+      .def("LockPhysicalPages", &KernelDumpParser::LockPhysicalPages,
+           "PhysicalAddresses"_a)
+      .def(
+          "ReadPhysicalPagesAsync",
+          [](const KernelDumpParser &Parser,
+             const std::vector<uint64_t> &PhysicalAddresses,
+             const AsyncReadOptions_t &Options) {
+            //
+            // The pages are collected instead of being handed to a Python
+            // callback: the threads reading them can't take the GIL while
+            // this thread holds it.
+            //
+
+            std::vector<
+                std::pair<uint64_t, std::optional<kdmpparser::Page_t>>>
+                Pages;
+            Parser.ReadPhysicalPagesAsync(
+                PhysicalAddresses,
+                [&](const uint64_t PhysicalAddress, const uint8_t *Page) {
+                  if (!Page) {
+                    Pages.emplace_back(PhysicalAddress, std::nullopt);
+                    return;
+                  }
+
+                  kdmpparser::Page_t Out;
+                  memcpy(Out.data(), Page, kdmpparser::Page::Size);
+                  Pages.emplace_back(PhysicalAddress, Out);
+                },
+                Options);
+            return Pages;
+          },
+          "PhysicalAddresses"_a, "Options"_a = AsyncReadOptions_t())
+      .def("GetMapReport", &KernelDumpParser::GetMapReport,
+           nb::rv_policy::copy)
+      .def("IsCompressed", &KernelDumpParser::IsCompressed)
+      .def("InvalidateTlb", &KernelDumpParser::InvalidateTlb,
+           "DirectoryTableBase"_a = nb::none())
       .def(
           "GetVirtualPage",
           [](const KernelDumpParser &Parser, const uint64_t VirtualAddress,
@@ -340,4 +701,56 @@ NB_MODULE(_kdmp_parser, m) {
             return Out;
           },
           "VirtualAddress"_a, "DirectoryTableBase"_a = 0);
+
+  using StreamOptions_t = kdmpparser::StreamOptions_t;
+  nb::class_<StreamOptions_t>(m, "StreamOptions_t")
+      .def(nb::init<>())
+      .def_rw("MaxMetadataSize", &StreamOptions_t::MaxMetadataSize)
+      .def_rw("BufferSize", &StreamOptions_t::BufferSize);
+
+  //
+  // The stream is a callable like the `read` method of a file, returning
+  // bytes; the pages are handed to a callable receiving (address, bytes),
+  // which stops the stream by returning False.
+  //
+
+  const auto &Reader = [](const nb::callable &Read) {
+    return [Read](void *Out, const uint64_t Size) -> uint64_t {
+      const auto &Chunk = nb::cast<nb::bytes>(Read(Size));
+      const uint64_t ChunkSize = std::min(uint64_t(Chunk.size()), Size);
+      memcpy(Out, Chunk.c_str(), size_t(ChunkSize));
+      return ChunkSize;
+    };
+  };
+
+  const auto &PageHandler = [](const nb::callable &OnPage) {
+    return [OnPage](const uint64_t PhysicalAddress, const uint8_t *Page) {
+      const auto &Continue =
+          OnPage(PhysicalAddress,
+                 nb::bytes((const char *)Page, kdmpparser::Page::Size));
+      return Continue.is_none() || nb::cast<bool>(Continue);
+    };
+  };
+
+  using StreamParser_t = kdmpparser::StreamParser_t;
+  nb::class_<StreamParser_t>(m, "StreamParser_t")
+      .def(nb::init<>())
+      .def(
+          "ParseMetadata",
+          [=](StreamParser_t &Stream, const nb::callable &Read,
+              const StreamOptions_t &Options) {
+            return Stream.ParseMetadata(Reader(Read), Options);
+          },
+          "Read"_a, "Options"_a = StreamOptions_t())
+      .def(
+          "ReadPages",
+          [=](StreamParser_t &Stream, const nb::callable &Read,
+              const nb::callable &OnPage) {
+            return Stream.ReadPages(Reader(Read), PageHandler(OnPage));
+          },
+          "Read"_a, "OnPage"_a)
+      .def("GetDumpParser", &StreamParser_t::GetDumpParser,
+           nb::rv_policy::reference_internal)
+      .def("GetRuns", &StreamParser_t::GetRuns)
+      .def("GetPosition", &StreamParser_t::GetPosition);
 }
@@ -2,11 +2,19 @@
 #define CATCH_CONFIG_MAIN
 
 #include "kdmp-parser.h"
+#include "streamparser.h"
+#include <algorithm>
 #include <array>
 #include <catch2/catch_test_macros.hpp>
 #include <cstdint>
 #include <cstring>
+#include <fcntl.h>
 #include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <thread>
 #include <unordered_map>
 
 struct TestCaseValues {
@@ -201,6 +209,85 @@ constexpr TestCaseValues TestLiveKernelBitmapDump{
     0x1ULL,
 };
 
+//
+// Walk the physical memory of a dump page by page, the way the parser used to
+// before indexing runs; this is used as a reference.
+//
+
+std::map<uint64_t, const uint8_t *>
+WalkPhysmem(const kdmpparser::HEADER64 &Hdr) {
+  std::map<uint64_t, const uint8_t *> Physmem;
+  const uint8_t *Base = (const uint8_t *)&Hdr;
+  switch (Hdr.DumpType) {
+  case kdmpparser::DumpType_t::FullDump: {
+    const uint8_t *Page = (const uint8_t *)&Hdr.u3.BmpHeader;
+    const auto &Desc = Hdr.u1.PhysicalMemoryBlock;
+    for (uint32_t RunIdx = 0; RunIdx < Desc.NumberOfRuns; RunIdx++) {
+      const auto &Run = Desc.Run[RunIdx];
+      for (uint64_t PageIdx = 0; PageIdx < Run.PageCount; PageIdx++) {
+        const uint64_t Pa = (Run.BasePage + PageIdx) * kdmpparser::Page::Size;
+        Physmem.try_emplace(Pa, Page);
+        Page += kdmpparser::Page::Size;
+      }
+    }
+    break;
+  }
+
+  case kdmpparser::DumpType_t::LiveKernelBitmapDump:
+  case kdmpparser::DumpType_t::BMPDump: {
+    const uint8_t *Page = Base + Hdr.u3.BmpHeader.FirstPage;
+    const uint8_t *Bitmap = Hdr.u3.BmpHeader.Bitmap.data();
+    for (uint64_t Pfn = 0; Pfn < (Hdr.u3.BmpHeader.Pages / 8) * 8; Pfn++) {
+      if ((Bitmap[Pfn / 8] >> (Pfn % 8)) & 1) {
+        Physmem.try_emplace(Pfn * kdmpparser::Page::Size, Page);
+        Page += kdmpparser::Page::Size;
+      }
+    }
+    break;
+  }
+
+  case kdmpparser::DumpType_t::KernelMemoryDump:
+  case kdmpparser::DumpType_t::KernelAndUserMemoryDump:
+  case kdmpparser::DumpType_t::CompleteMemoryDump: {
+    const bool Complete =
+        Hdr.DumpType == kdmpparser::DumpType_t::CompleteMemoryDump;
+    const auto &RdmpHdr =
+        Complete ? Hdr.u3.FullRdmpHeader.Hdr : Hdr.u3.RdmpHeader.Hdr;
+    const uint8_t *Metadata = Complete ? Hdr.u3.FullRdmpHeader.Bitmap.data()
+                                       : Hdr.u3.RdmpHeader.Bitmap.data();
+    const uint8_t *Page = Base + RdmpHdr.FirstPageOffset;
+    uint64_t CurrentPageCount = 0;
+    for (uint64_t Offset = 0; Offset < RdmpHdr.MetadataSize; Offset += 16) {
+      if (Complete &&
+          CurrentPageCount == Hdr.u3.FullRdmpHeader.TotalNumberOfPages) {
+        break;
+      }
+
+      uint64_t Pfn = 0;
+      uint64_t NumberOfPages = 0;
+      memcpy(&Pfn, Metadata + Offset, sizeof(Pfn));
+      memcpy(&NumberOfPages, Metadata + Offset + 8, sizeof(NumberOfPages));
+      CurrentPageCount += NumberOfPages;
+      if (!Pfn) {
+        break;
+      }
+
+      for (uint64_t PageIdx = 0; PageIdx < NumberOfPages; PageIdx++) {
+        Physmem.try_emplace((Pfn + PageIdx) * kdmpparser::Page::Size, Page);
+        Page += kdmpparser::Page::Size;
+      }
+    }
+    break;
+  }
+
+  default: {
+    break;
+  }
+  }
+
+  return Physmem;
+}
+
 constexpr std::array Testcases{
     TestCaseBmp,          TestCaseFull,
     TestCaseKernelDump,   TestCaseKernelUserDump,
@@ -224,6 +311,1211 @@ TEST_CASE("kdmp-parser", "parser") {
     }
   }
 
+  SECTION("Physmem index") {
+    for (const auto &Testcase : Testcases) {
+      kdmpparser::KernelDumpParser Dmp;
+      REQUIRE(Dmp.Parse(Testcase.File.data()));
+      const auto &Physmem = Dmp.GetPhysmem();
+      uint64_t NumberOfPages = 0;
+      uint64_t LastAddress = 0;
+      for (const auto &[PhysicalAddress, Page] : Physmem) {
+        if (NumberOfPages > 0) {
+          CHECK(PhysicalAddress > LastAddress);
+        }
+
+        CHECK(Dmp.GetPhysicalPage(PhysicalAddress) == Page);
+        LastAddress = PhysicalAddress;
+        NumberOfPages++;
+      }
+
+      CHECK(NumberOfPages == Testcase.Size);
+    }
+  }
+
+  SECTION("Physmem matches a page by page walk") {
+    for (const auto &Testcase : Testcases) {
+      kdmpparser::KernelDumpParser Dmp;
+      REQUIRE(Dmp.Parse(Testcase.File.data()));
+      const auto &Expected = WalkPhysmem(Dmp.GetDumpHeader());
+      const auto &Physmem = Dmp.GetPhysmem();
+      REQUIRE(Physmem.size() == Expected.size());
+      auto ExpectedIt = Expected.cbegin();
+      for (const auto &[PhysicalAddress, Page] : Physmem) {
+        REQUIRE(ExpectedIt != Expected.cend());
+        CHECK(PhysicalAddress == ExpectedIt->first);
+        CHECK(Page == ExpectedIt->second);
+        ExpectedIt++;
+      }
+
+      CHECK(ExpectedIt == Expected.cend());
+    }
+  }
+
+  SECTION("Physmem built by several threads") {
+    for (const auto &Testcase : Testcases) {
+      kdmpparser::KernelDumpParser Dmp;
+      REQUIRE(Dmp.Parse(Testcase.File.data()));
+      for (const uint32_t NumberOfThreads : {0u, 4u}) {
+        kdmpparser::ParseOptions_t Options;
+        Options.NumberOfThreads = NumberOfThreads;
+        kdmpparser::KernelDumpParser ParallelDmp;
+        REQUIRE(ParallelDmp.Parse(Testcase.File.data(), Options));
+        const auto &Physmem = ParallelDmp.GetPhysmem();
+        REQUIRE(Physmem.size() == Dmp.GetPhysmem().size());
+        auto ExpectedIt = Dmp.GetPhysmem().cbegin();
+        for (const auto &[PhysicalAddress, Page] : Physmem) {
+          CHECK(PhysicalAddress == ExpectedIt->first);
+          CHECK(memcmp(Page, ExpectedIt->second, kdmpparser::Page::Size) == 0);
+          ExpectedIt++;
+        }
+      }
+    }
+
+    //
+    // The test dumps have too few ranges to be split in chunks, so build
+    // dumps with more than 4096 of them out of the headers of the kernel and
+    // complete dumps. Ranges without pages are sprinkled in, and the complete
+    // dump stops in the middle of its second chunk.
+    //
+
+    for (const auto &Testcase : {TestCaseKernelDump, TestCaseCompleteDump}) {
+      const bool Complete =
+          Testcase.Type == kdmpparser::DumpType_t::CompleteMemoryDump;
+      std::ifstream File(std::filesystem::path(Testcase.File),
+                         std::ios::binary);
+      std::vector<uint8_t> Dump(std::istreambuf_iterator<char>(File), {});
+      REQUIRE(Dump.size() >= sizeof(kdmpparser::HEADER64));
+
+      //
+      // The metadata ends 16 bytes into the first page, which LooksGood
+      // expects; those bytes are a null entry that ends the ranges.
+      //
+
+      const uint64_t NumberOfEntries = 10'238;
+      const uint64_t MetadataOffset = 0x20'30;
+      const uint64_t MetadataSize = NumberOfEntries * 16;
+      const uint64_t FirstPageOffset = MetadataSize + 0x20'20;
+      REQUIRE(kdmpparser::Page::Offset(FirstPageOffset) == 0);
+
+      Dump.resize(size_t(FirstPageOffset));
+      uint64_t NumberOfPages = 0, TotalNumberOfPages = 0;
+      for (uint64_t EntryIdx = 0; EntryIdx < (NumberOfEntries - 1);
+           EntryIdx++) {
+        const uint64_t Entry[2] = {(EntryIdx * 2) + 1, (EntryIdx % 4) == 0};
+        memcpy(Dump.data() + MetadataOffset + (EntryIdx * 16), Entry,
+               sizeof(Entry));
+        NumberOfPages += Entry[1];
+        if (EntryIdx == 6'000) {
+          TotalNumberOfPages = NumberOfPages;
+        }
+      }
+
+      for (uint64_t PageIdx = 0; PageIdx < NumberOfPages; PageIdx++) {
+        Dump.resize(Dump.size() + kdmpparser::Page::Size,
+                    uint8_t(PageIdx + 1));
+      }
+
+      memset(Dump.data() + FirstPageOffset, 0, 16);
+      auto &Hdr = *(kdmpparser::HEADER64 *)Dump.data();
+      auto &RdmpHdr =
+          Complete ? Hdr.u3.FullRdmpHeader.Hdr : Hdr.u3.RdmpHeader.Hdr;
+      RdmpHdr.MetadataSize = MetadataSize;
+      RdmpHdr.FirstPageOffset = FirstPageOffset;
+      if (Complete) {
+        Hdr.u3.FullRdmpHeader.TotalNumberOfPages = TotalNumberOfPages;
+      }
+
+      const auto &Expected = WalkPhysmem(Hdr);
+      REQUIRE(Expected.size() ==
+              (Complete ? TotalNumberOfPages : NumberOfPages));
+      for (const uint32_t NumberOfThreads : {1u, 4u}) {
+        kdmpparser::ParseOptions_t Options;
+        Options.NumberOfThreads = NumberOfThreads;
+        kdmpparser::KernelDumpParser ParallelDmp;
+        REQUIRE(ParallelDmp.Parse(Dump.data(), Dump.size(), Options));
+        const auto &Physmem = ParallelDmp.GetPhysmem();
+        REQUIRE(Physmem.size() == Expected.size());
+        auto ExpectedIt = Expected.cbegin();
+        for (const auto &[PhysicalAddress, Page] : Physmem) {
+          kdmpparser::Page_t Buffer;
+          const uint8_t *ParallelPage =
+              ParallelDmp.GetPhysicalPage(PhysicalAddress, Buffer);
+          REQUIRE(ParallelPage != nullptr);
+          CHECK(PhysicalAddress == ExpectedIt->first);
+          CHECK(memcmp(ParallelPage, ExpectedIt->second,
+                       kdmpparser::Page::Size) == 0);
+          ExpectedIt++;
+        }
+      }
+    }
+  }
+
+  SECTION("Physmem loaded from an index file") {
+    for (const auto &Testcase : Testcases) {
+      kdmpparser::KernelDumpParser Dmp;
+      REQUIRE(Dmp.Parse(Testcase.File.data()));
+      const auto &IndexFilePath =
+          kdmpparser::IndexFile_t::PathFor(Testcase.File.data());
+      std::filesystem::remove(IndexFilePath);
+
+      //
+      // Bitmap dumps don't get an index file, but they still parse fine.
+      //
+
+      const bool HasIndexFile =
+          Dmp.GetDumpType() != kdmpparser::DumpType_t::BMPDump &&
+          Dmp.GetDumpType() != kdmpparser::DumpType_t::LiveKernelBitmapDump;
+      kdmpparser::ParseOptions_t Options;
+      Options.UseIndexFile = true;
+      kdmpparser::KernelDumpParser WriterDmp;
+      REQUIRE(WriterDmp.Parse(Testcase.File.data(), Options));
+      REQUIRE(std::filesystem::exists(IndexFilePath) == HasIndexFile);
+
+      kdmpparser::KernelDumpParser ReaderDmp;
+      REQUIRE(ReaderDmp.Parse(Testcase.File.data(), Options));
+      const auto &Physmem = ReaderDmp.GetPhysmem();
+      REQUIRE(Physmem.size() == Dmp.GetPhysmem().size());
+      auto ExpectedIt = Dmp.GetPhysmem().cbegin();
+      for (const auto &[PhysicalAddress, Page] : Physmem) {
+        CHECK(PhysicalAddress == ExpectedIt->first);
+        CHECK(memcmp(Page, ExpectedIt->second, kdmpparser::Page::Size) == 0);
+        ExpectedIt++;
+      }
+
+      std::filesystem::remove(IndexFilePath);
+    }
+  }
+
+  SECTION("Corrupted index file") {
+    for (const auto &Testcase : Testcases) {
+      kdmpparser::KernelDumpParser Dmp;
+      REQUIRE(Dmp.Parse(Testcase.File.data()));
+      if (Dmp.GetDumpType() == kdmpparser::DumpType_t::BMPDump ||
+          Dmp.GetDumpType() == kdmpparser::DumpType_t::LiveKernelBitmapDump) {
+        continue;
+      }
+
+      const auto &IndexFilePath =
+          kdmpparser::IndexFile_t::PathFor(Testcase.File.data());
+      std::filesystem::remove(IndexFilePath);
+
+      kdmpparser::ParseOptions_t Options;
+      Options.UseIndexFile = true;
+      kdmpparser::KernelDumpParser WriterDmp;
+      REQUIRE(WriterDmp.Parse(Testcase.File.data(), Options));
+
+      const auto &ReadIndexFile = [&]() {
+        std::ifstream File(IndexFilePath, std::ios::binary);
+        return std::vector<uint8_t>(std::istreambuf_iterator<char>(File), {});
+      };
+
+      const std::vector<uint8_t> IndexFile = ReadIndexFile();
+      REQUIRE(IndexFile.size() >= sizeof(kdmpparser::IndexFileHeader_t));
+      kdmpparser::IndexFileHeader_t Header;
+      memcpy(&Header, IndexFile.data(), sizeof(Header));
+
+      //
+      // Every corruption keeps the key of the dump, so only the content of
+      // the index file can tell that it is wrong.
+      //
+
+      REQUIRE(Header.NumberOfRuns > 1);
+      const auto &CorruptRun =
+          [&](std::vector<uint8_t> &File, const size_t RunIdx,
+              const std::function<void(kdmpparser::PhysmemRun_t &)> &Modify) {
+            const size_t Offset =
+                sizeof(Header) + RunIdx * sizeof(kdmpparser::PhysmemRun_t);
+            kdmpparser::PhysmemRun_t Run;
+            memcpy(&Run, File.data() + Offset, sizeof(Run));
+            Modify(Run);
+            memcpy(File.data() + Offset, &Run, sizeof(Run));
+          };
+
+      const std::vector<std::function<void(std::vector<uint8_t> &)>>
+          Corruptions = {
+              [&](std::vector<uint8_t> &File) {
+                auto Corrupted = Header;
+                Corrupted.NumberOfPages++;
+                memcpy(File.data(), &Corrupted, sizeof(Corrupted));
+              },
+              [&](std::vector<uint8_t> &File) {
+                auto Corrupted = Header;
+                Corrupted.NumberOfRuns++;
+                memcpy(File.data(), &Corrupted, sizeof(Corrupted));
+              },
+              [&](std::vector<uint8_t> &File) {
+                CorruptRun(File, 0, [&](kdmpparser::PhysmemRun_t &Run) {
+                  Run.FileOffset = Header.Key.DumpSize;
+                });
+              },
+              [&](std::vector<uint8_t> &File) {
+                CorruptRun(File, 0, [](kdmpparser::PhysmemRun_t &Run) {
+                  Run.PageCount = 0;
+                });
+              },
+              [&](std::vector<uint8_t> &File) {
+                CorruptRun(File, 1, [](kdmpparser::PhysmemRun_t &Run) {
+                  Run.Pfn = 0;
+                  Run.PageCount = ~0ULL;
+                });
+              },
+          };
+
+      for (const auto &Corrupt : Corruptions) {
+        std::vector<uint8_t> Corrupted = IndexFile;
+        Corrupt(Corrupted);
+        {
+          std::ofstream File(IndexFilePath, std::ios::binary);
+          File.write((const char *)Corrupted.data(),
+                     std::streamsize(Corrupted.size()));
+        }
+
+        //
+        // The index file is rejected, so the index is built and written
+        // again.
+        //
+
+        kdmpparser::KernelDumpParser ReaderDmp;
+        REQUIRE(ReaderDmp.Parse(Testcase.File.data(), Options));
+        const auto &Physmem = ReaderDmp.GetPhysmem();
+        REQUIRE(Physmem.size() == Dmp.GetPhysmem().size());
+        auto ExpectedIt = Dmp.GetPhysmem().cbegin();
+        for (const auto &[PhysicalAddress, Page] : Physmem) {
+          CHECK(PhysicalAddress == ExpectedIt->first);
+          CHECK(memcmp(Page, ExpectedIt->second, kdmpparser::Page::Size) ==
+                0);
+          ExpectedIt++;
+        }
+
+        CHECK(ReadIndexFile() == IndexFile);
+      }
+
+      std::filesystem::remove(IndexFilePath);
+    }
+  }
+
+  SECTION("Physmem built lazily") {
+    for (const auto &Testcase : Testcases) {
+      kdmpparser::KernelDumpParser Dmp;
+      REQUIRE(Dmp.Parse(Testcase.File.data()));
+      for (const bool InBackground : {false, true}) {
+        kdmpparser::ParseOptions_t Options;
+        Options.LazyPhysmem = true;
+        Options.BuildPhysmemInBackground = InBackground;
+        kdmpparser::KernelDumpParser LazyDmp;
+        REQUIRE(LazyDmp.Parse(Testcase.File.data(), Options));
+        CHECK(LazyDmp.GetContext().Rip == Testcase.Rip);
+
+        const uint64_t PhysicalAddress =
+            Dmp.GetPhysmem().cbegin()->first;
+        const uint8_t *Page = LazyDmp.GetPhysicalPage(PhysicalAddress);
+        REQUIRE(Page != nullptr);
+        CHECK(memcmp(Page, Dmp.GetPhysicalPage(PhysicalAddress),
+                     kdmpparser::Page::Size) == 0);
+        CHECK(LazyDmp.EnsurePhysmem());
+        CHECK(LazyDmp.GetPhysmem().size() == Dmp.GetPhysmem().size());
+      }
+    }
+  }
+
+  SECTION("Read physical memory") {
+    for (const auto &Testcase : Testcases) {
+      kdmpparser::KernelDumpParser Dmp;
+      REQUIRE(Dmp.Parse(Testcase.File.data()));
+      const auto &Physmem = Dmp.GetPhysmem();
+
+      //
+      // Read across the first two pages of every run; the pages can come
+      // from different places in the file.
+      //
+
+      std::array<uint8_t, kdmpparser::Page::Size> Buffer;
+      const uint64_t Offset = kdmpparser::Page::Size / 2;
+      for (auto It = Physmem.cbegin(); It != Physmem.cend(); It++) {
+        const uint64_t PhysicalAddress = It->first + Offset;
+        const uint8_t *NextPage =
+            Dmp.GetPhysicalPage(It->first + kdmpparser::Page::Size);
+        const size_t BytesRead = Dmp.ReadPhysicalMemoryPartial(
+            PhysicalAddress, Buffer.data(), Buffer.size());
+        CHECK(memcmp(Buffer.data(), It->second + Offset, Offset) == 0);
+        if (!NextPage) {
+          CHECK(BytesRead == Offset);
+          CHECK(!Dmp.ReadPhysicalMemory(PhysicalAddress, Buffer.data(),
+                                        Buffer.size()));
+          REQUIRE(Dmp.ReadPhysicalMemory(PhysicalAddress, Buffer.data(),
+                                         Buffer.size(),
+                                         kdmpparser::ZeroMissingPages));
+          CHECK(Buffer[Offset] == 0);
+          continue;
+        }
+
+        CHECK(BytesRead == Buffer.size());
+        CHECK(memcmp(Buffer.data() + Offset, NextPage, Offset) == 0);
+      }
+    }
+  }
+
+  SECTION("Physical spans") {
+    for (const auto &Testcase : Testcases) {
+      kdmpparser::KernelDumpParser Dmp;
+      REQUIRE(Dmp.Parse(Testcase.File.data()));
+      const auto &Physmem = Dmp.GetPhysmem();
+
+      //
+      // The spans covering the whole physical address space describe every
+      // page, in order.
+      //
+
+      auto It = Physmem.cbegin();
+      uint64_t NumberOfPages = 0;
+      for (const auto &Span : Dmp.GetPhysicalSpans(0, ~0ULL)) {
+        REQUIRE(Span.Size % kdmpparser::Page::Size == 0);
+        for (uint64_t Offset = 0; Offset < Span.Size;
+             Offset += kdmpparser::Page::Size) {
+          REQUIRE(It != Physmem.cend());
+          CHECK(It->first == Span.PhysicalAddress + Offset);
+          CHECK(It->second == Span.Data + Offset);
+          It++;
+          NumberOfPages++;
+        }
+      }
+
+      CHECK(It == Physmem.cend());
+      CHECK(NumberOfPages == Physmem.size());
+
+      //
+      // Unaligned spans are clipped to the range.
+      //
+
+      const uint64_t PhysicalAddress = Physmem.cbegin()->first + 0x10;
+      const auto &Span = Dmp.GetPhysicalSpan(PhysicalAddress);
+      REQUIRE(Span.has_value());
+      CHECK(Span->Data == Physmem.cbegin()->second + 0x10);
+      uint64_t Size = 0;
+      for (const auto &Clipped : Dmp.GetPhysicalSpans(PhysicalAddress, 0x20)) {
+        CHECK(Clipped.PhysicalAddress == PhysicalAddress);
+        Size += Clipped.Size;
+      }
+
+      CHECK(Size == 0x20);
+    }
+  }
+
+  SECTION("Physical spans in file order") {
+    for (const auto &Testcase : Testcases) {
+      kdmpparser::KernelDumpParser Dmp;
+      REQUIRE(Dmp.Parse(Testcase.File.data()));
+      const auto &Physmem = Dmp.GetPhysmem();
+      const uint8_t *LastData = nullptr;
+      uint64_t NumberOfPages = 0;
+      for (const auto &Span : Dmp.GetPhysicalSpansInFileOrder()) {
+        CHECK(Span.Data > LastData);
+        CHECK(Dmp.GetPhysicalSpan(Span.PhysicalAddress)->Data == Span.Data);
+        LastData = Span.Data;
+        NumberOfPages += Span.Size / kdmpparser::Page::Size;
+      }
+
+      CHECK(NumberOfPages == Physmem.size());
+    }
+  }
+
+  SECTION("Translations cached in the TLB and paging-structure cache") {
+    for (const auto &Testcase : Testcases) {
+      kdmpparser::KernelDumpParser Dmp;
+      REQUIRE(Dmp.Parse(Testcase.File.data()));
+      kdmpparser::ParseOptions_t Options;
+      Options.TlbCapacity = 1'024;
+      Options.PagingStructureCacheCapacity = 1'024;
+      kdmpparser::KernelDumpParser CachedDmp;
+      REQUIRE(CachedDmp.Parse(Testcase.File.data(), Options));
+
+      const uint64_t VirtualAddresses[] = {Testcase.Rip, Testcase.Rsp,
+                                           Testcase.Rbp, Testcase.Rip + 1};
+      for (int Pass = 0; Pass < 2; Pass++) {
+        for (const uint64_t VirtualAddress : VirtualAddresses) {
+          const auto &Expected = Dmp.VirtTranslate(VirtualAddress);
+          const auto &Translation = CachedDmp.GetTranslation(VirtualAddress);
+          REQUIRE(Translation.has_value() == Expected.has_value());
+          if (!Expected) {
+            continue;
+          }
+
+          CHECK(Translation->PhysicalAddress == *Expected);
+          CHECK((Translation->PageSize == 0x1000 ||
+                 Translation->PageSize == 0x20'0000 ||
+                 Translation->PageSize == 0x4000'0000));
+        }
+
+        CachedDmp.InvalidateTlb(Dmp.GetDirectoryTableBase());
+      }
+    }
+  }
+
+  SECTION("Batch of translations") {
+    for (const auto &Testcase : Testcases) {
+      kdmpparser::KernelDumpParser Dmp;
+      REQUIRE(Dmp.Parse(Testcase.File.data()));
+      const std::vector<uint64_t> VirtualAddresses = {
+          Testcase.Rsp,          Testcase.Rip,
+          0,                     Testcase.Rip + 0x10,
+          Testcase.Rbp,          Testcase.Rip,
+          Testcase.Rsp + 0x1000, 0xffff'f000'0000'0000};
+      const auto &PhysicalAddresses = Dmp.VirtTranslateBatch(VirtualAddresses);
+      REQUIRE(PhysicalAddresses.size() == VirtualAddresses.size());
+      for (size_t Idx = 0; Idx < VirtualAddresses.size(); Idx++) {
+        const auto &Expected = Dmp.VirtTranslate(VirtualAddresses[Idx]);
+        CHECK(PhysicalAddresses[Idx] == Expected);
+      }
+    }
+  }
+
+  SECTION("Read virtual memory") {
+    for (const auto &Testcase : Testcases) {
+      kdmpparser::KernelDumpParser Dmp;
+      REQUIRE(Dmp.Parse(Testcase.File.data()));
+      const uint64_t VirtualAddress = Testcase.Rsp - 0x1'0010;
+      std::vector<uint8_t> Buffer(0x2'0000);
+      const size_t BytesRead = Dmp.ReadVirtualMemoryPartial(
+          VirtualAddress, Buffer.data(), Buffer.size());
+      CHECK(Dmp.ReadVirtualMemory(VirtualAddress, Buffer.data(),
+                                  Buffer.size()) ==
+            (BytesRead == Buffer.size()));
+
+      for (size_t Offset = 0; Offset < BytesRead; Offset += 0x800) {
+        const uint64_t Address = VirtualAddress + Offset;
+        const uint8_t *Page = Dmp.GetVirtualPage(Address);
+        REQUIRE(Page != nullptr);
+        CHECK(Buffer[Offset] == Page[kdmpparser::Page::Offset(Address)]);
+      }
+
+      if (BytesRead < Buffer.size()) {
+        CHECK(Dmp.GetVirtualPage(VirtualAddress + BytesRead) == nullptr);
+      }
+    }
+  }
+
+  SECTION("Address space enumeration") {
+    for (const auto &Testcase : Testcases) {
+      kdmpparser::KernelDumpParser Dmp;
+      REQUIRE(Dmp.Parse(Testcase.File.data()));
+      std::vector<kdmpparser::VirtualRange_t> Ranges;
+      REQUIRE(Dmp.EnumerateAddressSpace(
+          0, [&](const auto &Range) { Ranges.push_back(Range); }));
+      REQUIRE(!Ranges.empty());
+
+      size_t NumberOfRanges = 0;
+      REQUIRE(Dmp.EnumerateAddressSpace(
+          0, [&](const auto &) { NumberOfRanges++; }, 0));
+      CHECK(NumberOfRanges == Ranges.size());
+
+      for (size_t Idx = 1; Idx < Ranges.size(); Idx++) {
+        const auto &Previous = Ranges[Idx - 1];
+        CHECK(Previous.VirtualAddress + Previous.Size <=
+              Ranges[Idx].VirtualAddress);
+      }
+
+      for (const uint64_t VirtualAddress : {Testcase.Rip, Testcase.Rsp}) {
+        const auto &PhysicalAddress = Dmp.VirtTranslate(VirtualAddress);
+        if (!PhysicalAddress) {
+          continue;
+        }
+
+        const auto &Range = std::find_if(
+            Ranges.begin(), Ranges.end(), [&](const auto &Range) {
+              return VirtualAddress >= Range.VirtualAddress &&
+                     (VirtualAddress - Range.VirtualAddress) < Range.Size;
+            });
+
+        REQUIRE(Range != Ranges.end());
+        CHECK(Range->PhysicalAddress +
+                  (VirtualAddress - Range->VirtualAddress) ==
+              *PhysicalAddress);
+      }
+    }
+  }
+
+  SECTION("Reverse map") {
+    for (const auto &Testcase : Testcases) {
+      kdmpparser::KernelDumpParser Dmp;
+      REQUIRE(Dmp.Parse(Testcase.File.data()));
+      kdmpparser::ReverseMap_t ReverseMap;
+      REQUIRE(Dmp.BuildReverseMap({0}, ReverseMap, 0));
+      REQUIRE(!ReverseMap.empty());
+      CHECK(ReverseMap.DirectoryTableBases().size() == 1);
+
+      for (const uint64_t VirtualAddress : {Testcase.Rip, Testcase.Rsp}) {
+        const auto &PhysicalAddress = Dmp.VirtTranslate(VirtualAddress);
+        if (!PhysicalAddress) {
+          continue;
+        }
+
+        const auto &Mappings = ReverseMap.Find(*PhysicalAddress);
+        CHECK(std::any_of(
+            Mappings.begin(), Mappings.end(), [&](const auto &Mapping) {
+              return Mapping.VirtualAddress == VirtualAddress;
+            }));
+
+        for (const auto &Mapping : Mappings) {
+          CHECK(Dmp.VirtTranslate(Mapping.VirtualAddress,
+                                  Mapping.DirectoryTableBase) ==
+                PhysicalAddress);
+        }
+      }
+    }
+  }
+
+  SECTION("Directory table base discovery") {
+    for (const auto &Testcase : Testcases) {
+      kdmpparser::KernelDumpParser Dmp;
+      REQUIRE(Dmp.Parse(Testcase.File.data()));
+      const auto &Candidates = Dmp.FindDirectoryTableBases(0);
+      REQUIRE(!Candidates.empty());
+      const uint64_t DirectoryTableBase =
+          kdmpparser::Page::Align(Dmp.GetDirectoryTableBase());
+      CHECK(Candidates.front().DirectoryTableBase == DirectoryTableBase);
+      CHECK(Candidates.front().NumberOfKernelMatches == 256);
+      for (size_t Idx = 1; Idx < Candidates.size(); Idx++) {
+        CHECK(Candidates[Idx - 1].Score >= Candidates[Idx].Score);
+      }
+    }
+  }
+
+  SECTION("Kernel translations shared across address spaces") {
+    for (const auto &Testcase : Testcases) {
+      kdmpparser::KernelDumpParser Dmp;
+      REQUIRE(Dmp.Parse(Testcase.File.data()));
+      kdmpparser::ParseOptions_t Options;
+      Options.TlbCapacity = 1'024;
+      Options.PagingStructureCacheCapacity = 1'024;
+      kdmpparser::KernelDumpParser CachedDmp;
+      REQUIRE(CachedDmp.Parse(Testcase.File.data(), Options));
+
+      const auto &Candidates = Dmp.FindDirectoryTableBases();
+      const uint64_t VirtualAddresses[] = {Testcase.Rip, Testcase.Rsp,
+                                           Testcase.Rip + 0x1000};
+      for (int Pass = 0; Pass < 2; Pass++) {
+        for (const auto &Candidate : Candidates) {
+          const uint64_t DirectoryTableBase = Candidate.DirectoryTableBase;
+          for (const uint64_t VirtualAddress : VirtualAddresses) {
+            const auto &Expected =
+                Dmp.VirtTranslate(VirtualAddress, DirectoryTableBase);
+            CHECK(CachedDmp.VirtTranslate(VirtualAddress,
+                                          DirectoryTableBase) == Expected);
+          }
+
+          std::vector<std::optional<uint64_t>> Expected;
+          for (const uint64_t VirtualAddress : VirtualAddresses) {
+            Expected.push_back(
+                Dmp.VirtTranslate(VirtualAddress, DirectoryTableBase));
+          }
+
+          const std::vector<uint64_t> Batch(std::begin(VirtualAddresses),
+                                            std::end(VirtualAddresses));
+          CHECK(CachedDmp.VirtTranslateBatch(Batch, DirectoryTableBase) ==
+                Expected);
+        }
+      }
+    }
+  }
+
+  SECTION("Pread file backend") {
+    for (const auto &Testcase : Testcases) {
+      kdmpparser::KernelDumpParser Dmp;
+      REQUIRE(Dmp.Parse(Testcase.File.data()));
+      kdmpparser::ParseOptions_t Options;
+      Options.FileBackend = kdmpparser::FileBackendType_t::Pread;
+      Options.BlockSize = 0x4000;
+      Options.BlockCacheSize = 0x10'0000;
+      kdmpparser::KernelDumpParser PreadDmp;
+      REQUIRE(PreadDmp.Parse(Testcase.File.data(), Options));
+      CHECK(PreadDmp.GetDumpType() == Dmp.GetDumpType());
+      CHECK(PreadDmp.GetPhysmem().size() == Dmp.GetPhysmem().size());
+
+      for (const auto &[PhysicalAddress, Page] : Dmp.GetPhysmem()) {
+        kdmpparser::Page_t Buffer;
+        const uint8_t *PreadPage =
+            PreadDmp.GetPhysicalPage(PhysicalAddress, Buffer);
+        REQUIRE(PreadPage != nullptr);
+        CHECK(memcmp(PreadPage, Page, kdmpparser::Page::Size) == 0);
+      }
+
+      //
+      // The file isn't mapped, so spans have no content, even when they
+      // don't start on a page boundary.
+      //
+
+      const uint64_t FirstPhysicalAddress =
+          Dmp.GetPhysmem().cbegin()->first + 0x123;
+      const auto &Span = PreadDmp.GetPhysicalSpan(FirstPhysicalAddress);
+      REQUIRE(Span);
+      CHECK(Span->PhysicalAddress == FirstPhysicalAddress);
+      CHECK(Span->Data == nullptr);
+      CHECK(Span->Size == Dmp.GetPhysicalSpan(FirstPhysicalAddress)->Size);
+
+      const uint64_t VirtualAddresses[] = {Testcase.Rip, Testcase.Rsp,
+                                           Testcase.Rbp};
+      for (const uint64_t VirtualAddress : VirtualAddresses) {
+        CHECK(PreadDmp.VirtTranslate(VirtualAddress) ==
+              Dmp.VirtTranslate(VirtualAddress));
+      }
+
+      std::vector<kdmpparser::VirtualRange_t> Expected, Ranges;
+      REQUIRE(Dmp.EnumerateAddressSpace(
+          0, [&](const auto &Range) { Expected.push_back(Range); }));
+      REQUIRE(PreadDmp.EnumerateAddressSpace(
+          0, [&](const auto &Range) { Ranges.push_back(Range); }));
+      CHECK(Ranges.size() == Expected.size());
+
+      const auto &Candidates = PreadDmp.FindDirectoryTableBases();
+      REQUIRE(!Candidates.empty());
+      CHECK(Candidates.front().DirectoryTableBase ==
+            Dmp.FindDirectoryTableBases().front().DirectoryTableBase);
+    }
+  }
+
+  SECTION("Access hints") {
+    const kdmpparser::AccessHint_t Hints[] = {
+        kdmpparser::AccessHint_t::Sequential,
+        kdmpparser::AccessHint_t::Random, kdmpparser::AccessHint_t::WillNeed,
+        kdmpparser::AccessHint_t::DontNeed, kdmpparser::AccessHint_t::Normal};
+
+    kdmpparser::KernelDumpParser Dmp;
+    CHECK(!Dmp.Advise(kdmpparser::AccessHint_t::Random));
+    for (const auto FileBackend : {kdmpparser::FileBackendType_t::Map,
+                                   kdmpparser::FileBackendType_t::Pread}) {
+      kdmpparser::ParseOptions_t Options;
+      Options.FileBackend = FileBackend;
+      Options.AccessHint = kdmpparser::AccessHint_t::Random;
+      REQUIRE(Dmp.Parse(Testcases.front().File.data(), Options));
+
+      std::vector<uint64_t> PhysicalAddresses;
+      for (const auto &[PhysicalAddress, Page] : Dmp.GetPhysmem()) {
+        PhysicalAddresses.push_back(PhysicalAddress);
+      }
+
+      REQUIRE(!PhysicalAddresses.empty());
+      const uint64_t PhysicalAddress = PhysicalAddresses.back();
+      kdmpparser::Page_t Expected;
+      REQUIRE(Dmp.ReadPhysicalMemory(PhysicalAddress, Expected.data(),
+                                     Expected.size()));
+
+      for (const auto Hint : Hints) {
+        CHECK(Dmp.Advise(Hint));
+        CHECK(Dmp.AdvisePhysicalRange(Hint, 0, ~0ULL));
+        CHECK(Dmp.AdvisePhysicalRange(Hint, PhysicalAddress + 1, 1));
+        CHECK(Dmp.AdvisePhysicalPages(Hint, PhysicalAddresses));
+      }
+
+      //
+      // Releasing the pages doesn't lose their content.
+      //
+
+      kdmpparser::Page_t Buffer;
+      const uint8_t *Page = Dmp.GetPhysicalPage(PhysicalAddress, Buffer);
+      REQUIRE(Page != nullptr);
+      CHECK(memcmp(Page, Expected.data(), kdmpparser::Page::Size) == 0);
+    }
+  }
+
+  SECTION("Mapping options") {
+    const auto &Testcase = Testcases.front();
+    kdmpparser::KernelDumpParser Dmp;
+    REQUIRE(Dmp.Parse(Testcase.File.data()));
+    CHECK(!Dmp.GetMapReport().Populated);
+    CHECK(!Dmp.GetMapReport().Locked);
+    CHECK(!Dmp.GetMapReport().HugePages);
+
+    std::vector<std::filesystem::path> Paths = {Testcase.File};
+#if defined(LINUX)
+    //
+    // The file needs to be in memory already to be copied to huge pages.
+    //
+
+    const std::filesystem::path ShmPath =
+        std::filesystem::path("/dev/shm") / "kdmp-parser-tests.dmp";
+    std::error_code Error;
+    if (std::filesystem::copy_file(
+            Testcase.File, ShmPath,
+            std::filesystem::copy_options::overwrite_existing, Error)) {
+      Paths.push_back(ShmPath);
+    }
+#endif
+
+    for (const auto &Path : Paths) {
+      kdmpparser::ParseOptions_t Options;
+      Options.Populate = true;
+      Options.LockView = true;
+      Options.HugePages = true;
+      kdmpparser::KernelDumpParser MappedDmp;
+      REQUIRE(MappedDmp.Parse(Path.string().c_str(), Options));
+
+      const auto &Report = MappedDmp.GetMapReport();
+      CHECK(Report.HugePages == (Path != Testcase.File));
+      CHECK(Report.MapTime >= Report.PopulateTime + Report.HugePagesTime);
+#if defined(LINUX)
+      CHECK(Report.Populated);
+#endif
+
+      std::vector<uint64_t> PhysicalAddresses;
+      for (const auto &[PhysicalAddress, Page] : Dmp.GetPhysmem()) {
+        const uint8_t *MappedPage = MappedDmp.GetPhysicalPage(PhysicalAddress);
+        REQUIRE(MappedPage != nullptr);
+        CHECK(memcmp(MappedPage, Page, kdmpparser::Page::Size) == 0);
+        PhysicalAddresses.push_back(PhysicalAddress);
+      }
+
+      //
+      // Locking depends on the limit on locked memory, so only check that it
+      // doesn't break anything.
+      //
+
+      PhysicalAddresses.resize(std::min(PhysicalAddresses.size(), size_t(16)));
+      MappedDmp.LockPhysicalPages(PhysicalAddresses);
+      CHECK(MappedDmp.Advise(kdmpparser::AccessHint_t::DontNeed));
+      const uint8_t *Page = MappedDmp.GetPhysicalPage(PhysicalAddresses[0]);
+      REQUIRE(Page != nullptr);
+      CHECK(memcmp(Page, Dmp.GetPhysicalPage(PhysicalAddresses[0]),
+                   kdmpparser::Page::Size) == 0);
+    }
+
+#if defined(LINUX)
+    std::filesystem::remove(ShmPath, Error);
+#endif
+  }
+
+  SECTION("Asynchronous page reads") {
+    for (const auto &Testcase : Testcases) {
+      kdmpparser::KernelDumpParser Dmp;
+      REQUIRE(Dmp.Parse(Testcase.File.data()));
+
+      //
+      // Ask for the pages backwards, some of them twice, and for pages that
+      // aren't in the dump.
+      //
+
+      std::vector<uint64_t> PhysicalAddresses;
+      for (const auto &[PhysicalAddress, Page] : Dmp.GetPhysmem()) {
+        PhysicalAddresses.push_back(PhysicalAddress);
+        if ((PhysicalAddress / kdmpparser::Page::Size) % 3 == 0) {
+          PhysicalAddresses.push_back(PhysicalAddress);
+        }
+      }
+
+      std::reverse(PhysicalAddresses.begin(), PhysicalAddresses.end());
+      const size_t NumberOfPages = PhysicalAddresses.size();
+      PhysicalAddresses.push_back(0xffff'ffff'f000ULL);
+      PhysicalAddresses.push_back(PhysicalAddresses.front() + 1);
+
+      for (const bool UseIoUring : {true, false}) {
+        kdmpparser::AsyncReadOptions_t Options;
+        Options.UseIoUring = UseIoUring;
+        Options.QueueDepth = 4;
+        Options.MaxReadSize = 0x4000;
+        size_t NumberOfReads = 0, NumberOfFailures = 0;
+        const bool Success = Dmp.ReadPhysicalPagesAsync(
+            PhysicalAddresses,
+            [&](const uint64_t PhysicalAddress, const uint8_t *Page) {
+              NumberOfReads++;
+              if (!Page) {
+                NumberOfFailures++;
+                return;
+              }
+
+              CHECK(memcmp(Page, Dmp.GetPhysicalPage(PhysicalAddress),
+                           kdmpparser::Page::Size) == 0);
+            },
+            Options);
+
+        CHECK(!Success);
+        CHECK(NumberOfReads == NumberOfPages + 2);
+        CHECK(NumberOfFailures == 2);
+      }
+    }
+  }
+
+  SECTION("Compressed dumps") {
+    std::vector<uint8_t> Data(0x2'0000);
+    uint32_t Seed = 0x1337;
+    for (size_t Idx = 0; Idx < Data.size(); Idx++) {
+      Seed = (Seed * 1103515245) + 12345;
+      Data[Idx] = Idx < 0x1'0000 ? uint8_t(Seed >> 16) : uint8_t(Idx % 7);
+    }
+
+    for (const size_t Size : {size_t(0), size_t(13), size_t(0x1'0000),
+                              size_t(0x1'8000), Data.size()}) {
+      std::vector<uint8_t> Compressed(kdmpparser::Lz4::CompressBound(Size));
+      const size_t CompressedSize = kdmpparser::Lz4::Compress(
+          Data.data(), Size, Compressed.data(), Compressed.size());
+      REQUIRE(CompressedSize != 0);
+      std::vector<uint8_t> Decompressed(Size);
+      CHECK(kdmpparser::Lz4::Decompress(Compressed.data(), CompressedSize,
+                                        Decompressed.data(), Size) == Size);
+      if (Size == 0) {
+        continue;
+      }
+
+      CHECK(memcmp(Decompressed.data(), Data.data(), Size) == 0);
+
+      //
+      // Truncated blocks and blocks that don't fit are rejected.
+      //
+
+      CHECK(kdmpparser::Lz4::Decompress(Compressed.data(), CompressedSize - 1,
+                                        Decompressed.data(), Size) != Size);
+      CHECK(kdmpparser::Lz4::Decompress(Compressed.data(), CompressedSize,
+                                        Decompressed.data(), Size - 1) == 0);
+    }
+
+    const std::filesystem::path Path =
+        std::filesystem::temp_directory_path() / "kdmp-parser-tests.dmp.lz4";
+    for (const auto &Testcase : Testcases) {
+      REQUIRE(kdmpparser::CompressFile(Testcase.File.data(),
+                                       Path.string().c_str(), 0x4000, 2));
+      CHECK(kdmpparser::CompressedFile_t::IsCompressedFile(
+          Path.string().c_str()));
+      CHECK(!kdmpparser::CompressedFile_t::IsCompressedFile(
+          Testcase.File.data()));
+
+      kdmpparser::KernelDumpParser Dmp;
+      REQUIRE(Dmp.Parse(Testcase.File.data()));
+      CHECK(!Dmp.IsCompressed());
+      kdmpparser::ParseOptions_t Options;
+      Options.BlockCacheSize = 0x2'0000;
+      kdmpparser::KernelDumpParser CompressedDmp;
+      REQUIRE(CompressedDmp.Parse(Path.string().c_str(), Options));
+      CHECK(CompressedDmp.IsCompressed());
+      CHECK(CompressedDmp.GetDumpType() == Dmp.GetDumpType());
+      CHECK(CompressedDmp.GetPhysmem().size() == Dmp.GetPhysmem().size());
+
+      std::vector<uint64_t> PhysicalAddresses;
+      for (const auto &[PhysicalAddress, Page] : Dmp.GetPhysmem()) {
+        kdmpparser::Page_t Buffer;
+        const uint8_t *CompressedPage =
+            CompressedDmp.GetPhysicalPage(PhysicalAddress, Buffer);
+        REQUIRE(CompressedPage != nullptr);
+        CHECK(memcmp(CompressedPage, Page, kdmpparser::Page::Size) == 0);
+        PhysicalAddresses.push_back(PhysicalAddress);
+      }
+
+      const uint64_t VirtualAddresses[] = {Testcase.Rip, Testcase.Rsp,
+                                           Testcase.Rbp};
+      for (const uint64_t VirtualAddress : VirtualAddresses) {
+        CHECK(CompressedDmp.VirtTranslate(VirtualAddress) ==
+              Dmp.VirtTranslate(VirtualAddress));
+      }
+
+      size_t NumberOfReads = 0;
+      CHECK(CompressedDmp.ReadPhysicalPagesAsync(
+          PhysicalAddresses,
+          [&](const uint64_t PhysicalAddress, const uint8_t *Page) {
+            NumberOfReads++;
+            REQUIRE(Page != nullptr);
+            CHECK(memcmp(Page, Dmp.GetPhysicalPage(PhysicalAddress),
+                         kdmpparser::Page::Size) == 0);
+          }));
+      CHECK(NumberOfReads == PhysicalAddresses.size());
+
+      //
+      // The index file of a compressed dump describes the decompressed dump,
+      // and is used as is the next time; an index file that is rewritten
+      // gets a new last write time.
+      //
+
+      if (Dmp.GetDumpType() == kdmpparser::DumpType_t::BMPDump ||
+          Dmp.GetDumpType() == kdmpparser::DumpType_t::LiveKernelBitmapDump) {
+        continue;
+      }
+
+      const auto &IndexFilePath = kdmpparser::IndexFile_t::PathFor(Path);
+      std::filesystem::remove(IndexFilePath);
+      Options.UseIndexFile = true;
+      kdmpparser::KernelDumpParser WriterDmp;
+      REQUIRE(WriterDmp.Parse(Path.string().c_str(), Options));
+      REQUIRE(std::filesystem::exists(IndexFilePath));
+      const auto LastWriteTime = std::filesystem::last_write_time(Path);
+      std::filesystem::last_write_time(IndexFilePath, LastWriteTime);
+
+      kdmpparser::KernelDumpParser ReaderDmp;
+      REQUIRE(ReaderDmp.Parse(Path.string().c_str(), Options));
+      CHECK(std::filesystem::last_write_time(IndexFilePath) == LastWriteTime);
+      REQUIRE(ReaderDmp.GetPhysmem().size() == Dmp.GetPhysmem().size());
+      for (const auto &[PhysicalAddress, Page] : Dmp.GetPhysmem()) {
+        kdmpparser::Page_t Buffer;
+        const uint8_t *ReaderPage =
+            ReaderDmp.GetPhysicalPage(PhysicalAddress, Buffer);
+        REQUIRE(ReaderPage != nullptr);
+        CHECK(memcmp(ReaderPage, Page, kdmpparser::Page::Size) == 0);
+      }
+
+      std::filesystem::remove(IndexFilePath);
+    }
+
+    //
+    // A compressed dump that is cut short is rejected.
+    //
+
+    const uint64_t Size = std::filesystem::file_size(Path);
+    std::filesystem::resize_file(Path, Size - 1);
+    kdmpparser::KernelDumpParser Dmp;
+    CHECK(!Dmp.Parse(Path.string().c_str()));
+    std::filesystem::remove(Path);
+  }
+
+  SECTION("Buffer and descriptor sources") {
+    const std::filesystem::path CompressedPath =
+        std::filesystem::temp_directory_path() / "kdmp-parser-tests.dmp.lz4";
+    for (const auto &Testcase : Testcases) {
+      REQUIRE(kdmpparser::CompressFile(Testcase.File.data(),
+                                       CompressedPath.string().c_str()));
+      kdmpparser::KernelDumpParser Dmp;
+      REQUIRE(Dmp.Parse(Testcase.File.data()));
+
+      for (const auto &Path :
+           {std::filesystem::path(Testcase.File), CompressedPath}) {
+        std::ifstream File(Path, std::ios::binary);
+        const std::vector<uint8_t> Buffer(
+            (std::istreambuf_iterator<char>(File)),
+            std::istreambuf_iterator<char>());
+        REQUIRE(!Buffer.empty());
+
+#if defined(WINDOWS)
+        const int Fd = _open(Path.string().c_str(), _O_RDONLY | _O_BINARY);
+#else
+        const int Fd = open(Path.string().c_str(), O_RDONLY);
+#endif
+        REQUIRE(Fd >= 0);
+
+        //
+        // The index file needs a path, so it is ignored.
+        //
+
+        kdmpparser::ParseOptions_t Options;
+        Options.UseIndexFile = true;
+        kdmpparser::KernelDumpParser BufferDmp, DescriptorDmp;
+        REQUIRE(BufferDmp.Parse(Buffer.data(), Buffer.size(), Options));
+        REQUIRE(DescriptorDmp.ParseDescriptor(Fd, Options));
+#if defined(WINDOWS)
+        _close(Fd);
+#else
+        close(Fd);
+#endif
+
+        for (const auto *OtherDmp : {&BufferDmp, &DescriptorDmp}) {
+          CHECK(OtherDmp->GetDumpPath().empty());
+          CHECK(OtherDmp->IsCompressed() == (Path == CompressedPath));
+          CHECK(OtherDmp->GetDumpType() == Dmp.GetDumpType());
+          CHECK(OtherDmp->GetPhysmem().size() == Dmp.GetPhysmem().size());
+
+          std::vector<uint64_t> PhysicalAddresses;
+          for (const auto &[PhysicalAddress, Page] : Dmp.GetPhysmem()) {
+            const uint8_t *OtherPage =
+                OtherDmp->GetPhysicalPage(PhysicalAddress);
+            REQUIRE(OtherPage != nullptr);
+            CHECK(memcmp(OtherPage, Page, kdmpparser::Page::Size) == 0);
+            PhysicalAddresses.push_back(PhysicalAddress);
+          }
+
+          CHECK(OtherDmp->VirtTranslate(Testcase.Rip) ==
+                Dmp.VirtTranslate(Testcase.Rip));
+
+          size_t NumberOfReads = 0;
+          CHECK(OtherDmp->ReadPhysicalPagesAsync(
+              PhysicalAddresses,
+              [&](const uint64_t PhysicalAddress, const uint8_t *Page) {
+                NumberOfReads++;
+                REQUIRE(Page != nullptr);
+                CHECK(memcmp(Page, Dmp.GetPhysicalPage(PhysicalAddress),
+                             kdmpparser::Page::Size) == 0);
+              }));
+          CHECK(NumberOfReads == PhysicalAddresses.size());
+        }
+      }
+    }
+
+    CHECK(!std::filesystem::exists(
+        kdmpparser::IndexFile_t::PathFor(std::filesystem::path())));
+    std::filesystem::remove(CompressedPath);
+
+    //
+    // A truncated buffer, or a descriptor that isn't open, are rejected.
+    //
+
+    std::ifstream File(std::filesystem::path(Testcases.front().File),
+                       std::ios::binary);
+    const std::vector<uint8_t> Buffer((std::istreambuf_iterator<char>(File)),
+                                      std::istreambuf_iterator<char>());
+    kdmpparser::KernelDumpParser Dmp;
+    CHECK(!Dmp.Parse(Buffer.data(), 0x100));
+    CHECK(!Dmp.Parse(nullptr, 0));
+    CHECK(!Dmp.ParseDescriptor(-1));
+  }
+
+  SECTION("Streaming") {
+    for (const auto &Testcase : Testcases) {
+      kdmpparser::KernelDumpParser Dmp;
+      REQUIRE(Dmp.Parse(Testcase.File.data()));
+
+      //
+      // Read the dump in chunks of odd sizes, like a pipe would.
+      //
+
+      std::ifstream File(std::filesystem::path(Testcase.File),
+                         std::ios::binary);
+      size_t NumberOfReads = 0;
+      const auto &Read = [&](void *Out, const uint64_t Size) -> uint64_t {
+        const uint64_t Odd = 0x1337 + (NumberOfReads++ % 7) * 0x100;
+        const uint64_t ChunkSize = std::min(Size, Odd);
+        File.read((char *)Out, std::streamsize(ChunkSize));
+        return uint64_t(File.gcount());
+      };
+
+      kdmpparser::StreamOptions_t Options;
+      Options.BufferSize = 0x3000;
+      kdmpparser::StreamParser_t Stream;
+      REQUIRE(Stream.ParseMetadata(Read, Options));
+      const auto &StreamDmp = Stream.GetDumpParser();
+      CHECK(StreamDmp.GetDumpType() == Dmp.GetDumpType());
+      CHECK(StreamDmp.GetContext().Rip == Dmp.GetContext().Rip);
+      CHECK(StreamDmp.GetDirectoryTableBase() == Dmp.GetDirectoryTableBase());
+
+      const auto &Runs = Stream.GetRuns();
+      REQUIRE(!Runs.empty());
+      uint64_t NumberOfPages = 0;
+      for (size_t RunIdx = 0; RunIdx < Runs.size(); RunIdx++) {
+        const auto &Run = Runs[RunIdx];
+        CHECK(Dmp.GetPhysicalPageFileOffset(Run.Pfn * kdmpparser::Page::Size) ==
+              Run.FileOffset);
+        if (RunIdx != 0) {
+          CHECK(Runs[RunIdx - 1].FileOffset < Run.FileOffset);
+        }
+
+        NumberOfPages += Run.PageCount;
+      }
+
+      CHECK(NumberOfPages == Dmp.GetPhysmem().size());
+
+      std::unordered_map<uint64_t, size_t> Seen;
+      CHECK(Stream.ReadPages(
+          Read, [&](const uint64_t PhysicalAddress, const uint8_t *Page) {
+            Seen[PhysicalAddress]++;
+            CHECK(memcmp(Page, Dmp.GetPhysicalPage(PhysicalAddress),
+                         kdmpparser::Page::Size) == 0);
+            return true;
+          }));
+      CHECK(Seen.size() == NumberOfPages);
+      CHECK(std::all_of(Seen.begin(), Seen.end(),
+                        [](const auto &Entry) { return Entry.second == 1; }));
+    }
+
+    const auto &Testcase = Testcases.front();
+    std::ifstream File(std::filesystem::path(Testcase.File), std::ios::binary);
+    const std::vector<uint8_t> Buffer((std::istreambuf_iterator<char>(File)),
+                                      std::istreambuf_iterator<char>());
+    const auto &BufferReader = [&](const uint64_t Size) {
+      return [&, Size, Offset = uint64_t(0)](void *Out,
+                                             const uint64_t ReadSize) mutable {
+        const uint64_t ChunkSize =
+            std::min(ReadSize, Size - std::min(Offset, Size));
+        memcpy(Out, Buffer.data() + Offset, size_t(ChunkSize));
+        Offset += ChunkSize;
+        return ChunkSize;
+      };
+    };
+
+    //
+    // Streaming stops when the callback asks for it, and fails when the
+    // stream is cut short.
+    //
+
+    kdmpparser::StreamParser_t Stream;
+    size_t NumberOfPages = 0;
+    CHECK(!Stream.Parse(BufferReader(Buffer.size()),
+                        [&](const uint64_t, const uint8_t *) {
+                          return ++NumberOfPages < 10;
+                        }));
+    CHECK(NumberOfPages == 10);
+
+    NumberOfPages = 0;
+    CHECK(!Stream.Parse(BufferReader(Buffer.size() - 1),
+                        [&](const uint64_t, const uint8_t *) {
+                          NumberOfPages++;
+                          return true;
+                        }));
+    CHECK(NumberOfPages < Stream.GetDumpParser().GetPhysmem().size());
+    CHECK(!Stream.Parse(BufferReader(0x1000), nullptr));
+
+#if defined(LINUX)
+    //
+    // Stream the dump through a pipe.
+    //
+
+    int Fds[2];
+    REQUIRE(pipe(Fds) == 0);
+    std::thread Writer([&]() {
+      uint64_t Offset = 0;
+      while (Offset < Buffer.size()) {
+        const ssize_t Written =
+            write(Fds[1], Buffer.data() + Offset, Buffer.size() - Offset);
+        if (Written <= 0) {
+          break;
+        }
+
+        Offset += uint64_t(Written);
+      }
+
+      close(Fds[1]);
+    });
+
+    NumberOfPages = 0;
+    CHECK(Stream.Parse(kdmpparser::StreamParser_t::DescriptorReader(Fds[0]),
+                       [&](const uint64_t, const uint8_t *) {
+                         NumberOfPages++;
+                         return true;
+                       }));
+    Writer.join();
+    close(Fds[0]);
+    CHECK(NumberOfPages == Stream.GetDumpParser().GetPhysmem().size());
+    CHECK(Stream.GetPosition() <= Buffer.size());
+#endif
+  }
+
+  SECTION("Diagnostics") {
+    std::vector<kdmpparser::Diagnostic_t> Diagnostics;
+    const auto &Collect = [&](const kdmpparser::Diagnostic_t &Diagnostic) {
+      Diagnostics.push_back(Diagnostic);
+    };
+
+    //
+    // Put the default callback back even if a REQUIRE fails, as `Collect`
+    // doesn't outlive the section.
+    //
+
+    struct RestoreCallback_t {
+      ~RestoreCallback_t() {
+        kdmpparser::Diagnostics::SetCallback(kdmpparser::Diagnostics::Print);
+      }
+    } RestoreCallback;
+
+    kdmpparser::Diagnostics::SetCallback(Collect);
+    kdmpparser::KernelDumpParser Dmp;
+    CHECK(!Dmp.Parse("does-not-exist.dmp"));
+    REQUIRE(!Diagnostics.empty());
+    const auto &Diagnostic = Diagnostics.front();
+    CHECK(Diagnostic.Code == kdmpparser::DiagnosticCode_t::FileNotFound);
+    CHECK(Diagnostic.Severity == kdmpparser::Severity_t::Error);
+
+    Diagnostics.clear();
+    REQUIRE(Dmp.Parse(Testcases.front().File.data()));
+    CHECK(!Dmp.VirtTranslate(0).has_value());
+    CHECK(Diagnostics.empty());
+
+    kdmpparser::Diagnostics::SetCallback(Collect,
+                                         kdmpparser::Severity_t::Debug);
+    CHECK(!Dmp.VirtTranslate(0).has_value());
+    REQUIRE(!Diagnostics.empty());
+    CHECK(Diagnostics.back().Severity == kdmpparser::Severity_t::Debug);
+  }
+
   SECTION("Context values") {
     for (const auto &Testcase : Testcases) {
       kdmpparser::KernelDumpParser Dmp;